@@ -0,0 +1,70 @@
+         SPUSHI  46
+         OUT    
+         LDI     3
+         STA     C0
+LOOP0    CALL    F0
+         SPUSH  
+         SPUSHI  13
+         BRP     SKIP0
+         CALL    F0
+         SPUSHI  5
+         SDIV   
+         SPUSHI  66
+SKIP0    SDROP  
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         SDROP  
+         STA     V0
+         SPUSHI  5
+         BRA     SKIP1
+         LDI     1
+         STA     C1
+LOOP1    OUT    
+         OUT    
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         LDI     4
+         STA     C2
+LOOP2    ADD     V1
+         SPUSH  
+         SDROP  
+         LDA     C2
+         SUB     ONE
+         STA     C2
+         BRP     LOOP2
+         SPUSH  
+         ADD     V1
+         SADD   
+SKIP1    SPUSHI  6
+         SMIN   
+         SDROP  
+         HLT    
+F0       BRA     SKIP2
+         LDI     53
+         OUT    
+SKIP2    ADD     V1
+         SDROP  
+         LDI     4
+         STA     C3
+LOOP3    SPUSHI  28
+         ADD     V0
+         SDROP  
+         LDA     C3
+         SUB     ONE
+         STA     C3
+         BRP     LOOP3
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+C2       DAT     0
+C3       DAT     0
+V0       DAT     45
+V1       DAT     39
+V2       DAT     8
+V3       DAT     28
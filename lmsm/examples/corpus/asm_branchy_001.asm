@@ -0,0 +1,64 @@
+         SPUSHI  46
+         SDROP  
+         OUT    
+         BRA     SKIP0
+         SPUSHI  28
+         OUT    
+         LDI     2
+         STA     C0
+LOOP0    SPUSH  
+         SPUSHI  92
+         SDROP  
+         SADD   
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         LDI     2
+         STA     C1
+LOOP1    SPOP   
+         SPUSH  
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         SDROP  
+SKIP0    LDI     2
+         STA     C2
+LOOP2    BRP     SKIP1
+         SPUSHI  20
+         SPUSHI  96
+         SMIN   
+         SDROP  
+SKIP1    CALL    F0
+         SUB     V0
+         OUT    
+         SDROP  
+         LDA     C2
+         SUB     ONE
+         STA     C2
+         BRP     LOOP2
+         SPUSHI  55
+         OUT    
+         ADD     V2
+         SDROP  
+         HLT    
+F0       SPUSHI  55
+         OUT    
+         SDUP   
+         BRA     SKIP2
+         SPUSHI  1
+         SDIV   
+         SPUSHI  35
+         SDROP  
+SKIP2    SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+C2       DAT     0
+V0       DAT     34
+V1       DAT     16
+V2       DAT     30
+V3       DAT     1
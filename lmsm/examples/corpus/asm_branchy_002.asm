@@ -0,0 +1,51 @@
+         SPUSHI  0
+         OUT    
+         SPOP   
+         SPUSH  
+         SPUSHI  32
+         SPUSHI  26
+         LDI     4
+         STA     C0
+LOOP0    ADD     V0
+         SPOP   
+         OUT    
+         CALL    F0
+         SPUSHI  97
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         SPUSH  
+         SMIN   
+         SDROP  
+         SMIN   
+         SDROP  
+         HLT    
+F0       LDI     0
+         STA     C1
+LOOP1    ADD     V2
+         LDI     17
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         SUB     V3
+         ADD     V0
+         SPUSHI  65
+         SDROP  
+         RET    
+F1       SUB     V3
+         SPUSHI  55
+         OUT    
+         SUB     V0
+         SMAX   
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+V0       DAT     42
+V1       DAT     2
+V2       DAT     10
+V3       DAT     18
@@ -0,0 +1,83 @@
+         LDI     0
+         STA     C0
+LOOP0    SPUSH  
+         BRZ     SKIP0
+         ADD     V1
+         SPUSHI  40
+         SDROP  
+SKIP0    OUT    
+         CALL    F1
+         SDROP  
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         BRZ     SKIP1
+         OUT    
+         ADD     V3
+         ADD     V3
+         SPUSHI  5
+         SDROP  
+SKIP1    LDA     V3
+         SPUSHI  35
+         SPOP   
+         LDI     9
+         LDA     V3
+         BRZ     SKIP2
+         SPUSHI  91
+         SPUSHI  46
+         BRA     SKIP3
+         OUT    
+         OUT    
+SKIP3    LDI     3
+         STA     C1
+LOOP1    CALL    F0
+         SPUSHI  65
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         SDROP  
+         SDROP  
+SKIP2    HLT    
+F0       LDI     3
+         STA     C2
+LOOP2    SPOP   
+         ADD     V2
+         SPUSHI  92
+         LDA     C2
+         SUB     ONE
+         STA     C2
+         BRP     LOOP2
+         SPUSHI  5
+         SDIV   
+         SDUP   
+         LDI     2
+         STA     C3
+LOOP3    ADD     V3
+         CALL    F1
+         LDA     C3
+         SUB     ONE
+         STA     C3
+         BRP     LOOP3
+         SMAX   
+         SMAX   
+         RET    
+F1       BRZ     SKIP4
+         ADD     V0
+         SDUP   
+         SMAX   
+SKIP4    OUT    
+         OUT    
+         LDI     13
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+C2       DAT     0
+C3       DAT     0
+V0       DAT     44
+V1       DAT     21
+V2       DAT     8
+V3       DAT     41
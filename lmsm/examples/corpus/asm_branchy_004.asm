@@ -0,0 +1,85 @@
+         BRP     SKIP0
+         BRP     SKIP1
+         OUT    
+         LDI     98
+SKIP1    SUB     V0
+         SPUSHI  66
+         ADD     V2
+         SDROP  
+SKIP0    SPUSHI  98
+         LDI     70
+         LDI     3
+         STA     C0
+LOOP0    LDI     2
+         STA     C1
+LOOP1    CALL    F0
+         OUT    
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         BRP     SKIP2
+         STA     V2
+         SPOP   
+         SPUSHI  13
+SKIP2    SPUSHI  29
+         SSWAP  
+         SMIN   
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         SPUSHI  3
+         SDIV   
+         BRP     SKIP3
+         LDI     2
+         STA     C2
+LOOP2    SUB     V3
+         OUT    
+         LDA     C2
+         SUB     ONE
+         STA     C2
+         BRP     LOOP2
+         LDI     2
+         STA     C3
+LOOP3    SPUSHI  23
+         SPUSHI  78
+         SDROP  
+         SDROP  
+         LDA     C3
+         SUB     ONE
+         STA     C3
+         BRP     LOOP3
+         BRP     SKIP4
+         LDI     58
+         SPUSH  
+         SDROP  
+SKIP4    LDI     2
+         STA     C4
+LOOP4    LDI     91
+         ADD     V0
+         LDA     C4
+         SUB     ONE
+         STA     C4
+         BRP     LOOP4
+SKIP3    SPUSHI  65
+         OUT    
+         SDROP  
+         SDROP  
+         HLT    
+F0       LDI     36
+         SPUSHI  39
+         SSUB   
+         STA     V1
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+C2       DAT     0
+C3       DAT     0
+C4       DAT     0
+V0       DAT     38
+V1       DAT     21
+V2       DAT     22
+V3       DAT     23
@@ -0,0 +1,76 @@
+         BRA     SKIP0
+         BRZ     SKIP1
+         ADD     V3
+         LDI     97
+SKIP1    SPUSH  
+         LDI     2
+         STA     C0
+LOOP0    ADD     V0
+         ADD     V3
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         SPUSHI  88
+         SADD   
+         SDROP  
+SKIP0    BRP     SKIP2
+         LDI     4
+         STA     C1
+LOOP1    SPUSHI  53
+         SPUSH  
+         SSUB   
+         SDROP  
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         ADD     V2
+         ADD     V1
+         BRP     SKIP3
+         SPUSHI  30
+         SDROP  
+SKIP3    SUB     ZERO
+SKIP2    LDI     41
+         SUB     V0
+         LDI     2
+         STA     C2
+LOOP2    BRA     SKIP4
+         SPUSHI  75
+         OUT    
+         SDROP  
+SKIP4    BRZ     SKIP5
+         OUT    
+         LDI     56
+SKIP5    SUB     V3
+         STA     V1
+         LDA     C2
+         SUB     ONE
+         STA     C2
+         BRP     LOOP2
+         SUB     V0
+         LDI     3
+         STA     C3
+LOOP3    ADD     V2
+         OUT    
+         BRP     SKIP6
+         OUT    
+         SUB     V2
+SKIP6    SPUSHI  55
+         SDROP  
+         LDA     C3
+         SUB     ONE
+         STA     C3
+         BRP     LOOP3
+         ADD     V3
+         HLT    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+C2       DAT     0
+C3       DAT     0
+V0       DAT     15
+V1       DAT     4
+V2       DAT     20
+V3       DAT     41
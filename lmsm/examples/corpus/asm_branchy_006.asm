@@ -0,0 +1,57 @@
+         BRP     SKIP0
+         ADD     V1
+         LDI     3
+         STA     C0
+LOOP0    ADD     V1
+         SPUSHI  99
+         SDROP  
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         LDI     61
+         ADD     V1
+SKIP0    OUT    
+         SPUSHI  97
+         ADD     V2
+         STA     V2
+         SPUSH  
+         BRA     SKIP1
+         OUT    
+         LDI     3
+         STA     C1
+LOOP1    LDA     V0
+         SPUSHI  60
+         SSUB   
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         SADD   
+         SDUP   
+SKIP1    SSWAP  
+         SMAX   
+         SDROP  
+         HLT    
+F0       SDUP   
+         SMUL   
+         SPUSH  
+         OUT    
+         SDROP  
+         SSUB   
+         SDROP  
+         RET    
+F1       SSUB   
+         OUT    
+         LDA     V1
+         OUT    
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+V0       DAT     8
+V1       DAT     18
+V2       DAT     1
+V3       DAT     47
@@ -0,0 +1,76 @@
+         LDI     2
+         STA     C0
+LOOP0    SPUSHI  30
+         LDI     3
+         STA     C1
+LOOP1    SPUSHI  61
+         SDROP  
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         OUT    
+         LDI     16
+         SDROP  
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         LDI     4
+         STA     C2
+LOOP2    ADD     V3
+         LDI     0
+         STA     C3
+LOOP3    SPUSHI  57
+         OUT    
+         SDROP  
+         LDA     C3
+         SUB     ONE
+         STA     C3
+         BRP     LOOP3
+         LDI     78
+         LDI     0
+         STA     C4
+LOOP4    SPUSHI  44
+         OUT    
+         SDROP  
+         LDA     C4
+         SUB     ONE
+         STA     C4
+         BRP     LOOP4
+         LDA     C2
+         SUB     ONE
+         STA     C2
+         BRP     LOOP2
+         LDI     3
+         STA     C5
+LOOP5    ADD     V3
+         STA     V0
+         SPUSHI  88
+         SPUSHI  37
+         SSUB   
+         SDROP  
+         LDA     C5
+         SUB     ONE
+         STA     C5
+         BRP     LOOP5
+         LDI     35
+         LDA     V0
+         SPUSHI  55
+         SDUP   
+         OUT    
+         SMIN   
+         SDROP  
+         HLT    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+C2       DAT     0
+C3       DAT     0
+C4       DAT     0
+C5       DAT     0
+V0       DAT     6
+V1       DAT     4
+V2       DAT     34
+V3       DAT     14
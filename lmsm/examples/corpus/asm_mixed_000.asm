@@ -0,0 +1,62 @@
+         ADD     V2
+         LDI     2
+         STA     C0
+LOOP0    SPUSHI  22
+         SDUP   
+         OUT    
+         SUB     V1
+         SDROP  
+         SDROP  
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         OUT    
+         SUB     V2
+         SPUSHI  44
+         LDI     35
+         ADD     V1
+         LDI     86
+         SDROP  
+         HLT    
+F0       SPUSHI  26
+         SPUSHI  85
+         LDI     72
+         LDA     V0
+         SDROP  
+         SDROP  
+         RET    
+F1       BRZ     SKIP0
+         SSUB   
+         OUT    
+         SPUSHI  83
+SKIP0    LDI     2
+         STA     C1
+LOOP1    OUT    
+         CALL    F2
+         SPUSHI  69
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         BRA     SKIP1
+         LDA     V1
+         OUT    
+SKIP1    ADD     V0
+         SMIN   
+         RET    
+F2       OUT    
+         LDI     58
+         SPUSH  
+         LDI     42
+         SDROP  
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+V0       DAT     28
+V1       DAT     28
+V2       DAT     11
+V3       DAT     41
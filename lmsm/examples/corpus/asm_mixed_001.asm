@@ -0,0 +1,33 @@
+         CALL    F0
+         SPUSHI  2
+         SDIV   
+         BRA     SKIP0
+         OUT    
+         LDI     30
+         SPUSHI  36
+         LDA     V3
+         SMAX   
+SKIP0    OUT    
+         SDROP  
+         ADD     V1
+         SUB     V0
+         SPUSHI  32
+         SDROP  
+         HLT    
+F0       ADD     V0
+         OUT    
+         SPUSHI  5
+         OUT    
+         RET    
+F1       ADD     V3
+         SDROP  
+         SUB     V0
+         SPUSHI  81
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+V0       DAT     22
+V1       DAT     9
+V2       DAT     16
+V3       DAT     11
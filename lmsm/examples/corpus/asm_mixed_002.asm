@@ -0,0 +1,60 @@
+         SPUSHI  6
+         LDI     11
+         SPUSHI  56
+         LDI     2
+         SPUSHI  1
+         SDIV   
+         ADD     V1
+         OUT    
+         SUB     V0
+         SADD   
+         SDROP  
+         HLT    
+F0       BRZ     SKIP0
+         SPUSHI  92
+         ADD     V3
+         SDROP  
+SKIP0    ADD     V3
+         SPUSHI  6
+         SPUSH  
+         SADD   
+         SDROP  
+         RET    
+F1       LDI     4
+         STA     C0
+LOOP0    SPOP   
+         SPOP   
+         SPUSHI  4
+         SPUSHI  86
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         BRZ     SKIP1
+         CALL    F2
+         OUT    
+         SPUSHI  42
+SKIP1    STA     V2
+         BRP     SKIP2
+         CALL    F2
+         SPUSHI  1
+         SDIV   
+         SPUSHI  69
+SKIP2    SDROP  
+         SDROP  
+         RET    
+F2       SPUSH  
+         OUT    
+         STA     V1
+         SDUP   
+         SSUB   
+         SDROP  
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+V0       DAT     16
+V1       DAT     23
+V2       DAT     35
+V3       DAT     9
@@ -0,0 +1,29 @@
+         SPUSHI  3
+         SPUSHI  1
+         SDIV   
+         BRA     SKIP0
+         SPUSHI  50
+         SPUSH  
+         OUT    
+         SPUSHI  6
+         SDIV   
+         SSUB   
+         SSUB   
+SKIP0    OUT    
+         SDUP   
+         BRZ     SKIP1
+         LDA     V3
+         OUT    
+         OUT    
+         SPUSHI  3
+         SDIV   
+SKIP1    SPOP   
+         ADD     V1
+         SDROP  
+         HLT    
+ONE      DAT     1
+ZERO     DAT     0
+V0       DAT     6
+V1       DAT     43
+V2       DAT     13
+V3       DAT     34
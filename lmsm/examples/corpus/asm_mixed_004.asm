@@ -0,0 +1,53 @@
+         SPUSHI  95
+         SPUSHI  58
+         LDI     1
+         STA     C0
+LOOP0    SADD   
+         SUB     V2
+         SPUSHI  78
+         CALL    F0
+         SPUSHI  20
+         SPUSHI  16
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         SUB     V3
+         CALL    F0
+         BRA     SKIP0
+         ADD     V0
+         BRA     SKIP1
+         SPUSHI  33
+         OUT    
+         SDROP  
+SKIP1    OUT    
+         SPUSHI  90
+         SDROP  
+SKIP0    SUB     V0
+         SPUSHI  10
+         SDROP  
+         HLT    
+F0       BRZ     SKIP2
+         LDI     80
+         SUB     V1
+SKIP2    OUT    
+         LDI     3
+         STA     C1
+LOOP1    LDA     V0
+         ADD     V2
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         ADD     V2
+         SDROP  
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+V0       DAT     21
+V1       DAT     7
+V2       DAT     9
+V3       DAT     9
@@ -0,0 +1,61 @@
+         SPUSHI  33
+         SDROP  
+         ADD     V2
+         ADD     V2
+         ADD     V1
+         LDI     4
+         STA     C0
+LOOP0    BRZ     SKIP0
+         OUT    
+         OUT    
+SKIP0    BRP     SKIP1
+         SPUSHI  43
+         SPOP   
+SKIP1    SPUSHI  62
+         ADD     V1
+         SDROP  
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         OUT    
+         ADD     V0
+         HLT    
+F0       SMIN   
+         LDI     2
+         STA     C1
+LOOP1    SDUP   
+         SPUSHI  6
+         SDIV   
+         SDROP  
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         ADD     V3
+         OUT    
+         SDROP  
+         RET    
+F1       CALL    F2
+         OUT    
+         SPUSHI  6
+         SDIV   
+         OUT    
+         RET    
+F2       BRZ     SKIP2
+         OUT    
+         ADD     V0
+SKIP2    STA     V3
+         SPUSHI  1
+         SPUSHI  78
+         SSUB   
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+V0       DAT     19
+V1       DAT     16
+V2       DAT     19
+V3       DAT     24
@@ -0,0 +1,48 @@
+         LDA     V0
+         ADD     V0
+         OUT    
+         OUT    
+         ADD     V1
+         ADD     V0
+         LDA     V1
+         SPUSH  
+         SDROP  
+         HLT    
+F0       OUT    
+         LDI     3
+         STA     C0
+LOOP0    SPUSH  
+         CALL    F2
+         SPUSHI  33
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         SPUSHI  32
+         SPOP   
+         SDROP  
+         RET    
+F1       CALL    F2
+         SPUSH  
+         SPUSHI  75
+         STA     V0
+         SMAX   
+         SDROP  
+         RET    
+F2       ADD     V1
+         LDI     67
+         SPOP   
+         BRA     SKIP0
+         SPUSHI  7
+         SDIV   
+         SDUP   
+         SSUB   
+SKIP0    SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+V0       DAT     4
+V1       DAT     44
+V2       DAT     47
+V3       DAT     37
@@ -0,0 +1,44 @@
+         SUB     V1
+         BRA     SKIP0
+         SPUSHI  6
+         SPUSHI  78
+         SUB     V0
+         OUT    
+         SADD   
+         SDROP  
+SKIP0    OUT    
+         ADD     V0
+         OUT    
+         BRZ     SKIP1
+         OUT    
+         LDI     0
+         STA     C0
+LOOP0    OUT    
+         SPUSHI  14
+         SDROP  
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         SPUSH  
+         ADD     V1
+         SDROP  
+SKIP1    BRP     SKIP2
+         SUB     V1
+         BRA     SKIP3
+         SPUSHI  53
+         SPOP   
+SKIP3    SPUSHI  90
+         SPUSHI  92
+         SMAX   
+         SDROP  
+SKIP2    SPUSH  
+         SDROP  
+         HLT    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+V0       DAT     15
+V1       DAT     4
+V2       DAT     6
+V3       DAT     45
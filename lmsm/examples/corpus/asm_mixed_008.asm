@@ -0,0 +1,50 @@
+         SPUSHI  35
+         SPUSH  
+         SDUP   
+         BRZ     SKIP0
+         BRZ     SKIP1
+         OUT    
+         LDI     71
+SKIP1    SUB     V1
+         ADD     V0
+         CALL    F0
+         SDROP  
+SKIP0    CALL    F0
+         OUT    
+         LDI     3
+         STA     C0
+LOOP0    ADD     V1
+         OUT    
+         LDI     0
+         STA     C1
+LOOP1    OUT    
+         CALL    F0
+         SADD   
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         ADD     V1
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         SSWAP  
+         SSUB   
+         SDROP  
+         SDROP  
+         SDROP  
+         HLT    
+F0       SPUSH  
+         OUT    
+         SPUSHI  95
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+V0       DAT     19
+V1       DAT     45
+V2       DAT     28
+V3       DAT     50
@@ -0,0 +1,39 @@
+         LDA     V1
+         ADD     V1
+         SPUSH  
+         BRZ     SKIP0
+         OUT    
+         SPOP   
+         SPUSHI  43
+         SPUSHI  33
+         SMIN   
+SKIP0    OUT    
+         BRP     SKIP1
+         SPUSHI  35
+         SDROP  
+         SDUP   
+         SUB     V2
+         SMAX   
+SKIP1    SDUP   
+         SDROP  
+         SDROP  
+         HLT    
+F0       SPUSH  
+         OUT    
+         CALL    F1
+         SUB     V2
+         SDROP  
+         RET    
+F1       SPUSH  
+         SPUSHI  1
+         SSWAP  
+         OUT    
+         SDROP  
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+V0       DAT     10
+V1       DAT     1
+V2       DAT     41
+V3       DAT     46
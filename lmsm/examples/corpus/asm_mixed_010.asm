@@ -0,0 +1,66 @@
+         ADD     V1
+         CALL    F1
+         ADD     V1
+         SPUSHI  59
+         LDI     0
+         STA     C0
+LOOP0    OUT    
+         ADD     V3
+         LDI     2
+         STA     C1
+LOOP1    SPUSHI  7
+         SDIV   
+         CALL    F1
+         SDROP  
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         LDI     3
+         STA     C2
+LOOP2    CALL    F0
+         SPUSHI  9
+         SDIV   
+         SPUSHI  94
+         LDA     C2
+         SUB     ONE
+         STA     C2
+         BRP     LOOP2
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         STA     V1
+         SADD   
+         LDA     V2
+         SDROP  
+         HLT    
+F0       LDI     75
+         SDROP  
+         LDI     3
+         STA     C3
+LOOP3    OUT    
+         OUT    
+         LDA     C3
+         SUB     ONE
+         STA     C3
+         BRP     LOOP3
+         LDI     20
+         RET    
+F1       SPUSHI  40
+         SPUSHI  23
+         LDA     V1
+         SPUSHI  77
+         SDROP  
+         SMAX   
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+C2       DAT     0
+C3       DAT     0
+V0       DAT     39
+V1       DAT     4
+V2       DAT     44
+V3       DAT     31
@@ -0,0 +1,71 @@
+         SPUSHI  84
+         ADD     V1
+         SPUSH  
+         OUT    
+         BRP     SKIP0
+         CALL    F0
+         SPUSHI  6
+         SDIV   
+         SMAX   
+         LDI     0
+         STA     C0
+LOOP0    SPUSHI  41
+         SDUP   
+         SDROP  
+         SMAX   
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+SKIP0    BRP     SKIP1
+         CALL    F1
+         SPUSHI  81
+         LDI     0
+         STA     C1
+LOOP1    SPUSHI  86
+         SPUSHI  2
+         SDIV   
+         SDROP  
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         LDI     3
+         STA     C2
+LOOP2    OUT    
+         SPUSHI  1
+         SDROP  
+         LDA     C2
+         SUB     ONE
+         STA     C2
+         BRP     LOOP2
+         SPUSHI  32
+SKIP1    SDROP  
+         SPUSHI  77
+         SDROP  
+         SDROP  
+         HLT    
+F0       SPUSHI  23
+         OUT    
+         SPUSHI  7
+         SDIV   
+         SPUSHI  42
+         SMIN   
+         RET    
+F1       SDUP   
+         OUT    
+         LDI     84
+         OUT    
+         SMUL   
+         SDROP  
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+C2       DAT     0
+V0       DAT     3
+V1       DAT     46
+V2       DAT     5
+V3       DAT     37
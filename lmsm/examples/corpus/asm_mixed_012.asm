@@ -0,0 +1,48 @@
+         OUT    
+         ADD     V1
+         SUB     V2
+         OUT    
+         LDI     85
+         STA     V3
+         OUT    
+         SPUSHI  33
+         SDROP  
+         HLT    
+F0       OUT    
+         BRZ     SKIP0
+         CALL    F1
+         ADD     V2
+         SPUSHI  75
+SKIP0    ADD     V2
+         STA     V1
+         SDROP  
+         RET    
+F1       SPUSHI  59
+         BRP     SKIP1
+         SSWAP  
+         CALL    F2
+         SPUSHI  49
+         SPUSHI  79
+SKIP1    SSWAP  
+         SPUSHI  91
+         SMUL   
+         SSUB   
+         SDROP  
+         RET    
+F2       LDI     8
+         ADD     V3
+         BRA     SKIP2
+         SPUSHI  9
+         SDIV   
+         OUT    
+SKIP2    SPUSH  
+         SDROP  
+         SDROP  
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+V0       DAT     35
+V1       DAT     41
+V2       DAT     23
+V3       DAT     25
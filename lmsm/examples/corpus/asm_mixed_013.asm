@@ -0,0 +1,30 @@
+         SPUSH  
+         SDUP   
+         SPUSHI  87
+         SUB     V3
+         LDI     45
+         ADD     V3
+         BRP     SKIP0
+         OUT    
+         OUT    
+         SSWAP  
+         LDI     66
+SKIP0    BRZ     SKIP1
+         LDA     V2
+         BRP     SKIP2
+         STA     V1
+         SPUSHI  56
+         SDROP  
+SKIP2    SPUSHI  97
+         OUT    
+         SADD   
+SKIP1    SDROP  
+         SDROP  
+         SDROP  
+         HLT    
+ONE      DAT     1
+ZERO     DAT     0
+V0       DAT     12
+V1       DAT     12
+V2       DAT     36
+V3       DAT     29
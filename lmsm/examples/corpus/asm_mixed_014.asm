@@ -0,0 +1,43 @@
+         SPUSHI  31
+         ADD     V2
+         LDI     4
+         STA     C0
+LOOP0    OUT    
+         SPUSH  
+         BRZ     SKIP0
+         SPOP   
+         SPUSH  
+SKIP0    CALL    F0
+         SSUB   
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         OUT    
+         OUT    
+         LDA     V3
+         SPUSH  
+         ADD     V1
+         SDROP  
+         SDROP  
+         HLT    
+F0       SUB     V3
+         LDI     4
+         STA     C1
+LOOP1    ADD     V2
+         ADD     V2
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         SUB     V2
+         ADD     V0
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+V0       DAT     24
+V1       DAT     35
+V2       DAT     19
+V3       DAT     1
@@ -0,0 +1,33 @@
+         LDA     V3
+         ADD     V1
+         OUT    
+         SPUSH  
+         SDUP   
+         SPUSHI  68
+         STA     V1
+         BRA     SKIP0
+         LDI     4
+         STA     C0
+LOOP0    SDUP   
+         ADD     V3
+         SSUB   
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         SADD   
+         SPUSHI  8
+         SDIV   
+         ADD     V0
+         SPUSHI  64
+SKIP0    SDROP  
+         SMUL   
+         SDROP  
+         HLT    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+V0       DAT     48
+V1       DAT     21
+V2       DAT     2
+V3       DAT     23
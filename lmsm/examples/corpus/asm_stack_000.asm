@@ -0,0 +1,69 @@
+         SPUSHI  67
+         SPUSHI  77
+         BRZ     SKIP0
+         SSWAP  
+         CALL    F1
+         ADD     V1
+         LDI     99
+         SPUSHI  71
+         SPUSHI  24
+SKIP0    SPUSHI  67
+         SPUSHI  17
+         CALL    F1
+         LDI     2
+         STA     C0
+LOOP0    LDI     4
+         STA     C1
+LOOP1    SPUSHI  35
+         OUT    
+         SMUL   
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         OUT    
+         LDI     2
+         STA     C2
+LOOP2    SDUP   
+         SPOP   
+         LDA     C2
+         SUB     ONE
+         STA     C2
+         BRP     LOOP2
+         SDUP   
+         SMIN   
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         LDA     V0
+         SDROP  
+         SDROP  
+         HLT    
+F0       ADD     V2
+         SPUSHI  6
+         SDIV   
+         SPUSHI  0
+         SSWAP  
+         SMAX   
+         SDROP  
+         RET    
+F1       SDUP   
+         BRZ     SKIP1
+         STA     V2
+         SDUP   
+         SMIN   
+SKIP1    SSWAP  
+         SDROP  
+         SDROP  
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+C2       DAT     0
+V0       DAT     17
+V1       DAT     34
+V2       DAT     28
+V3       DAT     23
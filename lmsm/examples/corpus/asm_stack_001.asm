@@ -0,0 +1,79 @@
+         LDI     3
+         STA     C0
+LOOP0    SPUSHI  26
+         SDROP  
+         OUT    
+         SPUSH  
+         SDROP  
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         SPUSHI  35
+         BRA     SKIP0
+         SPUSH  
+         LDI     2
+         STA     C1
+LOOP1    STA     V1
+         OUT    
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         SPOP   
+         SPUSHI  93
+         SMAX   
+SKIP0    SDUP   
+         SPUSH  
+         SPUSHI  81
+         SPUSHI  9
+         LDI     4
+         STA     C2
+LOOP2    CALL    F2
+         OUT    
+         OUT    
+         SPUSHI  53
+         LDA     C2
+         SUB     ONE
+         STA     C2
+         BRP     LOOP2
+         SSUB   
+         SADD   
+         SMAX   
+         SDROP  
+         SDROP  
+         HLT    
+F0       CALL    F2
+         SPUSHI  4
+         CALL    F1
+         ADD     V3
+         SPUSHI  6
+         RET    
+F1       CALL    F2
+         ADD     V1
+         SPUSHI  5
+         SDIV   
+         SDROP  
+         RET    
+F2       SDUP   
+         BRZ     SKIP1
+         SPUSHI  87
+         SDUP   
+         SADD   
+         SMUL   
+SKIP1    SPUSHI  4
+         SDUP   
+         SDROP  
+         SDROP  
+         SMIN   
+         SMUL   
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+C2       DAT     0
+V0       DAT     21
+V1       DAT     3
+V2       DAT     17
+V3       DAT     34
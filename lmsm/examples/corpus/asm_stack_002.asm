@@ -0,0 +1,60 @@
+         SPUSHI  34
+         BRP     SKIP0
+         SPUSHI  84
+         SDROP  
+         OUT    
+         SPUSHI  60
+         SSUB   
+SKIP0    LDI     4
+         STA     C0
+LOOP0    SPUSHI  50
+         CALL    F0
+         LDI     1
+         STA     C1
+LOOP1    SPOP   
+         SPUSHI  97
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         SPUSH  
+         SMAX   
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         OUT    
+         SPUSH  
+         BRP     SKIP1
+         ADD     V1
+         ADD     V1
+         CALL    F1
+         STA     V0
+         SPUSHI  1
+         SPUSHI  61
+SKIP1    SDROP  
+         SUB     V0
+         SDROP  
+         HLT    
+F0       SPUSHI  0
+         ADD     V2
+         CALL    F1
+         SPUSHI  74
+         SDROP  
+         RET    
+F1       OUT    
+         SSUB   
+         SPUSHI  71
+         SPUSHI  4
+         SDIV   
+         SDROP  
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+V0       DAT     42
+V1       DAT     25
+V2       DAT     43
+V3       DAT     4
@@ -0,0 +1,71 @@
+         LDA     V2
+         SPUSH  
+         STA     V1
+         CALL    F0
+         LDI     1
+         STA     C0
+LOOP0    SDUP   
+         OUT    
+         SPUSHI  5
+         SDIV   
+         SPUSHI  7
+         SDIV   
+         SDROP  
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         LDI     30
+         SPUSHI  1
+         SDIV   
+         LDI     4
+         STA     C1
+LOOP1    LDA     V0
+         LDI     1
+         STA     C2
+LOOP2    SPUSH  
+         SDROP  
+         LDA     C2
+         SUB     ONE
+         STA     C2
+         BRP     LOOP2
+         SPUSHI  1
+         SDIV   
+         SPOP   
+         SPUSHI  11
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         SDROP  
+         SDROP  
+         HLT    
+F0       SPUSHI  43
+         BRZ     SKIP0
+         SPUSHI  81
+         SUB     V0
+         SMUL   
+SKIP0    BRP     SKIP1
+         OUT    
+         SPOP   
+         SPUSHI  83
+SKIP1    LDI     3
+         STA     C3
+LOOP3    SPOP   
+         ADD     V2
+         SPUSHI  39
+         LDA     C3
+         SUB     ONE
+         STA     C3
+         BRP     LOOP3
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+C2       DAT     0
+C3       DAT     0
+V0       DAT     36
+V1       DAT     50
+V2       DAT     19
+V3       DAT     7
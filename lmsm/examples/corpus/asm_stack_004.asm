@@ -0,0 +1,50 @@
+         SPUSHI  45
+         BRA     SKIP0
+         LDI     4
+         STA     C0
+LOOP0    SPUSHI  83
+         CALL    F0
+         SMAX   
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         OUT    
+         SPUSHI  81
+         SPUSH  
+         SSUB   
+         SADD   
+SKIP0    SUB     V0
+         STA     V2
+         SDROP  
+         LDI     2
+         STA     C1
+LOOP1    LDI     93
+         OUT    
+         SPUSHI  31
+         CALL    F0
+         SDROP  
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         ADD     V2
+         SPUSHI  17
+         SDROP  
+         HLT    
+F0       SPUSHI  97
+         SPUSH  
+         SDUP   
+         STA     V2
+         SMUL   
+         SDROP  
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+V0       DAT     41
+V1       DAT     43
+V2       DAT     14
+V3       DAT     16
@@ -0,0 +1,33 @@
+         SPUSH  
+         SDROP  
+         SPUSH  
+         SPUSH  
+         SDROP  
+         OUT    
+         OUT    
+         LDI     84
+         SDROP  
+         HLT    
+F0       SPUSHI  3
+         SDIV   
+         OUT    
+         SDUP   
+         LDI     4
+         STA     C0
+LOOP0    SPOP   
+         OUT    
+         SPUSHI  16
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         SDROP  
+         SDROP  
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+V0       DAT     21
+V1       DAT     33
+V2       DAT     33
+V3       DAT     4
@@ -0,0 +1,50 @@
+         BRZ     SKIP0
+         SPUSH  
+         CALL    F0
+         CALL    F0
+         SPUSH  
+         SDROP  
+         SDROP  
+SKIP0    BRZ     SKIP1
+         SPUSHI  58
+         SDUP   
+         LDA     V3
+         SPOP   
+         SDROP  
+SKIP1    BRA     SKIP2
+         SPUSHI  15
+         SPUSH  
+         SUB     V0
+         SDUP   
+         SMUL   
+         SDROP  
+         SDROP  
+SKIP2    BRP     SKIP3
+         BRA     SKIP4
+         SPUSH  
+         ADD     V3
+         SDROP  
+SKIP4    SPUSHI  31
+         CALL    F0
+         ADD     V0
+         SDROP  
+SKIP3    SPUSHI  49
+         CALL    F0
+         LDI     43
+         SPUSHI  2
+         SDIV   
+         SDROP  
+         HLT    
+F0       SPUSHI  49
+         SUB     V2
+         SPUSH  
+         OUT    
+         SDROP  
+         SMIN   
+         RET    
+ONE      DAT     1
+ZERO     DAT     0
+V0       DAT     46
+V1       DAT     9
+V2       DAT     35
+V3       DAT     16
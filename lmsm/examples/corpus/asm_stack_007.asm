@@ -0,0 +1,44 @@
+         SPUSHI  26
+         SDUP   
+         SPOP   
+         LDI     1
+         STA     C0
+LOOP0    LDI     25
+         SPUSHI  88
+         SPUSHI  36
+         SPUSH  
+         SDROP  
+         SDROP  
+         SADD   
+         LDA     C0
+         SUB     ONE
+         STA     C0
+         BRP     LOOP0
+         SDROP  
+         LDI     1
+         STA     C1
+LOOP1    BRZ     SKIP0
+         SPUSHI  46
+         ADD     V3
+         SDROP  
+SKIP0    OUT    
+         SPUSHI  20
+         LDA     V3
+         SDROP  
+         LDA     C1
+         SUB     ONE
+         STA     C1
+         BRP     LOOP1
+         SPUSHI  63
+         SPUSHI  92
+         SMIN   
+         SDROP  
+         HLT    
+ONE      DAT     1
+ZERO     DAT     0
+C0       DAT     0
+C1       DAT     0
+V0       DAT     0
+V1       DAT     11
+V2       DAT     20
+V3       DAT     5
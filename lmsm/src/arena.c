@@ -0,0 +1,65 @@
+//
+// Bump allocator for data that lives exactly as long as a single
+// compilation
+//
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_ALIGN(n) (((n) + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1))
+#define ARENA_HEADER_SIZE ARENA_ALIGN(sizeof(lmsm_arena_block))
+
+lmsm_arena *lmsm_arena_create() {
+    lmsm_arena *arena = calloc(1, sizeof(lmsm_arena));
+    arena->next_block_size = ARENA_INITIAL_BLOCK_SIZE;
+    return arena;
+}
+
+void lmsm_arena_delete(lmsm_arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+    lmsm_arena_block *block = arena->blocks;
+    while (block != NULL) {
+        lmsm_arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+void *lmsm_arena_alloc(lmsm_arena *arena, size_t size) {
+    size = ARENA_ALIGN(size);
+    lmsm_arena_block *block = arena->blocks;
+    if (block == NULL || block->size - block->used < size) {
+        size_t block_size = arena->next_block_size;
+        if (block_size < size) {
+            block_size = size;
+        }
+        if (arena->next_block_size < ARENA_MAX_BLOCK_SIZE) {
+            arena->next_block_size *= 2;
+        }
+        block = malloc(ARENA_HEADER_SIZE + block_size);
+        block->size = block_size;
+        block->used = 0;
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+    void *memory = (char *) block + ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+    memset(memory, 0, size);
+    return memory;
+}
+
+char *lmsm_arena_strndup(lmsm_arena *arena, const char *str, size_t length) {
+    char *copy = lmsm_arena_alloc(arena, length + 1);
+    memcpy(copy, str, length);
+    return copy;
+}
+
+char *lmsm_arena_strdup(lmsm_arena *arena, const char *str) {
+    return lmsm_arena_strndup(arena, str, strlen(str));
+}
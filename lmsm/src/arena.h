@@ -0,0 +1,42 @@
+//
+// Bump allocator for data that lives exactly as long as a single
+// compilation
+//
+
+#ifndef LMSM_ARENA_H
+#define LMSM_ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_INITIAL_BLOCK_SIZE 4096
+#define ARENA_MAX_BLOCK_SIZE (1 << 20)
+
+typedef struct lmsm_arena_block {
+    struct lmsm_arena_block *next;
+    size_t size;                 // bytes available after the header
+    size_t used;
+} lmsm_arena_block;
+
+//===================================================================
+//  Allocations are never freed individually; deleting the arena
+//  releases all of them at once
+//===================================================================
+typedef struct lmsm_arena {
+    lmsm_arena_block *blocks;    // the current block, followed by older ones
+    size_t next_block_size;
+} lmsm_arena;
+
+//===================================================================
+//  API
+//===================================================================
+
+lmsm_arena *lmsm_arena_create();
+void lmsm_arena_delete(lmsm_arena *arena);
+
+// returns zeroed memory aligned for any type
+void *lmsm_arena_alloc(lmsm_arena *arena, size_t size);
+
+char *lmsm_arena_strdup(lmsm_arena *arena, const char *str);
+char *lmsm_arena_strndup(lmsm_arena *arena, const char *str, size_t length);
+
+#endif //LMSM_ARENA_H
@@ -0,0 +1,208 @@
+//
+// Batch assembler: builds many .asm and .firth files concurrently and
+// writes a binary image for each one
+//
+
+#include "assembler.h"
+#include "engines.h"
+#include "firth.h"
+#include "source.h"
+#include "srcmap.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ASM_BATCH_MAX_FILES 65536
+#define ASM_BATCH_MAX_THREADS 256
+
+typedef struct asm_batch {
+    char **files;
+    int count;
+    char *out_dir;           // where images go, or NULL to write them next to the sources
+    int options;             // the ASM_ options to assemble with, ASM_SOURCE_MAP also writes a .map sidecar
+    int emit_asm;            // also write the assembly generated for .firth files
+    int next;                // the next file to be claimed by a worker
+    int failures;
+    pthread_mutex_t lock;
+} asm_batch;
+
+//======================================================
+//  Building
+//======================================================
+
+void asm_batch_image_name(asm_batch *batch, char *file, char *image, size_t size) {
+    if (batch->out_dir) {
+        char *base = strrchr(file, '/');
+        snprintf(image, size, "%s/%s.bin", batch->out_dir, base ? base + 1 : file);
+    } else {
+        snprintf(image, size, "%s.bin", file);
+    }
+}
+
+// builds a single file with the worker's context, returns 0 on error
+int asm_batch_build(asm_batch *batch, asm_context *context, char *file) {
+    lmsm_source source;
+    if (!lmsm_source_open(&source, file)) {
+        fprintf(stderr, "%s: unable to read\n", file);
+        return 0;
+    }
+    char *src = source.text;
+    size_t length = strlen(file);
+    firth_compilation_result *firth_result = NULL;
+    asm_compilation_result *result = NULL;
+    int ok = 1;
+    if (length > 6 && strcmp(file + length - 6, ".firth") == 0) {
+        // Firth goes straight to code, the assembly text is only generated when asked for
+        int options = FIRTH_ASSEMBLE | (batch->emit_asm ? FIRTH_EMIT_ASSEMBLY : 0) |
+                      (batch->options & ASM_OPTIMIZE ? FIRTH_OPTIMIZE : 0);
+        firth_result = firth_compile_with_options(src, options, batch->options);
+        result = firth_result->assembled;
+        if (firth_result->error) {
+            fprintf(stderr, "%s: %s\n", file, firth_result->error);
+            ok = 0;
+        } else if (result->error && result->error_line) {
+            fprintf(stderr, "%s: %s at line %d, column %d\n", file, result->error, result->error_line,
+                    result->error_column);
+            ok = 0;
+        } else if (result->error) {
+            fprintf(stderr, "%s: %s\n", file, result->error);
+            ok = 0;
+        }
+        if (firth_result->removed_functions || firth_result->inlined_functions) {
+            fprintf(stderr, "%s: note: removed %d unused (%d slots) / inlined %d function%s\n", file,
+                    firth_result->removed_functions, firth_result->removed_slots, firth_result->inlined_functions,
+                    firth_result->inlined_functions == 1 ? "" : "s");
+        }
+        if (batch->emit_asm) {
+            char asm_file[1100];
+            asm_batch_image_name(batch, file, asm_file, sizeof(asm_file));
+            strcpy(asm_file + strlen(asm_file) - 4, ".asm");
+            FILE *out = fopen(asm_file, "w");
+            if (out == NULL || fputs(firth_result->lmsm_assembly, out) == EOF) {
+                fprintf(stderr, "%s: unable to write '%s'\n", file, asm_file);
+                ok = 0;
+            }
+            if (out && fclose(out) != 0) {
+                ok = 0;
+            }
+        }
+    } else if (!asm_context_assemble(context, src)) {
+        fprintf(stderr, "%s: %s\n", file, context->message);
+        ok = 0;
+    } else {
+        result = context->result;
+    }
+    if (ok) {
+        char image[1024];
+        asm_batch_image_name(batch, file, image, sizeof(image));
+        ok = lmsm_engine_write_image(image, result->code);
+        if (!ok) {
+            fprintf(stderr, "%s: unable to write '%s'\n", file, image);
+        }
+    }
+    if (ok && (batch->options & ASM_SOURCE_MAP)) {
+        char map_file[1100];
+        asm_batch_image_name(batch, file, map_file, sizeof(map_file));
+        strcat(map_file, ".map");
+        lmsm_srcmap *map = lmsm_srcmap_create();
+        lmsm_srcmap_add_assembly(map, file, result, firth_result);
+        ok = lmsm_srcmap_write(map, map_file);
+        if (!ok) {
+            fprintf(stderr, "%s: unable to write '%s'\n", file, map_file);
+        }
+        lmsm_srcmap_delete(map);
+    }
+    if (firth_result) {
+        firth_delete_compilation_result(firth_result);
+    }
+    lmsm_source_close(&source);
+    return ok;
+}
+
+void *asm_batch_worker(void *arg) {
+    asm_batch *batch = arg;
+    asm_context *context = asm_context_create();
+    context->options = batch->options;
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        int index = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+        if (index >= batch->count) {
+            break;
+        }
+        if (!asm_batch_build(batch, context, batch->files[index])) {
+            pthread_mutex_lock(&batch->lock);
+            batch->failures++;
+            pthread_mutex_unlock(&batch->lock);
+        }
+    }
+    asm_context_delete(context);
+    return NULL;
+}
+
+//======================================================
+//  Main
+//======================================================
+
+void asm_batch_usage() {
+    printf("Usage: lmsm_asm [-j threads] [-o dir] [-O] [-g] [--emit-asm] <file or directory>...\n");
+}
+
+int main(int argc, char *argv[]) {
+    asm_batch batch = {0};
+    batch.files = malloc(sizeof(char *) * ASM_BATCH_MAX_FILES);
+    int threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            batch.out_dir = argv[++i];
+        } else if (strcmp(argv[i], "-O") == 0) {
+            batch.options |= ASM_OPTIMIZE;
+        } else if (strcmp(argv[i], "-g") == 0) {
+            batch.options |= ASM_SOURCE_MAP;
+        } else if (strcmp(argv[i], "--emit-asm") == 0) {
+            batch.emit_asm = 1;
+        } else if (argv[i][0] == '-') {
+            asm_batch_usage();
+            return EXIT_FAILURE;
+        } else {
+            batch.count = lmsm_engine_collect_programs(argv[i], batch.files, batch.count, ASM_BATCH_MAX_FILES);
+        }
+    }
+    if (batch.count == 0) {
+        asm_batch_usage();
+        return EXIT_FAILURE;
+    }
+    if (threads < 1) {
+        threads = 1;
+    } else if (threads > ASM_BATCH_MAX_THREADS) {
+        threads = ASM_BATCH_MAX_THREADS;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_t workers[ASM_BATCH_MAX_THREADS];
+    for (int i = 0; i < threads; ++i) {
+        pthread_create(&workers[i], NULL, asm_batch_worker, &batch);
+    }
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&batch.lock);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%d files, %d failed, %d threads, %.0f files/s\n",
+           batch.count, batch.failures, threads, seconds > 0 ? batch.count / seconds : 0);
+    for (int i = 0; i < batch.count; ++i) {
+        free(batch.files[i]);
+    }
+    free(batch.files);
+    return batch.failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
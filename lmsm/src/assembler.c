@@ -6,41 +6,86 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "assembler.h"
+#include "arena.h"
+#include "lexer.h"
 
-char *ASM_ERROR_UNKNOWN_INSTRUCTION = "Unknown Assembly Instruction";
-char *ASM_ERROR_ARG_REQUIRED = "Argument Required";
-char *ASM_ERROR_BAD_LABEL = "Bad Label";
-char *ASM_ERROR_OUT_OF_RANGE = "Number is out of range";
+char *const ASM_ERROR_UNKNOWN_INSTRUCTION = "Unknown Assembly Instruction";
+char *const ASM_ERROR_ARG_REQUIRED = "Argument Required";
+char *const ASM_ERROR_BAD_LABEL = "Bad Label";
+char *const ASM_ERROR_OUT_OF_RANGE = "Number is out of range";
+char *const ASM_ERROR_PROGRAM_TOO_LARGE = "Program does not fit in memory";
+char *const ASM_ERROR_DUPLICATE_LABEL = "Duplicate Label";
+
+#define ASM_SYMBOL_TABLE_INITIAL_CAPACITY 64
 
 //=========================================================
 //  All the instructions available on the LMSM architecture
 //=========================================================
-const char *INSTRUCTIONS[28] =
-        {"ADD", "SUB", "LDA", "STA", "BRA", "BRZ", "BRP", "INP", "OUT", "HLT", "COB", "DAT",
-         "LDI",
-         "JAL", "CALL", "RET",
-         "SPUSH", "SPUSHI", "SPOP", "SDUP", "SDROP", "SSWAP", "SADD", "SSUB", "SMAX", "SMIN", "SMUL", "SDIV"
-        };
-const int INSTRUCTION_COUNT = 28;
-
-//===================================================================
-//  All the instructions that require an arg on the LMSM architecture
-//===================================================================
-const char *ARG_INSTRUCTIONS[11] =
-        {"ADD", "SUB", "LDA", "STA", "BRA", "BRZ", "BRP", "DAT",
-         "LDI",
-         "CALL",
-         "SPUSHI"
-        };
-const int ARG_INSTRUCTION_COUNT = 11;
+const asm_opcode_info ASM_OPCODES[] = {
+        [ASM_ADD] = {"ADD", {100}, 1, 1},
+        [ASM_SUB] = {"SUB", {200}, 1, 1},
+        [ASM_LDA] = {"LDA", {500}, 1, 1},
+        [ASM_STA] = {"STA", {300}, 1, 1},
+        [ASM_BRA] = {"BRA", {600}, 1, 1},
+        [ASM_BRZ] = {"BRZ", {700}, 1, 1},
+        [ASM_BRP] = {"BRP", {800}, 1, 1},
+        [ASM_INP] = {"INP", {901}, 1, 0},
+        [ASM_OUT] = {"OUT", {902}, 1, 0},
+        [ASM_HLT] = {"HLT", {0}, 1, 0},
+        [ASM_COB] = {"COB", {0}, 1, 0},
+        [ASM_DAT] = {"DAT", {0}, 1, 1},
+        [ASM_LDI] = {"LDI", {400}, 1, 1},
+        [ASM_JAL] = {"JAL", {910}, 1, 0},
+        [ASM_CALL] = {"CALL", {400, 920, 910}, 3, 1},  // LDI target; SPUSH; JAL
+        [ASM_RET] = {"RET", {911}, 1, 0},
+        [ASM_SPUSH] = {"SPUSH", {920}, 1, 0},
+        [ASM_SPUSHI] = {"SPUSHI", {400, 920}, 2, 1},   // LDI value; SPUSH
+        [ASM_SPOP] = {"SPOP", {921}, 1, 0},
+        [ASM_SDUP] = {"SDUP", {922}, 1, 0},
+        [ASM_SDROP] = {"SDROP", {923}, 1, 0},
+        [ASM_SSWAP] = {"SSWAP", {924}, 1, 0},
+        [ASM_SADD] = {"SADD", {930}, 1, 0},
+        [ASM_SSUB] = {"SSUB", {931}, 1, 0},
+        [ASM_SMAX] = {"SMAX", {934}, 1, 0},
+        [ASM_SMIN] = {"SMIN", {935}, 1, 0},
+        [ASM_SMUL] = {"SMUL", {932}, 1, 0},
+        [ASM_SDIV] = {"SDIV", {933}, 1, 0},
+        [ASM_LDOVL] = {"LDOVL", {940}, 1, 0},     // host-assisted, see overlay.h
+        [ASM_UNKNOWN] = {"", {0}, 1, 0},
+};
+
+//=========================================================
+//  Perfect hash of the mnemonics: the first, second and last
+//  characters and the length select a unique slot
+//=========================================================
+#define ASM_MNEMONIC_HASH(s, len) \
+    (((unsigned) (s)[0] * 4 + (unsigned) (s)[1] * 11 + (unsigned) (s)[(len) - 1] * 28 + (len)) & 63)
+
+const asm_opcode ASM_MNEMONIC_TABLE[64] = {
+        ASM_SPOP, ASM_INP, ASM_UNKNOWN, ASM_UNKNOWN, ASM_UNKNOWN, ASM_UNKNOWN,
+        ASM_JAL, ASM_STA, ASM_UNKNOWN, ASM_UNKNOWN, ASM_UNKNOWN, ASM_SADD,
+        ASM_UNKNOWN, ASM_UNKNOWN, ASM_DAT, ASM_UNKNOWN, ASM_UNKNOWN, ASM_BRP,
+        ASM_UNKNOWN, ASM_UNKNOWN, ASM_UNKNOWN, ASM_UNKNOWN, ASM_OUT, ASM_HLT,
+        ASM_UNKNOWN, ASM_SSUB, ASM_UNKNOWN, ASM_LDI, ASM_UNKNOWN, ASM_UNKNOWN,
+        ASM_UNKNOWN, ASM_UNKNOWN, ASM_UNKNOWN, ASM_SPUSH, ASM_SSWAP, ASM_ADD,
+        ASM_SDIV, ASM_UNKNOWN, ASM_UNKNOWN, ASM_SMIN, ASM_UNKNOWN, ASM_BRZ,
+        ASM_UNKNOWN, ASM_CALL, ASM_COB, ASM_BRA, ASM_SUB, ASM_SMUL,
+        ASM_UNKNOWN, ASM_LDOVL, ASM_RET, ASM_UNKNOWN, ASM_UNKNOWN, ASM_UNKNOWN,
+        ASM_UNKNOWN, ASM_UNKNOWN, ASM_UNKNOWN, ASM_UNKNOWN, ASM_UNKNOWN, ASM_LDA,
+        ASM_SDUP, ASM_SDROP, ASM_SPUSHI, ASM_SMAX,
+};
 
 //======================================================
 // Constructors/Destructors
 //======================================================
 
-asm_instruction * asm_make_instruction(char* type, char *label, char *label_reference, int value, asm_instruction * predecessor) {
-    asm_instruction *new_instruction = calloc(1, sizeof(asm_instruction));
+// allocates from the arena if there is one, otherwise from the heap
+asm_instruction * asm_make_opcode_instruction(lmsm_arena *arena, char* type, asm_opcode opcode, char *label,
+                                              char *label_reference, int value, asm_instruction * predecessor) {
+    asm_instruction *new_instruction = arena ? lmsm_arena_alloc(arena, sizeof(asm_instruction))
+                                             : calloc(1, sizeof(asm_instruction));
     new_instruction->instruction = type;
+    new_instruction->opcode = opcode;
     new_instruction->label = label;
     new_instruction->label_reference = label_reference;
     new_instruction->value = value;
@@ -52,149 +97,356 @@ asm_instruction * asm_make_instruction(char* type, char *label, char *label_refe
         new_instruction->offset = 0;
     }
 
-    if (strcmp("CALL", new_instruction->instruction) == 0) {
-        new_instruction->slots = 3;
-    } else if (strcmp("SPUSHI", new_instruction->instruction) == 0) {
-        new_instruction->slots = 2;
-    } else {
-        new_instruction->slots = 1;
-    }
+    new_instruction->slots = ASM_OPCODES[opcode].slots;
     return new_instruction;
 }
 
+asm_instruction * asm_make_instruction(char* type, char *label, char *label_reference, int value, asm_instruction * predecessor) {
+    return asm_make_opcode_instruction(NULL, type, asm_lookup_opcode(type), label, label_reference, value, predecessor);
+}
+
 void asm_delete_instruction(asm_instruction *instruction) {
-    if (instruction == NULL) {
-        return;
+    while (instruction != NULL) {
+        asm_instruction *next = instruction->next;
+        free(instruction);
+        instruction = next;
     }
-    asm_delete_instruction(instruction->next);
-    free(instruction);
 }
 
 asm_compilation_result * asm_make_compilation_result() {
     asm_compilation_result *result = calloc(1, sizeof(asm_compilation_result));
+    result->arena = lmsm_arena_create();
     return result;
 }
 
 void asm_delete_compilation_result(asm_compilation_result *result) {
-    asm_delete_instruction(result->root);
+    if (!result->arena_owns_instructions) {  // put together by hand
+        asm_delete_instruction(result->root);
+    }
+    lmsm_arena_delete(result->arena);
     free(result);
 }
 
 //======================================================
-// Helpers
+// Symbol Table
 //======================================================
-int asm_is_instruction(char * token) {
-    for (int i = 0; i < INSTRUCTION_COUNT; ++i) {
-        if (strcmp(token, INSTRUCTIONS[i]) == 0) {
-            return 1;
-        }
+
+asm_symbol_table * asm_make_symbol_table(lmsm_arena *arena) {
+    asm_symbol_table *table = lmsm_arena_alloc(arena, sizeof(asm_symbol_table));
+    table->arena = arena;
+    table->capacity = ASM_SYMBOL_TABLE_INITIAL_CAPACITY;
+    table->slots = lmsm_arena_alloc(arena, table->capacity * sizeof(asm_symbol));
+    return table;
+}
+
+unsigned int asm_hash_name(const char *name, int length) {
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < length; ++i) {
+        hash ^= (unsigned char) name[i];
+        hash *= 16777619u;
     }
-    return 0;
+    return hash;
 }
 
-int asm_instruction_requires_arg(char * token) {
-    for (int i = 0; i < ARG_INSTRUCTION_COUNT; ++i) {
-        if (strcmp(token, ARG_INSTRUCTIONS[i]) == 0) {
-            return 1;
-        }
+// the slot holding name, or the empty slot where it belongs
+asm_symbol *asm_probe_symbol(asm_symbol_table *table, const char *name, int length) {
+    unsigned int mask = table->capacity - 1;
+    unsigned int index = asm_hash_name(name, length) & mask;
+    while (table->slots[index].name != NULL &&
+           (strncmp(table->slots[index].name, name, length) != 0 || table->slots[index].name[length] != '\0')) {
+        index = (index + 1) & mask;
     }
-    return 0;
+    return &table->slots[index];
 }
 
-int asm_is_num(char * token){
-    if (*token == '-') { // allow a leading negative
-        token++;
-        if (*token == '\0') {
-            return 0;
+void asm_grow_symbol_table(asm_symbol_table *table) {
+    asm_symbol *old_slots = table->slots;
+    int old_capacity = table->capacity;
+    table->capacity *= 2;
+    table->slots = lmsm_arena_alloc(table->arena, table->capacity * sizeof(asm_symbol));
+    for (int i = 0; i < old_capacity; ++i) {
+        if (old_slots[i].name != NULL) {
+            *asm_probe_symbol(table, old_slots[i].name, (int) strlen(old_slots[i].name)) = old_slots[i];
         }
     }
-    while (*token != '\0') {
-        if (*token < '0' || '9' < *token) {
-            return 0;
-        }
-        token++;
+}
+
+asm_symbol * asm_intern_symbol_length(asm_symbol_table *table, const char *name, int length) {
+    asm_symbol *symbol = asm_probe_symbol(table, name, length);
+    if (symbol->name != NULL) {
+        return symbol;
     }
-    return 1;
+    if ((table->count + 1) * 4 > table->capacity * 3) {  // keep the load factor under 3/4
+        asm_grow_symbol_table(table);
+        symbol = asm_probe_symbol(table, name, length);
+    }
+    symbol->name = lmsm_arena_strndup(table->arena, name, length);
+    symbol->offset = -1;
+    table->count++;
+    return symbol;
+}
+
+asm_symbol * asm_intern_symbol(asm_symbol_table *table, char *name) {
+    return asm_intern_symbol_length(table, name, (int) strlen(name));
+}
+
+asm_symbol * asm_find_symbol(asm_symbol_table *table, char *name) {
+    asm_symbol *symbol = asm_probe_symbol(table, name, (int) strlen(name));
+    return symbol->name != NULL ? symbol : NULL;
 }
 
-int asm_find_label(asm_instruction *root, char *label) {
-    while (root != NULL) {
-        if (root->label != NULL && strcmp(root->label, label) == 0) {
-            return root->offset;
+// builds the table from the instruction list, for results that were put together by hand
+void asm_build_symbol_table(asm_compilation_result *result) {
+    result->symbols = asm_make_symbol_table(result->arena);
+    for (asm_instruction *current = result->root; current != NULL; current = current->next) {
+        if (current->label != NULL) {
+            asm_symbol *symbol = asm_intern_symbol(result->symbols, current->label);
+            if (symbol->offset == -1) {
+                symbol->offset = current->offset;
+            }
         }
-        root = root->next;
     }
-    return -1;
+}
+
+//======================================================
+// Helpers
+//======================================================
+asm_opcode asm_lookup_opcode_length(const char *token, int length) {
+    if (length < 3 || length > 6) {
+        return ASM_UNKNOWN;
+    }
+    asm_opcode opcode = ASM_MNEMONIC_TABLE[ASM_MNEMONIC_HASH(token, length)];
+    const char *mnemonic = ASM_OPCODES[opcode].mnemonic;
+    if (opcode == ASM_UNKNOWN || strncmp(token, mnemonic, length) != 0 || mnemonic[length] != '\0') {
+        return ASM_UNKNOWN;
+    }
+    return opcode;
+}
+
+asm_opcode asm_lookup_opcode(const char *token) {
+    return asm_lookup_opcode_length(token, (int) strlen(token));
+}
+
+int asm_is_instruction(char * token) {
+    return asm_lookup_opcode(token) != ASM_UNKNOWN;
+}
+
+int asm_is_num(char * token){
+    lmsm_span span = {token, (int) strlen(token), 1, 1};
+    return lmsm_span_is_number(&span);
 }
 
 //======================================================
 // Assembly Parsing/Scanning
 //======================================================
 
-void asm_parse_src(asm_compilation_result * result, char * original_src){
+void asm_report_error(asm_compilation_result *result, char *error, int line, int column) {
+    result->error = error;
+    result->error_line = line;
+    result->error_column = column;
+}
 
-    // copy over so strtok can mutate
-    char * src = calloc(strlen(original_src) + 1, sizeof(char));
-    strcat(src, original_src);
+// writes the words for an instruction, argument is only added if the opcode takes one
+void asm_emit(asm_compilation_result *result, asm_opcode opcode, int offset, int argument) {
+    const asm_opcode_info *info = &ASM_OPCODES[opcode];
+    result->code[offset] = info->words[0] + (info->requires_arg ? argument : 0);
+    for (int i = 1; i < info->slots; ++i) {
+        result->code[offset + i] = info->words[i];
+    }
+}
 
-    asm_instruction * last_instruction = NULL;
-    asm_instruction * current_instruction = NULL;
+void asm_relocate(asm_compilation_result *result, int offset) {
+    if (result->options & ASM_RELOCATABLE) {
+        result->relocations[result->relocation_count++] = offset;
+    }
+}
 
-    char *current_str = strtok(src, " \n");
-    while (current_str != NULL){
-        // [LABEL] INST [VAL] - current_str can either be a label or a value (num)
-        char *type = NULL;
-        char *label = NULL;
-        char *label_ref = NULL;
-        int value = 0;
+void asm_define_label(asm_compilation_result *result, asm_symbol *symbol, int offset) {
+    symbol->offset = offset;
+    for (asm_fixup *fixup = symbol->fixups; fixup != NULL; fixup = fixup->next) {
+        result->code[fixup->offset] += offset;
+        asm_relocate(result, fixup->offset);
+    }
+    symbol->fixups = NULL;
+}
 
-        if(asm_is_instruction(current_str)) {
-            type = current_str;
-            current_str = strtok(NULL, " \n");
-        } else{
-            label = current_str;
-            current_str = strtok(NULL, " \n");
-            if (asm_is_instruction(current_str)){
-                type = current_str;
-                current_str = strtok(NULL, " \n");
-            } else {
-                result->error = ASM_ERROR_UNKNOWN_INSTRUCTION;
-                return;
+void asm_reference_label(asm_compilation_result *result, asm_symbol *symbol, int offset, lmsm_span *token) {
+    if (symbol->offset != -1) {
+        result->code[offset] += symbol->offset;
+        asm_relocate(result, offset);
+    } else {
+        asm_fixup *fixup = lmsm_arena_alloc(result->arena, sizeof(asm_fixup));
+        fixup->offset = offset;
+        fixup->line = token->line;
+        fixup->column = token->column;
+        fixup->next = symbol->fixups;
+        symbol->fixups = fixup;
+    }
+}
+
+// reports the first reference to a label that was never defined
+void asm_check_fixups(asm_compilation_result *result) {
+    asm_fixup *first = NULL;
+    asm_symbol_table *table = result->symbols;
+    for (int i = 0; i < table->capacity; ++i) {
+        for (asm_fixup *fixup = table->slots[i].fixups; fixup != NULL; fixup = fixup->next) {
+            if (first == NULL || fixup->offset < first->offset) {
+                first = fixup;
             }
         }
+    }
+    if (first) {
+        asm_report_error(result, ASM_ERROR_BAD_LABEL, first->line, first->column);
+    }
+}
+
+//======================================================
+// Building Code
+//======================================================
+
+void asm_builder_init(asm_builder *builder, asm_compilation_result *result, int options) {
+    if (result->symbols == NULL) {
+        result->symbols = asm_make_symbol_table(result->arena);
+    }
+    result->arena_owns_instructions = 1;
+    result->options = options;
+    builder->result = result;
+    builder->last = NULL;
+    builder->label = NULL;
+    builder->stopped = 0;
+}
+
+int asm_builder_label(asm_builder *builder, const lmsm_span *name) {
+    asm_compilation_result *result = builder->result;
+    if (builder->stopped) {
+        return 0;
+    }
+    if (builder->label != NULL) {
+        // an instruction has one label, the text parser reads a second as its mnemonic
+        asm_report_error(result, ASM_ERROR_UNKNOWN_INSTRUCTION, name->line, name->column);
+        builder->stopped = 1;
+        return 0;
+    }
+    asm_symbol *symbol = asm_intern_symbol_length(result->symbols, name->start, name->length);
+    if (symbol->offset != -1) {
+        asm_report_error(result, ASM_ERROR_DUPLICATE_LABEL, name->line, name->column);
+        builder->stopped = 1;
+        return 0;
+    }
+    asm_define_label(result, symbol, result->size);
+    builder->label = symbol->name;
+    return 1;
+}
 
-        if (asm_instruction_requires_arg(type)){
-            if (current_str == NULL){
-                result->error = ASM_ERROR_ARG_REQUIRED;
+int asm_builder_instruction(asm_builder *builder, asm_opcode opcode, const lmsm_span *argument,
+                            const lmsm_span *at) {
+    asm_compilation_result *result = builder->result;
+    if (builder->stopped) {
+        return 0;
+    }
+    int offset = result->size;
+    int slots = ASM_OPCODES[opcode].slots;
+    char *label_ref = NULL;
+    int value = 0;
+    if (offset + slots > 100) {
+        asm_report_error(result, ASM_ERROR_PROGRAM_TOO_LARGE, at->line, at->column);
+        builder->stopped = 1;
+        return 0;
+    }
+
+    if (!ASM_OPCODES[opcode].requires_arg) {
+        asm_emit(result, opcode, offset, 0);
+    } else if (argument == NULL) {
+        asm_report_error(result, ASM_ERROR_ARG_REQUIRED, at->line, at->column);
+        builder->stopped = 1;
+        return 0;
+    } else if (lmsm_span_is_number(argument)) {
+        // out of range is reported, but the clamped value is still assembled
+        value = lmsm_span_to_int(argument, 999);
+        if (value > 999) {
+            value = 999;
+            asm_report_error(result, ASM_ERROR_OUT_OF_RANGE, argument->line, argument->column);
+        }
+        if (value < -999) {
+            value = -999;
+            asm_report_error(result, ASM_ERROR_OUT_OF_RANGE, argument->line, argument->column);
+        }
+        asm_emit(result, opcode, offset, value);
+    } else {
+        asm_symbol *symbol = asm_intern_symbol_length(result->symbols, argument->start, argument->length);
+        label_ref = symbol->name;
+        asm_emit(result, opcode, offset, 0);
+        asm_reference_label(result, symbol, offset, (lmsm_span *) argument);
+    }
+
+    if (result->options & ASM_SOURCE_MAP) {
+        asm_source_location location = {offset, slots, at->line, at->column};
+        result->source_map[result->source_map_count++] = location;
+    }
+    if (result->options & ASM_KEEP_INSTRUCTIONS) {
+        asm_instruction *new_inst = asm_make_opcode_instruction(result->arena, ASM_OPCODES[opcode].mnemonic,
+                                                                opcode, builder->label, label_ref, value,
+                                                                builder->last);
+        new_inst->line = at->line;
+        new_inst->column = at->column;
+        if (result->root == NULL) {
+            result->root = new_inst;
+        }
+        builder->last = new_inst;
+    }
+    builder->label = NULL;
+    result->size = offset + slots;
+    return 1;
+}
+
+void asm_parse(asm_builder *builder, char * original_src){
+
+    // the lexer reads the source in place, only label names are copied into the symbol table
+    lmsm_lexer lexer;
+    lmsm_lexer_init(&lexer, original_src);
+    lmsm_span token;
+    int has_token = lmsm_lexer_next(&lexer, &token);
+    asm_compilation_result *result = builder->result;
+
+    while (has_token){
+        // [LABEL] INST [VAL] - the first token can either be a label or an instruction
+        asm_opcode opcode = asm_lookup_opcode_length(token.start, token.length);
+        lmsm_span start = token;
+
+        if (opcode == ASM_UNKNOWN) {
+            if (!asm_builder_label(builder, &token)) {
+                return;
+            }
+            has_token = lmsm_lexer_next(&lexer, &token);
+            opcode = has_token ? asm_lookup_opcode_length(token.start, token.length) : ASM_UNKNOWN;
+            if (opcode == ASM_UNKNOWN) {
+                lmsm_span *bad = has_token ? &token : &start;
+                asm_report_error(result, ASM_ERROR_UNKNOWN_INSTRUCTION, bad->line, bad->column);
                 return;
-            } else{
-                if(asm_is_num(current_str)){
-                    sscanf(current_str, "%d", &value);
-                    if(value > 999){
-                        value = 999;
-                        result->error = ASM_ERROR_OUT_OF_RANGE;
-                    }
-                    if(value < -999){
-                        value = -999;
-                        result->error = ASM_ERROR_OUT_OF_RANGE;
-                    }
-                    current_str = strtok(NULL, " \n");
-                } else{
-                    label_ref = current_str;
-                    current_str = strtok(NULL, " \n");
-                }
             }
         }
+        has_token = lmsm_lexer_next(&lexer, &token);
 
-        asm_instruction *new_inst = asm_make_instruction(type, label, label_ref, value, last_instruction);
-//        last_instruction = new_inst;
-        if(result->root == NULL){
-            result->root = new_inst;
+        lmsm_span *argument = NULL;
+        lmsm_span argument_token;
+        if (ASM_OPCODES[opcode].requires_arg && has_token) {
+            argument_token = token;
+            argument = &argument_token;
+            has_token = lmsm_lexer_next(&lexer, &token);
+        }
+        if (!asm_builder_instruction(builder, opcode, argument, &start)) {
+            return;
         }
-        last_instruction = new_inst;
     }
 }
 
+void asm_parse_src(asm_compilation_result * result, char * original_src){
+    asm_builder builder;
+    asm_builder_init(&builder, result, ASM_KEEP_INSTRUCTIONS);
+    asm_parse(&builder, original_src);
+}
+
 //======================================================
 // Machine Code Generation
 //======================================================
@@ -204,93 +456,710 @@ void asm_gen_code_for_instruction(asm_compilation_result  * result, asm_instruct
     int value_for_instruction = instruction->value;
 
     if (instruction->label_reference){
-        value_for_instruction = asm_find_label(result->root, instruction->label_reference);
+        if (result->symbols == NULL) {
+            asm_build_symbol_table(result);
+        }
+        asm_symbol *symbol = asm_find_symbol(result->symbols, instruction->label_reference);
+        value_for_instruction = symbol ? symbol->offset : -1;
         if (value_for_instruction == -1) {
-            result->error = ASM_ERROR_BAD_LABEL;
+            asm_report_error(result, ASM_ERROR_BAD_LABEL, instruction->line, instruction->column);
             return;
         }
     }
 
-    if (strcmp("ADD", instruction->instruction) == 0) {
-        result->code[instruction->offset] = 100 + value_for_instruction;
-    } else if(strcmp("SUB", instruction->instruction) == 0){
-        result->code[instruction->offset] = 200 + value_for_instruction;
-    } else if(strcmp("STA", instruction->instruction) == 0){
-        result->code[instruction->offset] = 300 + value_for_instruction;
-    } else if(strcmp("LDI", instruction->instruction) == 0){
-        result->code[instruction->offset] = 400 + value_for_instruction;
-    } else if(strcmp("LDA", instruction->instruction) == 0){
-        result->code[instruction->offset] = 500 + value_for_instruction;
-    } else if(strcmp("BRA", instruction->instruction) == 0){
-        result->code[instruction->offset] = 600 + value_for_instruction;
-    } else if(strcmp("BRZ", instruction->instruction) == 0){
-        result->code[instruction->offset] = 700 + value_for_instruction;
-    } else if(strcmp("BRP", instruction->instruction) == 0){
-        result->code[instruction->offset] = 800 + value_for_instruction;
-    } else if(strcmp("INP", instruction->instruction) == 0){
-        result->code[instruction->offset] = 901;
-    } else if(strcmp("OUT", instruction->instruction) == 0){
-        result->code[instruction->offset] = 902;
-    } else if(strcmp("DAT", instruction->instruction) == 0){
-        result->code[instruction->offset] = value_for_instruction;
-    } else if(strcmp("CALL", instruction->instruction) == 0){
-        result->code[instruction->offset+1] = 920;
-        result->code[instruction->offset] = 400 + value_for_instruction;
-        result->code[instruction->offset+2] = 910;
-    } else if(strcmp("JAL", instruction->instruction) == 0){
-        result->code[instruction->offset] = 910;
-    }else if(strcmp("RET", instruction->instruction) == 0){
-        result->code[instruction->offset] = 911;
-    } else if(strcmp("SPUSH", instruction->instruction) == 0){
-        result->code[instruction->offset] = 920;
-    } else if(strcmp("SPUSHI", instruction->instruction) == 0){
-        result->code[instruction->offset+1] = 920;
-        result->code[instruction->offset] = 400 + value_for_instruction;
-    } else if(strcmp("SPOP", instruction->instruction) == 0){
-        result->code[instruction->offset] = 921;
-    } else if(strcmp("SDUP", instruction->instruction) == 0){
-        result->code[instruction->offset] = 922;
-    } else if(strcmp("SDROP", instruction->instruction) == 0){
-        result->code[instruction->offset] = 923;
-    } else if(strcmp("SSWAP", instruction->instruction) == 0){
-        result->code[instruction->offset] = 924;
-    }else if(strcmp("SADD", instruction->instruction) == 0){
-        result->code[instruction->offset] = 930;
-    } else if(strcmp("SSUB", instruction->instruction) == 0){
-        result->code[instruction->offset] = 931;
-    } else if(strcmp("SMUL", instruction->instruction) == 0){
-        result->code[instruction->offset] = 932;
-    } else if(strcmp("SDIV", instruction->instruction) == 0) {
-        result->code[instruction->offset] = 933;
-    } else if(strcmp("SMAX", instruction->instruction) == 0){
-        result->code[instruction->offset] = 934;
-    } else if(strcmp("SMIN", instruction->instruction) == 0){
-        result->code[instruction->offset] = 935;
-    } else if(strcmp("HLT", instruction->instruction) == 0){
-        result->code[instruction->offset] = 000;
-    } else if(strcmp("COB", instruction->instruction) == 0){
-        result->code[instruction->offset] = 000;
-    } else {
-        result->code[instruction->offset] = 0;
-        result->error = ASM_ERROR_UNKNOWN_INSTRUCTION;
+    asm_emit(result, instruction->opcode, instruction->offset, value_for_instruction);
+    if (instruction->opcode == ASM_UNKNOWN) {
+        asm_report_error(result, ASM_ERROR_UNKNOWN_INSTRUCTION, instruction->line, instruction->column);
     }
 }
 
 void asm_gen_code(asm_compilation_result * result) {
     asm_instruction * current = result->root;
     while (current != NULL) {
+        if (current->offset + current->slots > 100) {
+            asm_report_error(result, ASM_ERROR_PROGRAM_TOO_LARGE, current->line, current->column);
+            return;
+        }
         asm_gen_code_for_instruction(result, current);
         current = current->next;
     }
 }
 
 //======================================================
-// Main API
+// Peephole Optimization
 //======================================================
 
-asm_compilation_result * asm_assemble(char *src) {
-    asm_compilation_result * result = asm_make_compilation_result();
-    asm_parse_src(result, src);
+// the optimizer works on an array of the instructions, at most one per word
+typedef struct asm_optimizer {
+    asm_instruction *instructions[100];
+    int count;
+} asm_optimizer;
+
+int asm_optimizer_find(asm_optimizer *optimizer, char *label) {
+    for (int i = 0; i < optimizer->count; ++i) {
+        if (optimizer->instructions[i]->label == label) {  // names are interned
+            return i;
+        }
+    }
+    return -1;
+}
+
+int asm_is_branch(asm_opcode opcode) {
+    return opcode == ASM_BRA || opcode == ASM_BRZ || opcode == ASM_BRP;
+}
+
+int asm_ends_flow(asm_opcode opcode) {
+    return opcode == ASM_BRA || opcode == ASM_HLT || opcode == ASM_COB || opcode == ASM_RET;
+}
+
+// marks the instructions control can reach from the first one
+void asm_optimizer_reachable(asm_optimizer *optimizer, char reachable[100]) {
+    int work[100], pending = 0;
+    memset(reachable, 0, 100);
+    if (optimizer->count > 0) {
+        reachable[0] = 1;
+        work[pending++] = 0;
+    }
+    while (pending > 0) {
+        int i = work[--pending];
+        asm_instruction *instruction = optimizer->instructions[i];
+        int successors[2] = {asm_ends_flow(instruction->opcode) ? -1 : i + 1, -1};
+        if (asm_is_branch(instruction->opcode) || instruction->opcode == ASM_CALL) {
+            successors[1] = asm_optimizer_find(optimizer, instruction->label_reference);
+        }
+        for (int j = 0; j < 2; ++j) {
+            int next = successors[j];
+            if (next >= 0 && next < optimizer->count && !reachable[next]) {
+                reachable[next] = 1;
+                work[pending++] = next;
+            }
+        }
+    }
+}
+
+// whether the accumulator CALL leaves holding the callee's address is overwritten before
+// anything can observe it, so the callee may move
+int asm_optimizer_accumulator_dead(asm_optimizer *optimizer, int i) {
+    for (int steps = 0; i >= 0 && i < optimizer->count && steps < optimizer->count; ++steps) {
+        switch (optimizer->instructions[i]->opcode) {
+            case ASM_LDI: case ASM_LDA: case ASM_SPOP: case ASM_INP: case ASM_CALL: case ASM_SPUSHI:
+                return 1;
+            case ASM_SDUP: case ASM_SDROP: case ASM_SSWAP: case ASM_SADD: case ASM_SSUB:
+            case ASM_SMAX: case ASM_SMIN: case ASM_SMUL: case ASM_SDIV:
+                i++;
+                break;
+            case ASM_BRA:
+                i = asm_optimizer_find(optimizer, optimizer->instructions[i]->label_reference);
+                break;
+            default:
+                return 0;
+        }
+    }
+    return 0;
+}
+
+// code can only move if nothing depends on where it is: every address is a label,
+// data is only reached through labels on DATs, and no address is used as a value
+int asm_optimizer_is_safe(asm_optimizer *optimizer) {
+    char reachable[100];
+    asm_optimizer_reachable(optimizer, reachable);
+    for (int i = 0; i < optimizer->count; ++i) {
+        asm_instruction *instruction = optimizer->instructions[i];
+        asm_opcode opcode = instruction->opcode;
+        int addresses_data = opcode == ASM_ADD || opcode == ASM_SUB || opcode == ASM_LDA || opcode == ASM_STA;
+        int addresses_code = asm_is_branch(opcode) || opcode == ASM_CALL;
+        if (opcode == ASM_JAL || opcode == ASM_LDOVL || (opcode == ASM_DAT && reachable[i])) {
+            return 0;
+        } else if ((addresses_data || addresses_code) && instruction->label_reference == NULL) {
+            return 0;
+        } else if (!addresses_data && !addresses_code && instruction->label_reference != NULL) {
+            return 0;
+        } else if (addresses_data) {
+            int target = asm_optimizer_find(optimizer, instruction->label_reference);
+            if (target < 0 || optimizer->instructions[target]->opcode != ASM_DAT) {
+                return 0;
+            }
+        } else if (opcode == ASM_CALL) {
+            int target = asm_optimizer_find(optimizer, instruction->label_reference);
+            if (!asm_optimizer_accumulator_dead(optimizer, target)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+void asm_optimizer_remove(asm_optimizer *optimizer, int i) {
+    memmove(&optimizer->instructions[i], &optimizer->instructions[i + 1],
+            (optimizer->count - i - 1) * sizeof(asm_instruction *));
+    optimizer->count--;
+}
+
+// gives the label of a removed instruction to the one after it, returns 0 if there isn't one
+int asm_optimizer_move_label(asm_optimizer *optimizer, int from, int to) {
+    char *label = optimizer->instructions[from]->label;
+    if (label == NULL) {
+        return 1;
+    } else if (to >= optimizer->count) {
+        return 0;
+    }
+    asm_instruction *target = optimizer->instructions[to];
+    if (target->label == NULL) {
+        target->label = label;
+        return 1;
+    }
+    for (int i = 0; i < optimizer->count; ++i) {
+        if (optimizer->instructions[i]->label_reference == label) {
+            optimizer->instructions[i]->label_reference = target->label;
+        }
+    }
+    return 1;
+}
+
+void asm_optimizer_set_opcode(asm_instruction *instruction, asm_opcode opcode) {
+    instruction->opcode = opcode;
+    instruction->instruction = ASM_OPCODES[opcode].mnemonic;
+    instruction->slots = ASM_OPCODES[opcode].slots;
+}
+
+// one round of rewrites, returns 1 if anything changed
+int asm_optimizer_rewrite(asm_optimizer *optimizer) {
+    int changed = 0;
+
+    // branches to an unconditional branch go straight to its target
+    for (int i = 0; i < optimizer->count; ++i) {
+        asm_instruction *branch = optimizer->instructions[i];
+        if (!asm_is_branch(branch->opcode)) {
+            continue;
+        }
+        for (int hops = 0; hops < optimizer->count; ++hops) {
+            int target = asm_optimizer_find(optimizer, branch->label_reference);
+            if (target < 0 || target >= optimizer->count) {  // not a label in this code
+                break;
+            }
+            asm_instruction *next = optimizer->instructions[target];
+            if (next->opcode != ASM_BRA || next == branch || next->label_reference == branch->label_reference) {
+                break;
+            }
+            branch->label_reference = next->label_reference;
+            changed = 1;
+        }
+    }
+
+    for (int i = 0; i < optimizer->count; ++i) {
+        asm_instruction *current = optimizer->instructions[i];
+        asm_instruction *next = i + 1 < optimizer->count ? optimizer->instructions[i + 1] : NULL;
+        int follows = next != NULL && next->label == NULL;  // nothing else can jump between the two
+
+        if (current->opcode == ASM_CALL && follows && next->opcode == ASM_RET) {
+            // CALL X; RET -> BRA X: X returns straight to our caller
+            asm_optimizer_set_opcode(current, ASM_BRA);
+            asm_optimizer_remove(optimizer, i + 1);
+            changed = 1;
+        } else if (current->opcode == ASM_SPUSHI && follows && next->opcode == ASM_SPOP) {
+            // LDI x; SPUSH; SPOP -> LDI x
+            asm_optimizer_set_opcode(current, ASM_LDI);
+            asm_optimizer_remove(optimizer, i + 1);
+            changed = 1;
+        } else if (current->opcode == ASM_SPUSH && follows && next->opcode == ASM_SPOP &&
+                   asm_optimizer_move_label(optimizer, i, i + 2)) {
+            asm_optimizer_remove(optimizer, i);
+            asm_optimizer_remove(optimizer, i);
+            changed = 1;
+            i--;
+        } else if (current->opcode == ASM_BRA && next != NULL && next->label == current->label_reference &&
+                   asm_optimizer_move_label(optimizer, i, i + 1)) {
+            // a branch to the next instruction
+            asm_optimizer_remove(optimizer, i);
+            changed = 1;
+            i--;
+        }
+    }
+
+    // code that can't be reached, data stays where it is
+    char reachable[100];
+    asm_optimizer_reachable(optimizer, reachable);
+    int kept = 0;
+    for (int i = 0; i < optimizer->count; ++i) {
+        if (reachable[i] || optimizer->instructions[i]->opcode == ASM_DAT) {
+            optimizer->instructions[kept++] = optimizer->instructions[i];
+        }
+    }
+    changed |= kept != optimizer->count;
+    optimizer->count = kept;
+    return changed;
+}
+
+// rewrites the instruction list to do the same thing in fewer words and steps, then
+// generates its code again. programs whose code can't safely move are left alone
+void asm_optimize(asm_compilation_result *result) {
+    asm_optimizer optimizer;
+    optimizer.count = 0;
+    for (asm_instruction *current = result->root; current != NULL; current = current->next) {
+        optimizer.instructions[optimizer.count++] = current;
+    }
+    if (!asm_optimizer_is_safe(&optimizer)) {
+        return;
+    }
+    while (asm_optimizer_rewrite(&optimizer)) {
+    }
+
+    result->root = NULL;
+    int offset = 0;
+    for (int i = optimizer.count - 1; i >= 0; --i) {
+        optimizer.instructions[i]->next = result->root;
+        result->root = optimizer.instructions[i];
+    }
+    asm_symbol_table *symbols = result->symbols;
+    for (int i = 0; i < symbols->capacity; ++i) {
+        symbols->slots[i].offset = -1;
+    }
+    for (int i = 0; i < optimizer.count; ++i) {
+        asm_instruction *instruction = optimizer.instructions[i];
+        instruction->offset = offset;
+        offset += instruction->slots;
+        if (instruction->label != NULL) {
+            asm_intern_symbol(symbols, instruction->label)->offset = instruction->offset;
+        }
+    }
+    result->size = offset;
+    memset(result->code, 0, sizeof(result->code));
     asm_gen_code(result);
+
+    if (result->options & ASM_SOURCE_MAP) {
+        result->source_map_count = 0;
+        for (int i = 0; i < optimizer.count; ++i) {
+            asm_instruction *instruction = optimizer.instructions[i];
+            asm_source_location location = {instruction->offset, instruction->slots, instruction->line,
+                                             instruction->column};
+            result->source_map[result->source_map_count++] = location;
+        }
+    }
+}
+
+//======================================================
+// Main API
+//======================================================
+
+int asm_builder_options(int options) {
+    if ((options & ASM_OPTIMIZE) && !(options & ASM_RELOCATABLE)) {
+        return options | ASM_KEEP_INSTRUCTIONS;
+    }
+    return options & ~ASM_OPTIMIZE;
+}
+
+void asm_builder_begin(asm_builder *builder, int options) {
+    asm_builder_init(builder, asm_make_compilation_result(), asm_builder_options(options));
+}
+
+asm_compilation_result *asm_builder_finish(asm_builder *builder) {
+    asm_compilation_result *result = builder->result;
+    // report the first error, not what it cascades into. labels left undefined in a relocatable object are imports
+    if (result->error == NULL && !(result->options & ASM_RELOCATABLE)) {
+        asm_check_fixups(result);
+    }
+    if (result->error == NULL && (result->options & ASM_OPTIMIZE)) {
+        asm_optimize(result);
+    }
     return result;
 }
+
+asm_compilation_result * asm_assemble_with_options(char *src, int options) {
+    asm_builder builder;
+    asm_builder_begin(&builder, options);
+    asm_parse(&builder, src);
+    return asm_builder_finish(&builder);
+}
+
+asm_compilation_result * asm_assemble(char *src) {
+    return asm_assemble_with_options(src, ASM_KEEP_INSTRUCTIONS);
+}
+
+//======================================================
+// Reentrant Context API
+//======================================================
+
+asm_context * asm_context_create() {
+    return calloc(1, sizeof(asm_context));
+}
+
+void asm_context_delete(asm_context *context) {
+    if (context->result) {
+        asm_delete_compilation_result(context->result);
+    }
+    free(context);
+}
+
+int asm_context_assemble(asm_context *context, char *src) {
+    if (context->result) {
+        asm_delete_compilation_result(context->result);
+    }
+    context->result = asm_assemble_with_options(src, context->options);
+    asm_compilation_result *result = context->result;
+    if (result->error == NULL) {
+        context->message[0] = '\0';
+        return 1;
+    }
+    if (result->error_line > 0) {
+        snprintf(context->message, sizeof(context->message), "%s at line %d, column %d",
+                 result->error, result->error_line, result->error_column);
+    } else {
+        snprintf(context->message, sizeof(context->message), "%s", result->error);
+    }
+    return 0;
+}
+
+//======================================================
+// Incremental Assembly
+//======================================================
+
+void asm_incremental_free_line(asm_source_line *line) {
+    asm_instruction *current = line->first;
+    for (int i = 0; i < line->count; ++i) {  // the last one is linked to the next line's
+        asm_instruction *next = current->next;
+        free(current);
+        current = next;
+    }
+}
+
+// splits src into lines without copying it, a source without newlines is one line
+int asm_incremental_split(const char *src, asm_source_line **lines) {
+    int count = 1;
+    for (const char *c = src; *c != '\0'; ++c) {
+        count += *c == '\n';
+    }
+    asm_source_line *split = calloc(count, sizeof(asm_source_line));
+    const char *start = src;
+    for (int i = 0; i < count; ++i) {
+        const char *end = start;
+        while (*end != '\0' && *end != '\n') {
+            end++;
+        }
+        split[i].start = start;
+        split[i].length = (int) (end - start);
+        start = end + 1;
+    }
+    *lines = split;
+    return count;
+}
+
+int asm_incremental_same_line(asm_source_line *a, asm_source_line *b) {
+    return a->length == b->length && memcmp(a->start, b->start, a->length) == 0;
+}
+
+// takes over the parse of an unchanged line that is now line_delta lines further down
+void asm_incremental_move_line(asm_source_line *to, asm_source_line *from, int line_delta) {
+    const char *start = to->start;
+    int length = to->length;
+    *to = *from;
+    to->start = start;
+    to->length = length;
+    asm_instruction *current = to->first;
+    for (int i = 0; i < to->count; ++i, current = current->next) {
+        current->line += line_delta;
+    }
+}
+
+void asm_incremental_lex_line(asm_incremental *incremental, asm_source_line *line, int line_number) {
+    asm_symbol_table *symbols = incremental->result->symbols;
+    lmsm_lexer lexer = {line->start, line->start, line_number};
+    lmsm_span token;
+    int has_token = lmsm_lexer_next(&lexer, &token) && token.line == line_number;
+    asm_instruction *last = NULL;
+    char *label = NULL;
+    int label_column = 0;
+
+    while (has_token) {
+        asm_opcode opcode = asm_lookup_opcode_length(token.start, token.length);
+        if (opcode == ASM_UNKNOWN) {
+            if (label != NULL) {
+                line->error = ASM_ERROR_UNKNOWN_INSTRUCTION;
+                line->error_column = token.column;
+                return;
+            }
+            label = asm_intern_symbol_length(symbols, token.start, token.length)->name;
+            label_column = token.column;
+            has_token = lmsm_lexer_next(&lexer, &token) && token.line == line_number;
+            continue;
+        }
+
+        lmsm_span start = token;
+        char *label_ref = NULL;
+        int value = 0;
+        has_token = lmsm_lexer_next(&lexer, &token) && token.line == line_number;
+        if (ASM_OPCODES[opcode].requires_arg) {
+            if (!has_token) {
+                line->error = ASM_ERROR_ARG_REQUIRED;
+                line->error_column = start.column;
+                return;
+            } else if (lmsm_span_is_number(&token)) {
+                value = lmsm_span_to_int(&token, 999);
+                if (value > 999 || value < -999) {
+                    value = value > 999 ? 999 : -999;
+                    line->error = ASM_ERROR_OUT_OF_RANGE;
+                    line->error_column = token.column;
+                }
+            } else {
+                label_ref = asm_intern_symbol_length(symbols, token.start, token.length)->name;
+            }
+            has_token = lmsm_lexer_next(&lexer, &token) && token.line == line_number;
+        }
+
+        asm_instruction *instruction = asm_make_opcode_instruction(NULL, ASM_OPCODES[opcode].mnemonic, opcode,
+                                                                   label, label_ref, value, last);
+        instruction->line = line_number;
+        instruction->column = label ? label_column : start.column;
+        if (last == NULL) {
+            line->first = instruction;
+        }
+        last = instruction;
+        line->count++;
+        label = NULL;
+    }
+    line->trailing_label = label;
+    line->trailing_column = label_column;
+}
+
+// the last instruction on a line before line_index, or NULL
+asm_instruction *asm_incremental_last_before(asm_incremental *incremental, int line_index) {
+    for (int i = line_index - 1; i >= 0; --i) {
+        asm_source_line *line = &incremental->lines[i];
+        if (line->count > 0) {
+            asm_instruction *last = line->first;
+            for (int j = 1; j < line->count; ++j) {
+                last = last->next;
+            }
+            return last;
+        }
+    }
+    return NULL;
+}
+
+// the index of an earlier line whose trailing label labels the first instruction from line_index on, or -1
+int asm_incremental_pending_label(asm_incremental *incremental, int line_index) {
+    for (int i = line_index - 1; i >= 0; --i) {
+        if (incremental->lines[i].trailing_label != NULL) {
+            return i;
+        } else if (incremental->lines[i].count > 0) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+void asm_incremental_report_error(asm_compilation_result *result, char *error, int line, int column) {
+    if (result->error == NULL) {
+        asm_report_error(result, error, line, column);
+    }
+}
+
+// links the instructions from line from on, assigning their offsets and defining their labels.
+// returns the first instruction that was linked
+asm_instruction *asm_incremental_link(asm_incremental *incremental, int from) {
+    asm_compilation_result *result = incremental->result;
+    asm_instruction *previous = asm_incremental_last_before(incremental, from);
+    int offset = previous ? previous->offset + previous->slots : 0;
+    int pending = asm_incremental_pending_label(incremental, from);
+    char *pending_label = pending >= 0 ? incremental->lines[pending].trailing_label : NULL;
+    asm_instruction *first = NULL;
+
+    for (int i = from; i < incremental->line_count; ++i) {
+        asm_source_line *line = &incremental->lines[i];
+        if (line->error) {
+            asm_incremental_report_error(result, line->error, i + 1, line->error_column);
+        }
+        asm_instruction *current = line->first;
+        if (line->inherits_label) {
+            current->label = NULL;
+            line->inherits_label = 0;
+        }
+        for (int j = 0; j < line->count; ++j, current = current->next) {
+            if (pending_label != NULL) {
+                if (current->label != NULL) {
+                    asm_incremental_report_error(result, ASM_ERROR_UNKNOWN_INSTRUCTION, current->line, current->column);
+                } else {
+                    current->label = pending_label;
+                    line->inherits_label = 1;
+                }
+                pending_label = NULL;
+            }
+            if (previous != NULL) {
+                previous->next = current;
+            } else {
+                result->root = current;
+            }
+            if (first == NULL) {
+                first = current;
+            }
+            current->offset = offset;
+            if (offset + current->slots > 100) {
+                asm_incremental_report_error(result, ASM_ERROR_PROGRAM_TOO_LARGE, current->line, current->column);
+            }
+            if (current->label != NULL) {
+                asm_symbol *symbol = asm_intern_symbol(result->symbols, current->label);
+                if (symbol->offset != -1) {
+                    asm_incremental_report_error(result, ASM_ERROR_DUPLICATE_LABEL, current->line, current->column);
+                }
+                symbol->offset = offset;
+            }
+            offset += current->slots;
+            previous = current;
+        }
+        if (line->trailing_label != NULL) {
+            if (pending_label != NULL) {
+                // two labels for one instruction, the parser reads the second as a mnemonic
+                asm_incremental_report_error(result, ASM_ERROR_UNKNOWN_INSTRUCTION, i + 1, line->trailing_column);
+            }
+            pending_label = line->trailing_label;
+            pending = i;
+        }
+    }
+    if (pending_label != NULL) {
+        asm_incremental_report_error(result, ASM_ERROR_UNKNOWN_INSTRUCTION, pending + 1,
+                                     incremental->lines[pending].trailing_column);
+    }
+    if (previous != NULL) {
+        previous->next = NULL;
+    } else {
+        result->root = NULL;
+    }
+    return first;
+}
+
+void asm_incremental_emit(asm_compilation_result *result, asm_instruction *instruction) {
+    int value = instruction->value;
+    if (instruction->label_reference) {
+        value = asm_find_symbol(result->symbols, instruction->label_reference)->offset;
+        if (value == -1) {
+            asm_incremental_report_error(result, ASM_ERROR_BAD_LABEL, instruction->line, instruction->column);
+            return;
+        }
+    }
+    asm_emit(result, instruction->opcode, instruction->offset, value);
+}
+
+asm_incremental * asm_incremental_create() {
+    asm_incremental *incremental = calloc(1, sizeof(asm_incremental));
+    incremental->result = asm_make_compilation_result();
+    incremental->result->symbols = asm_make_symbol_table(incremental->result->arena);
+    incremental->src = calloc(1, 1);
+    incremental->line_count = asm_incremental_split(incremental->src, &incremental->lines);
+    return incremental;
+}
+
+void asm_incremental_delete(asm_incremental *incremental) {
+    for (int i = 0; i < incremental->line_count; ++i) {
+        asm_incremental_free_line(&incremental->lines[i]);
+    }
+    incremental->result->root = NULL;  // the lines owned the instructions
+    asm_delete_compilation_result(incremental->result);
+    free(incremental->lines);
+    free(incremental->src);
+    free(incremental);
+}
+
+int asm_incremental_update(asm_incremental *incremental, const char *src) {
+    asm_compilation_result *result = incremental->result;
+    size_t size = strlen(src) + 1;
+    char *new_src = memcpy(malloc(size), src, size);
+    asm_source_line *lines;
+    int line_count = asm_incremental_split(new_src, &lines);
+    asm_source_line *old_lines = incremental->lines;
+    int old_count = incremental->line_count;
+
+    // only the lines between the unchanged prefix and suffix are lexed again
+    int shortest = line_count < old_count ? line_count : old_count;
+    int prefix = 0;
+    while (prefix < shortest && asm_incremental_same_line(&old_lines[prefix], &lines[prefix])) {
+        prefix++;
+    }
+    int suffix = 0;
+    while (suffix < shortest - prefix &&
+           asm_incremental_same_line(&old_lines[old_count - 1 - suffix], &lines[line_count - 1 - suffix])) {
+        suffix++;
+    }
+
+    // offsets and labels are recomputed from the first changed line, or from the top if the last image had an error
+    int from = result->error ? 0 : prefix;
+    if (from == 0) {
+        for (int i = 0; i < result->symbols->capacity; ++i) {
+            result->symbols->slots[i].offset = -1;
+        }
+    } else {
+        for (int i = from; i < old_count; ++i) {
+            asm_instruction *current = old_lines[i].first;
+            for (int j = 0; j < old_lines[i].count; ++j, current = current->next) {
+                if (current->label != NULL) {
+                    asm_intern_symbol(result->symbols, current->label)->offset = -1;
+                }
+            }
+        }
+    }
+    asm_instruction *old_last = asm_incremental_last_before(incremental, old_count);
+    int old_end = old_last ? old_last->offset + old_last->slots : 0;
+    int old_code[100];
+    memcpy(old_code, result->code, sizeof(old_code));
+
+    for (int i = 0; i < prefix; ++i) {
+        asm_incremental_move_line(&lines[i], &old_lines[i], 0);
+    }
+    for (int i = prefix; i < old_count - suffix; ++i) {
+        asm_incremental_free_line(&old_lines[i]);
+    }
+    for (int i = 0; i < suffix; ++i) {
+        asm_incremental_move_line(&lines[line_count - 1 - i], &old_lines[old_count - 1 - i], line_count - old_count);
+    }
+    free(old_lines);
+    free(incremental->src);
+    incremental->src = new_src;
+    incremental->lines = lines;
+    incremental->line_count = line_count;
+    for (int i = prefix; i < line_count - suffix; ++i) {
+        asm_incremental_lex_line(incremental, &lines[i], i + 1);
+    }
+    incremental->relexed_lines = line_count - suffix - prefix;
+
+    result->error = NULL;
+    result->error_line = 0;
+    result->error_column = 0;
+    asm_instruction *first_linked = asm_incremental_link(incremental, from);
+    asm_instruction *last = asm_incremental_last_before(incremental, line_count);
+    int end = last ? last->offset + last->slots : 0;
+    if (result->error == NULL) {
+        if (from == 0) {
+            memset(result->code, 0, sizeof(result->code));
+        }
+        for (int i = end; i < old_end; ++i) {
+            result->code[i] = 0;
+        }
+        // instructions before the change only move if they use a label that moved
+        asm_instruction *current = result->root;
+        for (; current != first_linked; current = current->next) {
+            if (current->label_reference) {
+                asm_incremental_emit(result, current);
+            }
+        }
+        for (; current != NULL; current = current->next) {
+            asm_incremental_emit(result, current);
+        }
+    }
+
+    incremental->changed_count = 0;
+    if (result->error) {
+        memcpy(result->code, old_code, sizeof(old_code));  // keep the last good image
+        return 0;
+    }
+    for (int i = 0; i < 100; ++i) {
+        if (result->code[i] != old_code[i]) {
+            incremental->changed[incremental->changed_count++] = i;
+        }
+    }
+    return 1;
+}
+
+void asm_incremental_patch(asm_incremental *incremental, int *memory) {
+    for (int i = 0; i < incremental->changed_count; ++i) {
+        int offset = incremental->changed[i];
+        memory[offset] = incremental->result->code[offset];
+    }
+}
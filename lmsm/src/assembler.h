@@ -5,34 +5,113 @@
 #ifndef LMSM_ASSEMBLER_H
 #define LMSM_ASSEMBLER_H
 
+#include "arena.h"
+#include "lexer.h"
+
 //===================================================================
 //  Error messages
 //===================================================================
-extern char *ASM_ERROR_UNKNOWN_INSTRUCTION;
-extern char *ASM_ERROR_ARG_REQUIRED;
-extern char *ASM_ERROR_BAD_LABEL;
-extern char *ASM_ERROR_OUT_OF_RANGE;
+extern char *const ASM_ERROR_UNKNOWN_INSTRUCTION;
+extern char *const ASM_ERROR_ARG_REQUIRED;
+extern char *const ASM_ERROR_BAD_LABEL;
+extern char *const ASM_ERROR_OUT_OF_RANGE;
+extern char *const ASM_ERROR_PROGRAM_TOO_LARGE;
+extern char *const ASM_ERROR_DUPLICATE_LABEL;
+
+//===================================================================
+//  Every mnemonic on the LMSM architecture
+//===================================================================
+typedef enum asm_opcode {
+    ASM_ADD, ASM_SUB, ASM_LDA, ASM_STA, ASM_BRA, ASM_BRZ, ASM_BRP, ASM_INP, ASM_OUT, ASM_HLT, ASM_COB, ASM_DAT,
+    ASM_LDI,
+    ASM_JAL, ASM_CALL, ASM_RET,
+    ASM_SPUSH, ASM_SPUSHI, ASM_SPOP, ASM_SDUP, ASM_SDROP, ASM_SSWAP,
+    ASM_SADD, ASM_SSUB, ASM_SMAX, ASM_SMIN, ASM_SMUL, ASM_SDIV,
+    ASM_LDOVL,
+    ASM_UNKNOWN
+} asm_opcode;
+
+//===================================================================
+//  How to encode an opcode: the argument is added to the first word
+//===================================================================
+typedef struct asm_opcode_info {
+    char *mnemonic;
+    int words[3];        // the machine words emitted, in order
+    int slots;           // how many words are used
+    int requires_arg;
+} asm_opcode_info;
+
+extern const asm_opcode_info ASM_OPCODES[];
 
 //===================================================================
 //  Represents an asm_instruction for the LMSM architecture
 //===================================================================
 typedef struct asm_instruction {
     char* instruction;         // the type of the asm_instruction
+    asm_opcode opcode;         // the type, resolved
     char* label;               // the label of the asm_instruction if any
     char* label_reference;     // the label this asm_instruction refers to, if any
     int value;                 // the value of the asm_instruction, if any
     int slots;                // the offset of the asm_instruction, if any
     int offset;                // the offset of the asm_instruction, if any
+    int line;                  // where the asm_instruction starts in the source, 0 if built by hand
+    int column;
     struct asm_instruction * next; // the next asm_instruction
 } asm_instruction;
 
+//===================================================================
+//  Label symbol table: open addressing with linear probing.  Names
+//  are interned, so every instruction that mentions a label shares
+//  the table's copy of its name
+//===================================================================
+typedef struct asm_fixup {
+    int offset;          // the code word waiting on the label
+    int line;            // where the reference was made
+    int column;
+    struct asm_fixup *next;
+} asm_fixup;
+
+typedef struct asm_symbol {
+    char *name;          // interned name, owned by the table
+    int offset;          // the offset the label is defined at, -1 if undefined
+    asm_fixup *fixups;   // forward references to patch once the label is defined
+} asm_symbol;
+
+typedef struct asm_symbol_table {
+    lmsm_arena *arena;   // where the slots and names live
+    asm_symbol *slots;
+    int capacity;        // always a power of two
+    int count;
+} asm_symbol_table;
+
+//===================================================================
+//  Where an instruction came from, for debug info
+//===================================================================
+typedef struct asm_source_location {
+    int offset;          // the first word of the instruction
+    int slots;
+    int line;
+    int column;
+} asm_source_location;
+
 //===================================================================
 //  The result of an assembly compilation
 //===================================================================
 typedef struct asm_compilation_result {
     char* error;         // any error that occurred (e.g. a missing label)
+    int error_line;      // where the error occurred, 0 if unknown
+    int error_column;
     asm_instruction *root;   // the root asm_instruction of the compilation
+    asm_symbol_table *symbols;  // every label defined or referenced
+    lmsm_arena *arena;   // instructions, token copies and symbols, freed with the result
+    int arena_owns_instructions;  // 0 if root was built by hand with asm_make_instruction
+    int options;         // the ASM_ options it was assembled with
+    int size;            // how many words of code were emitted
     int code[100];       // the machine code generated by the assembler
+    int relocations[100];  // with ASM_RELOCATABLE, the words holding the offset of a label defined here
+    int relocation_count;
+    asm_source_location source_map[100];  // with ASM_SOURCE_MAP, every instruction in offset order
+    int source_map_count;
 } asm_compilation_result;
 
 //===================================================================
@@ -45,15 +124,127 @@ void asm_delete_instruction(asm_instruction *instruction);
 asm_compilation_result *asm_make_compilation_result();
 void asm_delete_compilation_result(asm_compilation_result *result);
 
+// the table is freed along with its arena
+asm_symbol_table *asm_make_symbol_table(lmsm_arena *arena);
+
+// finds the symbol for a name, adding it undefined if it isn't in the table yet.
+// the returned pointer is only valid until the next symbol is added
+asm_symbol *asm_intern_symbol(asm_symbol_table *table, char *name);
+
+asm_symbol *asm_intern_symbol_length(asm_symbol_table *table, const char *name, int length);
+
+// finds the symbol for a name, or NULL
+asm_symbol *asm_find_symbol(asm_symbol_table *table, char *name);
+
+// assembly options
+#define ASM_KEEP_INSTRUCTIONS 1   // retain the asm_instruction list, e.g. for a listing
+#define ASM_RELOCATABLE 2         // record relocations and leave undefined labels as imports for the linker
+#define ASM_OPTIMIZE 4            // peephole-optimize the instruction list before generating code, not for objects
+#define ASM_SOURCE_MAP 8          // record where each instruction came from
+
+// parses src and emits its code in a single pass, keeping the instruction list
 void asm_parse_src(asm_compilation_result *result, char *original_src);
 
 void asm_gen_code_for_instruction(asm_compilation_result  * result, asm_instruction *instruction);
 
 asm_compilation_result * asm_assemble(char * src);
 
+// single-pass assembly; without ASM_KEEP_INSTRUCTIONS the result has no root
+asm_compilation_result * asm_assemble_with_options(char * src, int options);
+
+// resolves a mnemonic with a perfect hash, ASM_UNKNOWN if it isn't one
+asm_opcode asm_lookup_opcode(const char *token);
+asm_opcode asm_lookup_opcode_length(const char *token, int length);
+
 int asm_is_instruction(char * token);
 int asm_is_num(char * token);
 
 void asm_delete_compilation_result(asm_compilation_result *result);
 
+//===================================================================
+//  Builder API: emits code a label and an instruction at a time, so
+//  a compiler can skip printing assembly only to have it parsed.
+//  Assembling text is the parser driving a builder
+//===================================================================
+typedef struct asm_builder {
+    asm_compilation_result *result;
+    asm_instruction *last;       // with ASM_KEEP_INSTRUCTIONS, the instruction added last
+    char *label;                 // a label waiting for the next instruction
+    int stopped;                 // an error ended the assembly, the rest is ignored
+} asm_builder;
+
+// starts a new result, with the options treated as asm_assemble_with_options treats them
+void asm_builder_begin(asm_builder *builder, int options);
+
+// builds into an existing result
+void asm_builder_init(asm_builder *builder, asm_compilation_result *result, int options);
+
+// labels the next instruction, the span gives the name and where errors are reported.
+// returns 0 once an error has stopped the assembly
+int asm_builder_label(asm_builder *builder, const lmsm_span *name);
+
+// adds an instruction at the end of the code. argument is a number or a label, and NULL
+// if the opcode doesn't take one. returns 0 once an error has stopped the assembly
+int asm_builder_instruction(asm_builder *builder, asm_opcode opcode, const lmsm_span *argument,
+                            const lmsm_span *at);
+
+// checks for labels that were never defined and optimizes, then returns the result
+asm_compilation_result *asm_builder_finish(asm_builder *builder);
+
+//===================================================================
+//  Reentrant API: a context holds everything for one assembly at a
+//  time, so threads can assemble concurrently with one context each
+//===================================================================
+#define ASM_CONTEXT_MESSAGE_SIZE 256
+
+typedef struct asm_context {
+    int options;                     // the ASM_ options to assemble with
+    asm_compilation_result *result;  // the latest result, owned by the context
+    char message[ASM_CONTEXT_MESSAGE_SIZE];  // the latest error and where it occurred
+} asm_context;
+
+asm_context *asm_context_create();
+void asm_context_delete(asm_context *context);
+
+// assembles src into context->result, replacing the previous one. returns 0 on error
+int asm_context_assemble(asm_context *context, char *src);
+
+//===================================================================
+//  Incremental assembly for editors and the REPL: the instruction
+//  list and symbol table are kept between updates, so an edit only
+//  re-lexes the lines that changed and re-emits the words that moved
+//  along with the instructions that use a moved label.  An
+//  instruction and its argument must be on the same line
+//===================================================================
+typedef struct asm_source_line {
+    const char *start;           // points into the incremental's copy of the source
+    int length;
+    asm_instruction *first;      // the instructions that start on this line
+    int count;
+    int inherits_label;          // the first instruction is labelled by an earlier line
+    char *trailing_label;        // a label with no instruction after it on this line
+    int trailing_column;
+    char *error;                 // found while lexing the line
+    int error_column;
+} asm_source_line;
+
+typedef struct asm_incremental {
+    char *src;                   // the current source
+    asm_source_line *lines;
+    int line_count;
+    asm_compilation_result *result;  // the linked instruction list, symbols and code
+    int changed[100];            // the words that differ from the previous image
+    int changed_count;
+    int relexed_lines;           // how many lines the last update had to lex
+} asm_incremental;
+
+asm_incremental *asm_incremental_create();
+void asm_incremental_delete(asm_incremental *incremental);
+
+// brings the image up to date with src, returns 0 if it has an error
+int asm_incremental_update(asm_incremental *incremental, const char *src);
+
+// writes only the changed words into a machine's memory
+void asm_incremental_patch(asm_incremental *incremental, int *memory);
+
 #endif //LMSM_ASSEMBLER_H
@@ -0,0 +1,283 @@
+//
+// Microbenchmarks for the LMSM engine
+//
+
+#include "assembler.h"
+#include "engines.h"
+#include "lmsm.h"
+#include "perf.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef LMSM_EXAMPLES_DIR
+#define LMSM_EXAMPLES_DIR "examples"
+#endif
+
+#define BENCH_MAX_REPETITIONS 100
+#define BENCH_TARGET_NS 20000000.0  // aim for ~20ms per repetition
+
+//======================================================
+//  Workloads
+//======================================================
+
+typedef enum bench_source_type {
+    BENCH_ASM,
+    BENCH_FIRTH,
+    BENCH_ASM_FILE,
+} bench_source_type;
+
+typedef struct bench_workload {
+    char *name;
+    bench_source_type type;
+    char *source;
+} bench_workload;
+
+bench_workload BENCH_WORKLOADS[] = {
+        {"dispatch", BENCH_ASM,
+         "       LDI 50\n"
+         "OUTER  STA COUNT\n"
+         "       LDI 99\n"
+         "INNER  SUB ONE\n"
+         "       BRP INNER\n"
+         "       LDA COUNT\n"
+         "       SUB ONE\n"
+         "       BRP OUTER\n"
+         "       HLT\n"
+         "ONE    DAT 1\n"
+         "COUNT  DAT 0\n"},
+        {"stack_arith", BENCH_ASM,
+         "       LDI 99\n"
+         "LOOP   STA COUNT\n"
+         "       SPUSHI 7\n"
+         "       SPUSHI 3\n"
+         "       SADD\n"
+         "       SDUP\n"
+         "       SMUL\n"
+         "       SPUSHI 9\n"
+         "       SSWAP\n"
+         "       SDIV\n"
+         "       SPUSHI 4\n"
+         "       SMAX\n"
+         "       SPUSHI 2\n"
+         "       SMIN\n"
+         "       SDROP\n"
+         "       LDA COUNT\n"
+         "       SUB ONE\n"
+         "       BRP LOOP\n"
+         "       HLT\n"
+         "ONE    DAT 1\n"
+         "COUNT  DAT 0\n"},
+        {"fib", BENCH_FIRTH,
+         "12 fib() . "
+         "def fib() "
+         "  dup zero? return end "
+         "  dup 1 - zero? return end "
+         "  dup 2 - fib() "
+         "  swap 1 - fib() "
+         "  + "
+         "end"},
+        {"countdown", BENCH_ASM_FILE, LMSM_EXAMPLES_DIR "/asm/countdown.asm"},
+        {"output", BENCH_ASM,
+         "       LDI 9\n"
+         "OUTER  STA COUNT\n"
+         "       LDI 99\n"
+         "INNER  OUT\n"
+         "       SUB ONE\n"
+         "       BRP INNER\n"
+         "       LDA COUNT\n"
+         "       SUB ONE\n"
+         "       BRP OUTER\n"
+         "       HLT\n"
+         "ONE    DAT 1\n"
+         "COUNT  DAT 0\n"},
+};
+const int BENCH_WORKLOAD_COUNT = sizeof(BENCH_WORKLOADS) / sizeof(BENCH_WORKLOADS[0]);
+
+//======================================================
+//  Utilities
+//======================================================
+
+double bench_now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec * 1e9 + (double) now.tv_nsec;
+}
+
+// assembles the workload into code, returns 0 on error
+int bench_build(bench_workload *workload, int options, int code[100]) {
+    int ok;
+    char inputs[100];
+    if (workload->type == BENCH_ASM_FILE) {
+        ok = lmsm_engine_build_file(workload->source, options, code, inputs);
+    } else {
+        ok = lmsm_engine_build(workload->source, workload->type == BENCH_FIRTH, options, code, inputs);
+    }
+
+    // benchmarks can't wait on stdin, so feed INP a constant instead. data is left alone
+    for (int i = 0; ok && i < 100; ++i) {
+        if (inputs[i]) {
+            code[i] = 499;  // LDI 99
+        }
+    }
+    return ok;
+}
+
+// runs the program `machines` times and returns the elapsed time in ns
+double bench_time(lmsm_engine *engine, lmsm *the_machine, int code[100], long machines) {
+    double start = bench_now_ns();
+    for (long i = 0; i < machines; ++i) {
+        lmsm_reset(the_machine);
+        lmsm_load(the_machine, code, 100);
+        engine->run(the_machine);
+    }
+    return bench_now_ns() - start;
+}
+
+int bench_compare_doubles(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+//======================================================
+//  Statistics
+//======================================================
+
+typedef struct bench_stats {
+    double min;
+    double median;
+    double mean;
+    double stddev;
+} bench_stats;
+
+bench_stats bench_summarize(double *samples, int count) {
+    bench_stats stats;
+    qsort(samples, count, sizeof(double), bench_compare_doubles);
+    double sum = 0;
+    for (int i = 0; i < count; ++i) {
+        sum += samples[i];
+    }
+    stats.min = samples[0];
+    stats.mean = sum / count;
+    stats.median = count % 2 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+    double variance = 0;
+    for (int i = 0; i < count; ++i) {
+        variance += (samples[i] - stats.mean) * (samples[i] - stats.mean);
+    }
+    stats.stddev = count > 1 ? sqrt(variance / (count - 1)) : 0;
+    return stats;
+}
+
+//======================================================
+//  Main
+//======================================================
+
+void bench_usage() {
+    printf("Usage: lmsm_bench [--reps N] [--warmup N] [--workload name] [--engine name] [--perf] [-O]\n");
+}
+
+int main(int argc, char *argv[]) {
+    int repetitions = 10;
+    int warmup = 2;
+    char *workload_filter = NULL;
+    char *engine_filter = NULL;
+    int perf = 0;
+    int options = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            repetitions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--workload") == 0 && i + 1 < argc) {
+            workload_filter = argv[++i];
+        } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            engine_filter = argv[++i];
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            perf = 1;
+        } else if (strcmp(argv[i], "-O") == 0) {
+            options = ASM_OPTIMIZE;
+        } else {
+            bench_usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (repetitions < 1 || repetitions > BENCH_MAX_REPETITIONS) {
+        printf("--reps must be between 1 and %d\n", BENCH_MAX_REPETITIONS);
+        return EXIT_FAILURE;
+    }
+    lmsm_perf_counters counters;
+    if (perf && !lmsm_perf_open(&counters)) {
+        printf("Hardware performance counters are not available, check perf_event_paranoid\n");
+        perf = 0;
+    }
+
+    printf("%-12s %-12s %10s %12s %12s %12s %12s %14s\n",
+           "workload", "engine", "steps", "ns/step", "median", "stddev", "Minst/s", "machines/s");
+    for (int w = 0; w < BENCH_WORKLOAD_COUNT; ++w) {
+        bench_workload *workload = &BENCH_WORKLOADS[w];
+        if (workload_filter && strcmp(workload_filter, workload->name) != 0) {
+            continue;
+        }
+        int code[100];
+        if (!bench_build(workload, options, code)) {
+            printf("%-12s unable to build workload\n", workload->name);
+            continue;
+        }
+        int error_code;
+        long steps = lmsm_engine_count_steps(code, &error_code);
+        if (error_code != ERROR_NONE) {
+            printf("  warning: workload halted with error %d\n", error_code);
+        }
+
+        for (int e = 0; e < LMSM_ENGINE_COUNT; ++e) {
+            lmsm_engine *engine = &LMSM_ENGINES[e];
+            if (engine_filter && strcmp(engine_filter, engine->name) != 0) {
+                continue;
+            }
+            lmsm *the_machine = lmsm_create();
+            engine->setup(the_machine);
+
+            // calibrate so each repetition runs for roughly BENCH_TARGET_NS
+            long machines = 1;
+            double elapsed = bench_time(engine, the_machine, code, machines);
+            while (elapsed < BENCH_TARGET_NS / 10 && machines < (1L << 30)) {
+                machines *= 10;
+                elapsed = bench_time(engine, the_machine, code, machines);
+            }
+            machines = (long) (machines * (BENCH_TARGET_NS / elapsed)) + 1;
+
+            for (int i = 0; i < warmup; ++i) {
+                bench_time(engine, the_machine, code, machines);
+            }
+            double samples[BENCH_MAX_REPETITIONS];
+            for (int i = 0; i < repetitions; ++i) {
+                samples[i] = bench_time(engine, the_machine, code, machines) / (double) (machines * steps);
+            }
+            bench_stats stats = bench_summarize(samples, repetitions);
+
+            printf("%-12s %-12s %10ld %12.2f %12.2f %12.2f %12.1f %14.0f\n",
+                   workload->name, engine->name, steps, stats.min, stats.median, stats.stddev,
+                   1e3 / stats.median, 1e9 / (stats.median * steps));
+
+            if (perf) {
+                char report[256];
+                lmsm_perf_start(&counters);
+                bench_time(engine, the_machine, code, machines);
+                lmsm_perf_stop(&counters);
+                lmsm_perf_format(&counters, (double) machines * steps, report, sizeof(report));
+                printf("%-12s %-12s%s\n", "", "", report);
+            }
+
+            engine->teardown(the_machine);
+            lmsm_delete(the_machine);
+        }
+    }
+    if (perf) {
+        lmsm_perf_close(&counters);
+    }
+    return EXIT_SUCCESS;
+}
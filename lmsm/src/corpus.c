@@ -0,0 +1,163 @@
+//
+// Differential runner: executes every program in a corpus on each
+// engine and reports any engine whose results differ from the others
+// or from the program's .expected output
+//
+
+#include "assembler.h"
+#include "engines.h"
+#include "lmsm.h"
+#include "perf.h"
+#include "source.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef LMSM_CORPUS_DIR
+#define LMSM_CORPUS_DIR "examples/corpus"
+#endif
+
+#define CORPUS_MAX_FILES 1024
+
+//======================================================
+//  Results
+//======================================================
+
+typedef struct corpus_result {
+    char output[OUTPUT_BUFFER_SIZE];
+    int error_code;
+    int accumulator;
+} corpus_result;
+
+// counters are only read around the run itself when given
+void corpus_run(lmsm_engine *engine, int code[100], corpus_result *result, lmsm_perf_counters *counters) {
+    lmsm *the_machine = lmsm_create();
+    engine->setup(the_machine);
+    lmsm_load(the_machine, code, 100);
+    if (counters) {
+        lmsm_perf_start(counters);
+    }
+    engine->run(the_machine);
+    if (counters) {
+        lmsm_perf_stop(counters);
+    }
+    strcpy(result->output, the_machine->output_buffer);
+    result->error_code = the_machine->error_code;
+    result->accumulator = the_machine->accumulator;
+    engine->teardown(the_machine);
+    lmsm_delete(the_machine);
+}
+
+// checks a single program, returns 1 if every engine agrees
+int corpus_check_file(char *filename, int options, lmsm_engine *only_engine, lmsm_perf_counters *counters) {
+    int code[100];
+    char inputs[100];
+    if (!lmsm_engine_build_file(filename, options, code, inputs)) {
+        printf("FAIL %s: unable to build\n", filename);
+        return 0;
+    }
+    for (int i = 0; i < 100; ++i) {
+        if (inputs[i]) {
+            printf("SKIP %s: reads input\n", filename);
+            return 1;
+        }
+    }
+
+    long steps = 0;
+    if (counters) {
+        int error_code;
+        steps = lmsm_engine_count_steps(code, &error_code);
+    }
+
+    char expected_filename[1024];
+    snprintf(expected_filename, sizeof(expected_filename), "%s.expected", filename);
+    lmsm_source expected_source;
+    char *expected = lmsm_source_open(&expected_source, expected_filename) ? expected_source.text : NULL;
+
+    int ok = 1;
+    static corpus_result baseline, result;
+    lmsm_engine *baseline_engine = NULL;
+    for (int e = 0; e < LMSM_ENGINE_COUNT; ++e) {
+        lmsm_engine *engine = &LMSM_ENGINES[e];
+        if (only_engine && engine != only_engine) {
+            continue;
+        }
+        corpus_result *current = baseline_engine ? &result : &baseline;
+        corpus_run(engine, code, current, counters);
+        if (counters) {
+            char report[256];
+            lmsm_perf_format(counters, (double) steps, report, sizeof(report));
+            printf("perf %s %s %ld steps%s\n", filename, engine->name, steps, report);
+        }
+        if (current->error_code != ERROR_NONE) {
+            printf("FAIL %s: %s halted with error %d\n", filename, engine->name, current->error_code);
+            ok = 0;
+        }
+        if (expected && strcmp(expected, current->output) != 0) {
+            printf("FAIL %s: %s printed '%s', expected '%s'\n", filename, engine->name, current->output, expected);
+            ok = 0;
+        }
+        if (baseline_engine == NULL) {
+            baseline_engine = engine;
+        } else if (strcmp(baseline.output, result.output) != 0 ||
+                   baseline.error_code != result.error_code ||
+                   baseline.accumulator != result.accumulator) {
+            printf("FAIL %s: %s and %s disagree\n", filename, baseline_engine->name, engine->name);
+            ok = 0;
+        }
+    }
+    if (expected) {
+        lmsm_source_close(&expected_source);
+    }
+    if (ok) {
+        printf("ok   %s\n", filename);
+    }
+    return ok;
+}
+
+//======================================================
+//  Main
+//======================================================
+
+int main(int argc, char *argv[]) {
+    static char *files[CORPUS_MAX_FILES];
+    int count = 0;
+    lmsm_engine *only_engine = NULL;
+    lmsm_perf_counters counters;
+    lmsm_perf_counters *perf = NULL;
+    int options = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            only_engine = lmsm_engine_find(argv[++i]);
+            if (only_engine == NULL) {
+                printf("Unknown engine '%s'\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "-O") == 0) {
+            options = ASM_OPTIMIZE;  // the optimized programs must still match .expected
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            if (lmsm_perf_open(&counters)) {
+                perf = &counters;
+            } else {
+                printf("Hardware performance counters are not available, check perf_event_paranoid\n");
+            }
+        } else {
+            count = lmsm_engine_collect_programs(argv[i], files, count, CORPUS_MAX_FILES);
+        }
+    }
+    if (count == 0) {
+        count = lmsm_engine_collect_programs(LMSM_CORPUS_DIR, files, count, CORPUS_MAX_FILES);
+    }
+
+    int failures = 0;
+    for (int i = 0; i < count; ++i) {
+        failures += !corpus_check_file(files[i], options, only_engine, perf);
+        free(files[i]);
+    }
+    if (perf) {
+        lmsm_perf_close(perf);
+    }
+    printf("%d programs, %d failed\n", count, failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
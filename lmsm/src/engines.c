@@ -0,0 +1,283 @@
+//
+// The ways the emulator can execute a program, shared by the
+// benchmark and corpus tools
+//
+
+#include "engines.h"
+#include "assembler.h"
+#include "firth.h"
+#include "history.h"
+#include "source.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+//======================================================
+//  Engine Implementations
+//======================================================
+
+void lmsm_engine_no_setup(lmsm *the_machine) {
+    (void) the_machine;
+}
+
+void lmsm_engine_breakpoint_setup(lmsm *the_machine) {
+    lmsm_set_breakpoint(the_machine, TOP_OF_MEMORY, 1);  // never reached, just turns on checking
+}
+
+void lmsm_engine_run_until_break(lmsm *the_machine) {
+    lmsm_run_until_break(the_machine);
+}
+
+void lmsm_engine_history_setup(lmsm *the_machine) {
+    lmsm_history_enable(the_machine, HISTORY_DEFAULT_CHECKPOINT_INTERVAL);
+}
+
+// where the trace engine writes, a fresh file in the system temp
+// directory so concurrent runs don't share it.  empty when not tracing
+static char lmsm_engine_trace_path[1024];
+
+// creates an empty temp file and records its name, returns 0 on failure
+int lmsm_engine_trace_create_file() {
+#ifdef _WIN32
+    char directory[MAX_PATH];
+    DWORD length = GetTempPathA(sizeof(directory), directory);
+    if (length == 0 || length > sizeof(directory) ||
+        GetTempFileNameA(directory, "lmt", 0, lmsm_engine_trace_path) == 0) {
+        lmsm_engine_trace_path[0] = '\0';
+        return 0;
+    }
+    return 1;
+#else
+    char *directory = getenv("TMPDIR");
+    if (directory == NULL || directory[0] == '\0') {
+        directory = "/tmp";
+    }
+    snprintf(lmsm_engine_trace_path, sizeof(lmsm_engine_trace_path), "%s/lmsm_engine_XXXXXX", directory);
+    int fd = mkstemp(lmsm_engine_trace_path);
+    if (fd < 0) {
+        lmsm_engine_trace_path[0] = '\0';
+        return 0;
+    }
+    close(fd);
+    return 1;
+#endif
+}
+
+void lmsm_engine_trace_setup(lmsm *the_machine) {
+    if (lmsm_engine_trace_create_file()) {
+        lmsm_trace_start(the_machine, lmsm_engine_trace_path, 0);
+    }
+}
+
+void lmsm_engine_trace_teardown(lmsm *the_machine) {
+    lmsm_trace_stop(the_machine);
+    if (lmsm_engine_trace_path[0] != '\0') {
+        remove(lmsm_engine_trace_path);
+        lmsm_engine_trace_path[0] = '\0';
+    }
+}
+
+lmsm_engine LMSM_ENGINES[] = {
+        {"interpreter", lmsm_engine_no_setup, lmsm_run, lmsm_engine_no_setup},
+        {"breakpoints", lmsm_engine_breakpoint_setup, lmsm_engine_run_until_break, lmsm_engine_no_setup},
+        {"history", lmsm_engine_history_setup, lmsm_run, lmsm_engine_no_setup},
+        {"trace", lmsm_engine_trace_setup, lmsm_run, lmsm_engine_trace_teardown},
+};
+const int LMSM_ENGINE_COUNT = sizeof(LMSM_ENGINES) / sizeof(LMSM_ENGINES[0]);
+
+//======================================================
+//  Helpers
+//======================================================
+
+lmsm_engine *lmsm_engine_find(char *name) {
+    for (int i = 0; i < LMSM_ENGINE_COUNT; ++i) {
+        if (strcmp(name, LMSM_ENGINES[i].name) == 0) {
+            return &LMSM_ENGINES[i];
+        }
+    }
+    return NULL;
+}
+
+void lmsm_engine_mark_inputs(asm_compilation_result *result, char inputs[100]) {
+    memset(inputs, 0, 100);
+    for (asm_instruction *instruction = result->root; instruction != NULL; instruction = instruction->next) {
+        if (instruction->opcode == ASM_INP) {
+            inputs[instruction->offset] = 1;
+        }
+    }
+}
+
+int lmsm_engine_build(char *src, int firth, int options, int code[100], char inputs[100]) {
+    if (inputs) {
+        options |= ASM_KEEP_INSTRUCTIONS;
+    }
+    if (firth) {
+        // straight to code, the assembly text is never needed here
+        int firth_options = FIRTH_ASSEMBLE | (options & ASM_OPTIMIZE ? FIRTH_OPTIMIZE : 0);
+        firth_compilation_result *firth_result = firth_compile_with_options(src, firth_options, options);
+        int ok = firth_result->error == NULL && firth_result->assembled->error == NULL;
+        memcpy(code, firth_result->assembled->code, sizeof(int) * 100);
+        if (inputs) {
+            lmsm_engine_mark_inputs(firth_result->assembled, inputs);
+        }
+        firth_delete_compilation_result(firth_result);
+        return ok;
+    }
+    asm_compilation_result *result = asm_assemble_with_options(src, options);
+    int ok = result->error == NULL;
+    memcpy(code, result->code, sizeof(int) * 100);
+    if (inputs) {
+        lmsm_engine_mark_inputs(result, inputs);
+    }
+    asm_delete_compilation_result(result);
+    return ok;
+}
+
+int lmsm_engine_has_extension(char *filename, char *extension) {
+    size_t length = strlen(filename);
+    size_t extension_length = strlen(extension);
+    return length > extension_length && strcmp(filename + length - extension_length, extension) == 0;
+}
+
+int lmsm_engine_write_image(char *filename, int code[100]) {
+    unsigned char image[LMSM_IMAGE_SIZE];
+    for (int i = 0; i < 100; ++i) {
+        unsigned short word = (unsigned short) (short) code[i];
+        image[2 * i] = word & 0xff;
+        image[2 * i + 1] = word >> 8;
+    }
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        return 0;
+    }
+    int ok = fwrite(image, 1, LMSM_IMAGE_SIZE, file) == LMSM_IMAGE_SIZE;
+    return fclose(file) == 0 && ok;
+}
+
+int lmsm_engine_read_image(char *filename, int code[100]) {
+    unsigned char image[LMSM_IMAGE_SIZE];
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    int ok = fread(image, 1, LMSM_IMAGE_SIZE, file) == LMSM_IMAGE_SIZE;
+    fclose(file);
+    for (int i = 0; ok && i < 100; ++i) {
+        code[i] = (short) (image[2 * i] | image[2 * i + 1] << 8);
+    }
+    return ok;
+}
+
+int lmsm_engine_build_file(char *filename, int options, int code[100], char inputs[100]) {
+    if (lmsm_engine_has_extension(filename, ".bin")) {
+        int ok = lmsm_engine_read_image(filename, code);
+        for (int i = 0; inputs && i < 100; ++i) {
+            inputs[i] = code[i] == 901;
+        }
+        return ok;
+    }
+    lmsm_source source;
+    if (!lmsm_source_open(&source, filename)) {
+        return 0;
+    }
+    int ok = lmsm_engine_build(source.text, lmsm_engine_has_extension(filename, ".firth"), options, code, inputs);
+    lmsm_source_close(&source);
+    return ok;
+}
+
+long lmsm_engine_count_steps(int code[100], int *error_code) {
+    lmsm *the_machine = lmsm_create();
+    lmsm_load(the_machine, code, 100);
+    the_machine->status = STATUS_RUNNING;
+    long steps = 0;
+    while (the_machine->status != STATUS_HALTED) {
+        lmsm_step(the_machine);
+        steps++;
+    }
+    *error_code = the_machine->error_code;
+    lmsm_delete(the_machine);
+    return steps;
+}
+
+int lmsm_engine_compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+// adds a directory entry if it is a program
+int lmsm_engine_add_program(char *path, char *name, char *files[], int count) {
+    if (lmsm_engine_has_extension(name, ".asm") || lmsm_engine_has_extension(name, ".firth")) {
+        size_t size = strlen(path) + strlen(name) + 2;
+        files[count] = malloc(size);
+        snprintf(files[count], size, "%s/%s", path, name);
+        count++;
+    }
+    return count;
+}
+
+#ifdef _WIN32
+
+// the programs in a directory, or -1 if path isn't one
+int lmsm_engine_read_directory(char *path, char *files[], int count, int max) {
+    DWORD attributes = GetFileAttributesA(path);
+    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return -1;
+    }
+    size_t size = strlen(path) + 3;
+    char *pattern = malloc(size);
+    snprintf(pattern, size, "%s/*", path);
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA(pattern, &entry);
+    free(pattern);
+    if (find == INVALID_HANDLE_VALUE) {
+        return count;
+    }
+    do {
+        count = lmsm_engine_add_program(path, entry.cFileName, files, count);
+    } while (count < max && FindNextFileA(find, &entry));
+    FindClose(find);
+    return count;
+}
+
+#else
+
+// the programs in a directory, or -1 if path isn't one
+int lmsm_engine_read_directory(char *path, char *files[], int count, int max) {
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return -1;
+    }
+    struct dirent *entry;
+    while (count < max && (entry = readdir(dir)) != NULL) {
+        count = lmsm_engine_add_program(path, entry->d_name, files, count);
+    }
+    closedir(dir);
+    return count;
+}
+
+#endif
+
+int lmsm_engine_collect_programs(char *path, char *files[], int count, int max) {
+    int start = count;
+    count = lmsm_engine_read_directory(path, files, count, max);
+    if (count < 0) {
+        count = start;
+        if (count < max) {
+            files[count] = malloc(strlen(path) + 1);
+            strcpy(files[count++], path);
+        }
+        return count;
+    }
+    qsort(files + start, count - start, sizeof(char *), lmsm_engine_compare_names);
+    return count;
+}
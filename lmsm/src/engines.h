@@ -0,0 +1,54 @@
+//
+// The ways the emulator can execute a program, shared by the
+// benchmark and corpus tools
+//
+
+#ifndef LMSM_ENGINES_H
+#define LMSM_ENGINES_H
+
+#include "lmsm.h"
+
+//===================================================================
+//  An execution engine
+//===================================================================
+typedef struct lmsm_engine {
+    char *name;
+    void (*setup)(lmsm *the_machine);     // called once on a fresh machine
+    void (*run)(lmsm *the_machine);       // runs a loaded program to completion
+    void (*teardown)(lmsm *the_machine);  // called before the machine is deleted
+} lmsm_engine;
+
+extern lmsm_engine LMSM_ENGINES[];
+extern const int LMSM_ENGINE_COUNT;
+
+//===================================================================
+//  API
+//===================================================================
+
+// finds an engine by name, or NULL
+lmsm_engine *lmsm_engine_find(char *name);
+
+int lmsm_engine_has_extension(char *filename, char *extension);
+
+// assembles (or compiles, if firth is set) the source into code with the given ASM_ options,
+// returns 0 on error. unless inputs is NULL, it is set to 1 at each INP instruction, so
+// tools can tell them from data that happens to be 901
+int lmsm_engine_build(char *src, int firth, int options, int code[100], char inputs[100]);
+
+#define LMSM_IMAGE_SIZE 200
+
+// builds a .asm or .firth file or loads a binary image, returns 0 on error. an image has
+// no instructions to go by, so every 901 in it counts as an input
+int lmsm_engine_build_file(char *filename, int options, int code[100], char inputs[100]);
+
+// writes code as a binary image: 100 little-endian 16-bit words. returns 0 on error
+int lmsm_engine_write_image(char *filename, int code[100]);
+
+// collects path, or the .asm and .firth files directly inside it in sorted order,
+// into files. returns the new count
+int lmsm_engine_collect_programs(char *path, char *files[], int count, int max);
+
+// counts the guest instructions the program executes, and the error it halts with
+long lmsm_engine_count_steps(int code[100], int *error_code);
+
+#endif //LMSM_ENGINES_H
@@ -8,30 +8,29 @@
 // Tokenization
 //======================================================
 
-firth_tokens *firth_tokenize(char *firth_src) {
-    char *src = calloc(strlen(firth_src) + 1, sizeof(char));
-    strcat(src, firth_src);
-    char *str = strtok(src, " \n");
-    firth_tokens *tokens = calloc(1, sizeof(firth_tokens));
-    tokens->original_src = src;
-    while (str != NULL) {
-        firth_token *token = calloc(1, sizeof(firth_token));
-        token->value = str;
+firth_tokens *firth_tokenize(char *firth_src, lmsm_arena *arena) {
+    lmsm_lexer lexer;
+    lmsm_lexer_init(&lexer, firth_src);
+    lmsm_span span;
+    firth_tokens *tokens = lmsm_arena_alloc(arena, sizeof(firth_tokens));
+    tokens->original_src = firth_src;
+    while (lmsm_lexer_next(&lexer, &span)) {
+        firth_token *token = lmsm_arena_alloc(arena, sizeof(firth_token));
+        token->span = span;
         if (tokens->start == NULL) {
             tokens->start = token;
         }
-        if (tokens->current != NULL) {
-            tokens->current->next = token;
+        if (tokens->last != NULL) {
+            tokens->last->next = token;
         }
-        tokens->current = token;
-        str = strtok(NULL, " \n");
+        tokens->last = token;
     }
     tokens->current = tokens->start;
     return tokens;
 }
 
 int firth_match_token(char *str, firth_tokens *tokens) {
-    return tokens->current && strcmp(str, tokens->current->value) == 0;
+    return tokens->current && lmsm_span_equals(&tokens->current->span, str);
 }
 
 int firth_has_more_tokens(firth_tokens *tokens) {
@@ -40,14 +39,7 @@ int firth_has_more_tokens(firth_tokens *tokens) {
 
 int firth_token_ends_with(firth_token * token, char *suffix)
 {
-    if(strlen(token->value) >= strlen(suffix))
-    {
-        if(!strcmp(token->value + strlen(token->value) - strlen(suffix), suffix))
-        {
-            return 1;
-        }
-    }
-    return 0;
+    return token != NULL && lmsm_span_ends_with(&token->span, suffix);
 }
 
 firth_token *firth_take_token(firth_tokens *tokens) {
@@ -72,15 +64,20 @@ firth_parse_element *firth_parse_elt(firth_tokens *tokens, firth_compilation_res
 
 // implementations
 
-void firth_delete_exprs(firth_parse_elements *elts);
-
-firth_parse_element *firth_make_elt(firth_token *token, firth_parse_element_type type){
-    firth_parse_element *elt = calloc(1, sizeof(firth_parse_element));
+// elements and their lists live in the result's arena, so elements dropped from the
+// tree are simply unlinked and go with the rest when the result is deleted
+firth_parse_element *firth_make_elt(firth_compilation_result *result, firth_token *token,
+                                    firth_parse_element_type type){
+    firth_parse_element *elt = lmsm_arena_alloc(result->arena, sizeof(firth_parse_element));
     elt->token = token;
     elt->type = type;
     return elt;
 }
 
+firth_parse_elements *firth_make_elts(firth_compilation_result *result) {
+    return lmsm_arena_alloc(result->arena, sizeof(firth_parse_elements));
+}
+
 void firth_add_element(firth_parse_elements *elements, firth_parse_element *elt) {
     if (elements->first == NULL) {
         elements->first = elt;
@@ -92,15 +89,15 @@ void firth_add_element(firth_parse_elements *elements, firth_parse_element *elt)
 }
 
 firth_parse_element *firth_parse_num(firth_tokens *tokens, firth_compilation_result *result) {
-    if (asm_is_num(tokens->current->value)) {
-        return firth_make_elt(firth_take_token(tokens), NUMBER);
+    if (lmsm_span_is_number(&tokens->current->span)) {
+        return firth_make_elt(result, firth_take_token(tokens), NUMBER);
     }
     return NULL;
 }
 
 firth_parse_element *firth_parse_def(firth_tokens *tokens, firth_compilation_result *result) {
     if (firth_match_token("def", tokens)) {
-        firth_parse_element *fun = firth_make_elt(firth_take_token(tokens), DEF);
+        firth_parse_element *fun = firth_make_elt(result, firth_take_token(tokens), DEF);
 
         firth_token *function_name = firth_take_token(tokens);
         if (!firth_token_ends_with(function_name, "()")) {
@@ -109,7 +106,7 @@ firth_parse_element *firth_parse_def(firth_tokens *tokens, firth_compilation_res
         }
         fun->name = function_name;
 
-        fun->left_children = calloc(1, sizeof(firth_parse_elements));
+        fun->left_children = firth_make_elts(result);
 
         while (firth_has_more_tokens(tokens) &&
                !firth_match_token("end", tokens)) {
@@ -127,7 +124,7 @@ firth_parse_element *firth_parse_def(firth_tokens *tokens, firth_compilation_res
 
 firth_parse_element *firth_parse_call(firth_tokens *tokens, firth_compilation_result *result) {
     if (tokens->current && firth_token_ends_with(tokens->current, "()")) {
-        firth_parse_element *call = firth_make_elt(firth_take_token(tokens), CALL);
+        firth_parse_element *call = firth_make_elt(result, firth_take_token(tokens), CALL);
         return call;
     }
     return NULL;
@@ -146,17 +143,17 @@ firth_parse_element *firth_parse_op(firth_tokens *tokens, firth_compilation_resu
         firth_match_token("swap", tokens) ||
         firth_match_token("return", tokens) ||
         firth_match_token(".", tokens)) {
-        return firth_make_elt(firth_take_token(tokens), OP);
+        return firth_make_elt(result, firth_take_token(tokens), OP);
     }
     return NULL;
 }
 
 firth_parse_element *firth_parse_zero(firth_tokens *tokens, firth_compilation_result *result) {
     if (firth_match_token("zero?", tokens)) {
-        firth_parse_element *zero = firth_make_elt(firth_take_token(tokens), ZERO_TEST);
+        firth_parse_element *zero = firth_make_elt(result, firth_take_token(tokens), ZERO_TEST);
 
-        zero->left_children = calloc(1, sizeof(firth_parse_elements));
-        zero->right_children = calloc(1, sizeof(firth_parse_elements));
+        zero->left_children = firth_make_elts(result);
+        zero->right_children = firth_make_elts(result);
 
         while (firth_has_more_tokens(tokens) &&
                !firth_match_token("else", tokens) &&
@@ -207,7 +204,7 @@ firth_parse_element *firth_parse_elt(firth_tokens *tokens, firth_compilation_res
         return call;
     }
 
-    firth_parse_element *error_elt = firth_make_elt(firth_take_token(tokens), ERROR);
+    firth_parse_element *error_elt = firth_make_elt(result, firth_take_token(tokens), ERROR);
     firth_report_error("Unknown token", tokens, result);
     return error_elt;
 }
@@ -216,123 +213,239 @@ firth_parse_element *firth_parse_elt(firth_tokens *tokens, firth_compilation_res
 // Code Generation
 //======================================================
 int firth_elt_token_equals(const firth_parse_element * elt, const char *s2) {
-    return strcmp(elt->token->value, s2) == 0;
+    return lmsm_span_equals(&elt->token->span, s2);
+}
+
+// appends to the assembly, growing it as needed. running out of memory is a compile error
+void firth_emit_n(firth_compilation_result *result, const char *text, int length) {
+    if (result->assembly_length + length + 1 > result->assembly_capacity) {
+        int capacity = result->assembly_capacity ? result->assembly_capacity : 256;
+        while (result->assembly_length + length + 1 > capacity) {
+            capacity *= 2;
+        }
+        char *grown = realloc(result->lmsm_assembly, capacity);
+        if (grown == NULL) {
+            result->error = FIRTH_ERROR_OUT_OF_MEMORY;
+            return;
+        }
+        result->lmsm_assembly = grown;
+        result->assembly_capacity = capacity;
+    }
+    memcpy(result->lmsm_assembly + result->assembly_length, text, length);
+    result->assembly_length += length;
+    result->lmsm_assembly[result->assembly_length] = '\0';
+}
+
+void firth_emit(firth_compilation_result *result, const char *text) {
+    firth_emit_n(result, text, (int) strlen(text));
+}
+
+// labels the next instruction. the code is generated as if from the assembly text, one
+// instruction per line with labels in front, so lines and columns agree either way
+void firth_gen_label_n(firth_compilation_result *result, const char *name, int length) {
+    if (result->options & FIRTH_EMIT_ASSEMBLY) {
+        firth_emit_n(result, name, length);
+        firth_emit(result, " ");
+    }
+    if (result->options & FIRTH_ASSEMBLE) {
+        lmsm_span span = {name, length, result->assembly_lines + 1, result->assembly_column};
+        asm_builder_label(result->builder, &span);
+    }
+    result->assembly_column += length + 1;
+}
+
+void firth_gen_label(firth_compilation_result *result, const char *name) {
+    firth_gen_label_n(result, name, (int) strlen(name));
+}
+
+// generates an instruction, argument is a number or label and NULL if it takes none
+void firth_gen_instruction_n(firth_compilation_result *result, asm_opcode opcode, const char *argument,
+                             int length) {
+    const char *mnemonic = ASM_OPCODES[opcode].mnemonic;
+    if (result->options & FIRTH_EMIT_ASSEMBLY) {
+        firth_emit(result, mnemonic);
+        if (argument) {
+            firth_emit(result, " ");
+            firth_emit_n(result, argument, length);
+        }
+        firth_emit(result, "\n");
+    }
+    if (result->options & FIRTH_ASSEMBLE) {
+        int line = result->assembly_lines + 1;
+        lmsm_span at = {mnemonic, (int) strlen(mnemonic), line, 1};
+        lmsm_span span = {argument, length, line, result->assembly_column + (int) strlen(mnemonic) + 1};
+        asm_builder_instruction(result->builder, opcode, argument ? &span : NULL, &at);
+    }
+    result->assembly_lines++;
+    result->assembly_column = 1;
+}
+
+void firth_gen_instruction(firth_compilation_result *result, asm_opcode opcode, const char *argument) {
+    firth_gen_instruction_n(result, opcode, argument, argument ? (int) strlen(argument) : 0);
 }
 
-void firth_code_gen_elt(firth_parse_element * elt, firth_compilation_result *result) {
+// notes that the code generated from here on, starting on the current line, is for elt
+void firth_mark_origin(firth_compilation_result *result, firth_parse_element *elt) {
+    int line = result->assembly_lines + 1;
+    if (result->origin_count > 0 && result->origins[result->origin_count - 1].assembly_line == line) {
+        result->origin_count--;  // nothing was generated on this line since, e.g. after a label
+    }
+    if (result->origin_count == result->origin_capacity) {
+        result->origin_capacity = result->origin_capacity ? result->origin_capacity * 2 : 64;
+        result->origins = realloc(result->origins, result->origin_capacity * sizeof(firth_origin));
+    }
+    firth_origin origin = {line, elt};
+    result->origins[result->origin_count++] = origin;
+}
+
+firth_parse_element *firth_origin_of_line(firth_compilation_result *result, int assembly_line) {
+    int low = 0, high = result->origin_count - 1, found = -1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (result->origins[middle].assembly_line <= assembly_line) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return found >= 0 ? result->origins[found].element : NULL;
+}
+
+int firth_code_gen_elt(firth_parse_element *elt, firth_compilation_result *result, int tail, char *after);
+
+int firth_elt_is_return(firth_parse_element *elt) {
+    return elt != NULL && elt->type == OP && firth_elt_token_equals(elt, "return");
+}
+
+// generates a list of elements, returns 0 if control never reaches the code after them. with
+// FIRTH_OPTIMIZE nothing is generated past an element control never gets past. after is the
+// label generated right after the list, if there is one
+int firth_code_gen_elts(firth_parse_element *elt, firth_compilation_result *result, int tail, char *after) {
+    int falls_through = 1;
+    for (; elt != NULL; elt = elt->next_sibling) {
+        if (falls_through || elt->type == DEF) {
+            // a call right before a return is in tail position too
+            int elt_tail = elt->next_sibling ? firth_elt_is_return(elt->next_sibling) : tail;
+            falls_through = firth_code_gen_elt(elt, result, elt_tail, elt->next_sibling ? NULL : after) &&
+                            falls_through;
+        }
+    }
+    return falls_through;
+}
+
+// generates elt, returns 0 if control never reaches the code after it. in tail position
+// elt's code is the last to run before the function returns, so with FIRTH_OPTIMIZE a
+// call there branches to the function instead, which then returns for both. the branch
+// doesn't load the function's address into the accumulator the way CALL does. after is the
+// label generated right after elt, if there is one
+int firth_code_gen_elt(firth_parse_element *elt, firth_compilation_result *result, int tail, char *after) {
+    int optimize = result->options & FIRTH_OPTIMIZE;
+    firth_mark_origin(result, elt);
     if (elt->type == OP) {
         if (firth_elt_token_equals(elt, ".")) {
-            strcat(result->lmsm_assembly, "SDUP\nSPOP\nOUT\n");
+            firth_gen_instruction(result, ASM_SDUP, NULL);
+            firth_gen_instruction(result, ASM_SPOP, NULL);
+            firth_gen_instruction(result, ASM_OUT, NULL);
         } else if (firth_elt_token_equals(elt, "+")) {
-            strcat(result->lmsm_assembly, "SADD\n");
+            firth_gen_instruction(result, ASM_SADD, NULL);
         } else if (firth_elt_token_equals(elt, "-")) {
-            strcat(result->lmsm_assembly, "SSUB\n");
+            firth_gen_instruction(result, ASM_SSUB, NULL);
         } else if (firth_elt_token_equals(elt, "*")) {
-            strcat(result->lmsm_assembly, "SMUL\n");
+            firth_gen_instruction(result, ASM_SMUL, NULL);
         } else if (firth_elt_token_equals(elt, "/")) {
-            strcat(result->lmsm_assembly, "SDIV\n");
+            firth_gen_instruction(result, ASM_SDIV, NULL);
         } else if (firth_elt_token_equals(elt, "max")) {
-            strcat(result->lmsm_assembly, "SMAX\n");
+            firth_gen_instruction(result, ASM_SMAX, NULL);
         } else if (firth_elt_token_equals(elt, "min")) {
-            strcat(result->lmsm_assembly, "SMIN\n");
+            firth_gen_instruction(result, ASM_SMIN, NULL);
         } else if (firth_elt_token_equals(elt, "get")) {
-            strcat(result->lmsm_assembly, "INP\nSPUSH\n");
+            firth_gen_instruction(result, ASM_INP, NULL);
+            firth_gen_instruction(result, ASM_SPUSH, NULL);
         } else if (firth_elt_token_equals(elt, "pop")) {
-            strcat(result->lmsm_assembly, "SPOP\n");
+            firth_gen_instruction(result, ASM_SPOP, NULL);
         } else if (firth_elt_token_equals(elt, "dup")) {
-            strcat(result->lmsm_assembly, "SDUP\n");
+            firth_gen_instruction(result, ASM_SDUP, NULL);
         } else if (firth_elt_token_equals(elt, "swap")) {
-            strcat(result->lmsm_assembly, "SSWAP\n");
+            firth_gen_instruction(result, ASM_SSWAP, NULL);
         } else if (firth_elt_token_equals(elt, "return")) {
-            strcat(result->lmsm_assembly, "RET\n");
+            firth_gen_instruction(result, ASM_RET, NULL);
+            return !optimize;
         }
     } else if (elt->type == NUMBER) {
-        strcat(result->lmsm_assembly, "LDI ");
-        strcat(result->lmsm_assembly, elt->token->value);
-        strcat(result->lmsm_assembly, "\n");
-        strcat(result->lmsm_assembly, "SPUSH\n");
+        firth_gen_instruction_n(result, ASM_LDI, elt->token->span.start, elt->token->span.length);
+        firth_gen_instruction(result, ASM_SPUSH, NULL);
     } else if (elt->type == ZERO_TEST) {
         char if_zero_label[20];
         sprintf(if_zero_label, "if_zero_%d", result->label_num++);
 
         char end_zero_label[20];
         sprintf(end_zero_label, "end_zero_%d", result->label_num++);
+        // an instruction only has one label, so one that would follow ours is used instead,
+        // as when this zero? ends the other branch of an enclosing one
+        char *end_label = after ? after : end_zero_label;
 
         // branch if top of stack zero
-        strcat(result->lmsm_assembly, "SPOP\nBRZ ");
-        if (elt->left_children->first) {
-            strcat(result->lmsm_assembly, if_zero_label);
-        } else {
-            strcat(result->lmsm_assembly, end_zero_label);
-        }
-        strcat(result->lmsm_assembly, "\n");
+        firth_gen_instruction(result, ASM_SPOP, NULL);
+        firth_gen_instruction(result, ASM_BRZ, elt->left_children->first ? if_zero_label : end_label);
 
         // generate else
-        if (elt->right_children->first) {
-            struct firth_parse_element *child = elt->right_children->first;
-            while (child != NULL) {
-                firth_code_gen_elt(child, result);
-                child = child->next_sibling;
-            }
-        }
+        int else_falls_through = firth_code_gen_elts(elt->right_children->first, result, tail, NULL);
 
         // jump to end of zero condition
-        strcat(result->lmsm_assembly, "BRA ");
-        strcat(result->lmsm_assembly, end_zero_label);
-        strcat(result->lmsm_assembly, "\n");
+        if (else_falls_through) {
+            firth_mark_origin(result, elt);
+            firth_gen_instruction(result, ASM_BRA, end_label);
+        }
 
         // generate if zero condition
+        int if_falls_through = 1;
         if (elt->left_children->first) {
-            strcat(result->lmsm_assembly, if_zero_label);
-            strcat(result->lmsm_assembly, " ");
-            struct firth_parse_element *child = elt->left_children->first;
-            while (child != NULL) {
-                firth_code_gen_elt(child, result);
-                child = child->next_sibling;
-            }
+            firth_gen_label(result, if_zero_label);
+            if_falls_through = firth_code_gen_elts(elt->left_children->first, result, tail, end_label);
         }
 
-        // label end of zero conditional
-        strcat(result->lmsm_assembly, end_zero_label);
-        strcat(result->lmsm_assembly, " ");
+        // label end of zero conditional, unless neither branch gets there
+        if (!else_falls_through && !if_falls_through) {
+            return 0;
+        }
+        if (after == NULL) {
+            firth_gen_label(result, end_label);
+        }
+    } else if (elt->type == CALL && tail && optimize) {
+        firth_gen_instruction_n(result, ASM_BRA, elt->token->span.start, elt->token->span.length);
+        return 0;
     } else if (elt->type == CALL) {
-        strcat(result->lmsm_assembly, "CALL ");
-        strcat(result->lmsm_assembly, elt->token->value);
-        strcat(result->lmsm_assembly, "\n");
+        firth_gen_instruction_n(result, ASM_CALL, elt->token->span.start, elt->token->span.length);
     } else if (elt->type == DEF) {
         // function label
-        strcat(result->lmsm_assembly, elt->name->value);
-        strcat(result->lmsm_assembly, " ");
-        // function body
-        if (elt->left_children->first) {
-            struct firth_parse_element *child = elt->left_children->first;
-            while (child != NULL) {
-                firth_code_gen_elt(child, result);
-                child = child->next_sibling;
-            }
+        firth_gen_label_n(result, elt->name->span.start, elt->name->span.length);
+        // function body, and a RET if it can run off the end
+        if (firth_code_gen_elts(elt->left_children->first, result, 1, NULL)) {
+            firth_mark_origin(result, elt);
+            firth_gen_instruction(result, ASM_RET, NULL);
         }
-        // always append a RET
-        strcat(result->lmsm_assembly, "RET\n");
     }
-
+    return 1;
 }
 
 void firth_code_gen_top_level(firth_compilation_result *result) {
     struct firth_parse_element *elt = result->root_elements->first;
     while (elt != NULL) {
         if (elt->type != DEF) {
-            firth_code_gen_elt(elt, result);
+            firth_code_gen_elt(elt, result, 0, NULL);
         }
         elt = elt->next_sibling;
     }
-    strcat(result->lmsm_assembly, "HLT\n");
+    firth_mark_origin(result, NULL);
+    firth_gen_instruction(result, ASM_HLT, NULL);
 }
 
 void firth_code_gen_functions(firth_compilation_result *result) {
     struct firth_parse_element *elt = result->root_elements->first;
     while (elt != NULL) {
         if (elt->type == DEF) {
-            firth_code_gen_elt(elt, result);
+            firth_code_gen_elt(elt, result, 0, NULL);
         }
         elt = elt->next_sibling;
     }
@@ -346,60 +459,573 @@ void firth_code_gen(firth_compilation_result *result) {
 }
 
 //======================================================
-// Entry Point
+// Constant Folding
 //======================================================
-void firth_delete_tokens(firth_tokens *tokens) {
-    firth_token *token = tokens->start;
-    while (token != NULL) {
-        firth_token *to_delete = token;
-        token = to_delete->next;
-        free(to_delete);
+#define FIRTH_FOLD_DEPTH 100  // the most values the stack holds
+
+int firth_fold_cap(int value) {
+    return value > 999 ? 999 : value < -999 ? -999 : value;
+}
+
+// applies elt to the constants on the stack exactly as the machine would, returns 0 if
+// elt isn't a number or an operation on constants that can be done at compile time
+int firth_fold_step(firth_parse_element *elt, int *stack, firth_parse_element **from, int *depth) {
+    int top = *depth > 0 ? stack[*depth - 1] : 0;
+    int below = *depth > 1 ? stack[*depth - 2] : 0;
+    if (elt->type == NUMBER) {
+        // LDI only loads 0..99, anything else is left to do whatever it does at runtime
+        int value = lmsm_span_to_int(&elt->token->span, 999);
+        if (value < 0 || value > 99 || *depth == FIRTH_FOLD_DEPTH) {
+            return 0;
+        }
+        from[*depth] = elt;
+        stack[(*depth)++] = value;
+        return 1;
+    } else if (elt->type != OP) {
+        return 0;
+    } else if (firth_elt_token_equals(elt, "dup")) {
+        if (*depth < 1 || *depth == FIRTH_FOLD_DEPTH) {
+            return 0;
+        }
+        from[*depth] = elt;
+        stack[(*depth)++] = top;
+        return 1;
+    } else if (*depth < 2) {
+        return 0;
     }
-    free(tokens->original_src);
+
+    int value;
+    if (firth_elt_token_equals(elt, "swap")) {
+        firth_parse_element *swapped = from[*depth - 1];
+        from[*depth - 1] = from[*depth - 2];
+        from[*depth - 2] = swapped;
+        stack[*depth - 1] = below;
+        stack[*depth - 2] = top;
+        return 1;
+    } else if (firth_elt_token_equals(elt, "+")) {
+        value = firth_fold_cap(below + top);
+    } else if (firth_elt_token_equals(elt, "-")) {
+        value = firth_fold_cap(below - top);
+    } else if (firth_elt_token_equals(elt, "*")) {
+        value = firth_fold_cap(below * top);
+    } else if (firth_elt_token_equals(elt, "/") && top != 0) {
+        value = below / top;  // SDIV truncates like C and doesn't cap
+    } else if (firth_elt_token_equals(elt, "max")) {
+        value = below > top ? below : top;
+    } else if (firth_elt_token_equals(elt, "min")) {
+        value = below < top ? below : top;
+    } else {
+        return 0;
+    }
+    (*depth)--;
+    from[*depth - 1] = elt;
+    stack[*depth - 1] = value;
+    return 1;
 }
 
-void firth_delete_compilation_result(firth_compilation_result * result){
-    firth_delete_exprs(result->root_elements);
-    firth_delete_tokens(result->tokens);
-    free(result);
+// whether the code from next on may read the accumulator as it is now. stack arithmetic
+// leaves it alone, and every other element but return loads it before using it
+int firth_fold_accumulator_read_after(firth_parse_element *next) {
+    while (next != NULL && next->type == OP && !firth_elt_token_equals(next, "return") &&
+           !firth_elt_token_equals(next, "pop") && !firth_elt_token_equals(next, ".") &&
+           !firth_elt_token_equals(next, "get")) {
+        next = next->next_sibling;
+    }
+    return next == NULL || next->type == DEF || (next->type == OP && firth_elt_token_equals(next, "return"));
+}
+
+// a NUMBER for a folded value, its token is where the value was computed
+firth_parse_element *firth_fold_number(firth_compilation_result *result, int value, firth_parse_element *from) {
+    firth_token *token = lmsm_arena_alloc(result->arena, sizeof(firth_token) + 4);  // the text follows the token
+    char *text = (char *) (token + 1);
+    lmsm_span span = {text, sprintf(text, "%d", value), from->token->span.line, from->token->span.column};
+    token->span = span;
+    result->tokens->last->next = token;
+    result->tokens->last = token;
+    return firth_make_elt(result, token, NUMBER);
+}
+
+// replaces each run of constant stack operations with the values it leaves, when that is
+// smaller. the accumulator is left as it would have been wherever it might be read
+void firth_fold_elements(firth_parse_elements *elements, firth_compilation_result *result) {
+    for (firth_parse_element *elt = elements->first; elt != NULL; elt = elt->next_sibling) {
+        if (elt->left_children) {
+            firth_fold_elements(elt->left_children, result);
+        }
+        if (elt->right_children) {
+            firth_fold_elements(elt->right_children, result);
+        }
+    }
+
+    firth_parse_element *before = NULL;
+    firth_parse_element *start = elements->first;
+    while (start != NULL) {
+        int stack[FIRTH_FOLD_DEPTH], folded[FIRTH_FOLD_DEPTH];
+        firth_parse_element *from[FIRTH_FOLD_DEPTH], *folded_from[FIRTH_FOLD_DEPTH];
+        int depth = 0, folded_depth = 0, slots = 0, accumulator = 0;
+        firth_parse_element *end = NULL;  // the last element of the longest run worth folding
+        for (firth_parse_element *elt = start; elt != NULL && firth_fold_step(elt, stack, from, &depth);
+             elt = elt->next_sibling) {
+            slots += elt->type == NUMBER ? 2 : 1;
+            if (elt->type == NUMBER) {
+                accumulator = stack[depth - 1];
+            }
+            int smaller = 2 * depth < slots;
+            for (int i = 0; smaller && i < depth; ++i) {
+                smaller = 0 <= stack[i] && stack[i] <= 99;  // each value is an LDI and SPUSH
+            }
+            if (smaller && (stack[depth - 1] == accumulator ||
+                             !firth_fold_accumulator_read_after(elt->next_sibling))) {
+                end = elt;
+                folded_depth = depth;
+                memcpy(folded, stack, sizeof(int) * depth);
+                memcpy(folded_from, from, sizeof(firth_parse_element *) * depth);
+            }
+        }
+        if (end == NULL) {
+            before = start;
+            start = start->next_sibling;
+            continue;
+        }
+
+        firth_parse_element *after = end->next_sibling;
+        for (int i = 0; i < folded_depth; ++i) {
+            firth_parse_element *number = firth_fold_number(result, folded[i], folded_from[i]);
+            if (before) {
+                before->next_sibling = number;
+            } else {
+                elements->first = number;
+            }
+            before = number;
+        }
+        before->next_sibling = after;
+        if (after == NULL) {
+            elements->last = before;
+        }
+        start = after;
+    }
+}
+
+//======================================================
+// Call Graph
+//======================================================
+
+// the slots code generation takes for elements, counting calls and branches at their
+// unoptimized size so the total is never less than the code that is finally generated
+int firth_code_size(firth_parse_element *elt);
+
+int firth_code_size_elt(firth_parse_element *elt) {
+    if (elt->type == NUMBER || (elt->type == OP && firth_elt_token_equals(elt, "get"))) {
+        return 2;
+    } else if (elt->type == OP && firth_elt_token_equals(elt, ".")) {
+        return 3;
+    } else if (elt->type == CALL) {
+        return 3;
+    } else if (elt->type == ZERO_TEST) {
+        return 3 + firth_code_size(elt->left_children->first) + firth_code_size(elt->right_children->first);
+    } else if (elt->type == DEF) {
+        return 1 + firth_code_size(elt->left_children->first);
+    }
+    return 1;
+}
+
+int firth_code_size(firth_parse_element *elt) {
+    int size = 0;
+    for (; elt != NULL; elt = elt->next_sibling) {
+        size += firth_code_size_elt(elt);
+    }
+    return size;
+}
+
+int firth_span_equals(const lmsm_span *a, const lmsm_span *b) {
+    return a->length == b->length && memcmp(a->start, b->start, a->length) == 0;
+}
+
+int firth_calls_function(firth_parse_element *call, firth_parse_element *def) {
+    return call->type == CALL && firth_span_equals(&call->token->span, &def->name->span);
+}
+
+// the top level definition of a function, NULL if there is none or more than one
+firth_parse_element *firth_function_named(firth_compilation_result *result, const lmsm_span *name) {
+    firth_parse_element *found = NULL;
+    for (firth_parse_element *elt = result->root_elements->first; elt != NULL; elt = elt->next_sibling) {
+        if (elt->type == DEF && firth_span_equals(&elt->name->span, name)) {
+            if (found) {
+                return NULL;
+            }
+            found = elt;
+        }
+    }
+    return found;
 }
 
-void firth_delete_expr(firth_parse_element *elt) {
+int firth_count_calls(firth_parse_element *elt, firth_parse_element *def) {
+    int count = 0;
+    for (; elt != NULL; elt = elt->next_sibling) {
+        if (firth_calls_function(elt, def)) {
+            count++;
+        } else if (elt->left_children) {
+            count += firth_count_calls(elt->left_children->first, def);
+            if (elt->right_children) {
+                count += firth_count_calls(elt->right_children->first, def);
+            }
+        }
+    }
+    return count;
+}
+
+// whether the elements, or any function they call, call def. visited holds the
+// functions already searched, with room for all of them
+int firth_reaches_function(firth_compilation_result *result, firth_parse_element *elt, firth_parse_element *def,
+                           firth_parse_element **visited, int *visited_count) {
+    for (; elt != NULL; elt = elt->next_sibling) {
+        if (elt->type == CALL) {
+            firth_parse_element *callee = firth_function_named(result, &elt->token->span);
+            if (callee == def) {
+                return 1;
+            }
+            int searched = callee == NULL;
+            for (int i = 0; !searched && i < *visited_count; ++i) {
+                searched = visited[i] == callee;
+            }
+            if (!searched) {
+                visited[(*visited_count)++] = callee;
+                if (firth_reaches_function(result, callee->left_children->first, def, visited, visited_count)) {
+                    return 1;
+                }
+            }
+        } else if (elt->type == ZERO_TEST &&
+                   (firth_reaches_function(result, elt->left_children->first, def, visited, visited_count) ||
+                    firth_reaches_function(result, elt->right_children->first, def, visited, visited_count))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int firth_contains_type(firth_parse_element *elt, firth_parse_element_type type, char *op) {
+    for (; elt != NULL; elt = elt->next_sibling) {
+        if ((elt->type == type && (op == NULL || firth_elt_token_equals(elt, op))) ||
+            (elt->left_children && firth_contains_type(elt->left_children->first, type, op)) ||
+            (elt->right_children && firth_contains_type(elt->right_children->first, type, op))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int firth_contains_return(firth_parse_element *elt) {
+    return firth_contains_type(elt, OP, "return");
+}
+
+//======================================================
+// Dead Functions
+//======================================================
+
+void firth_mark_reachable(firth_compilation_result *result, firth_parse_element *elt, char *reachable);
+
+// marks every top level definition elt may call, directly or not, in reachable, which is
+// indexed by the definitions' order in the program
+void firth_mark_reachable_elt(firth_compilation_result *result, firth_parse_element *elt, char *reachable) {
+    if (elt->type == CALL) {
+        int index = 0;
+        for (firth_parse_element *def = result->root_elements->first; def != NULL; def = def->next_sibling) {
+            if (def->type != DEF) {
+                continue;
+            }
+            if (!reachable[index] && firth_calls_function(elt, def)) {
+                reachable[index] = 1;
+                firth_mark_reachable(result, def->left_children->first, reachable);
+            }
+            index++;
+        }
+    }
     if (elt->left_children) {
-        firth_delete_exprs(elt->left_children);
+        firth_mark_reachable(result, elt->left_children->first, reachable);
     }
     if (elt->right_children) {
-        firth_delete_exprs(elt->right_children);
+        firth_mark_reachable(result, elt->right_children->first, reachable);
+    }
+}
+
+void firth_mark_reachable(firth_compilation_result *result, firth_parse_element *elt, char *reachable) {
+    for (; elt != NULL; elt = elt->next_sibling) {
+        firth_mark_reachable_elt(result, elt, reachable);
+    }
+}
+
+// the definitions reachable from the top level code, as flags for dropping them. a definition
+// with one nested inside it is always kept, as the nested one may be called from anywhere
+char *firth_reachable_functions(firth_compilation_result *result) {
+    int functions = 0;
+    for (firth_parse_element *elt = result->root_elements->first; elt != NULL; elt = elt->next_sibling) {
+        functions += elt->type == DEF;
+    }
+    char *reachable = calloc(functions + 1, sizeof(char));
+    for (firth_parse_element *elt = result->root_elements->first; elt != NULL; elt = elt->next_sibling) {
+        if (elt->type != DEF) {
+            firth_mark_reachable_elt(result, elt, reachable);
+        }
+    }
+    int index = 0;
+    for (firth_parse_element *elt = result->root_elements->first; elt != NULL; elt = elt->next_sibling) {
+        if (elt->type != DEF) {
+            continue;
+        }
+        if (!reachable[index] && firth_contains_type(elt->left_children->first, DEF, NULL)) {
+            reachable[index] = 1;
+            firth_mark_reachable(result, elt->left_children->first, reachable);
+        }
+        index++;
+    }
+    return reachable;
+}
+
+// the slots of the top level code, its HLT and the functions it may call
+int firth_program_size(firth_compilation_result *result) {
+    char *reachable = firth_reachable_functions(result);
+    int size = 1;
+    int index = 0;
+    for (firth_parse_element *elt = result->root_elements->first; elt != NULL; elt = elt->next_sibling) {
+        if (elt->type != DEF || reachable[index++]) {
+            size += firth_code_size_elt(elt);
+        }
+    }
+    free(reachable);
+    return size;
+}
+
+// removes the definitions nothing calls, counting them in the result
+void firth_remove_dead_functions(firth_compilation_result *result) {
+    char *reachable = firth_reachable_functions(result);
+    firth_parse_elements *elements = result->root_elements;
+    firth_parse_element *before = NULL;
+    firth_parse_element *elt = elements->first;
+    int index = 0;
+    while (elt != NULL) {
+        firth_parse_element *next = elt->next_sibling;
+        if (elt->type != DEF || reachable[index++]) {
+            before = elt;
+        } else {
+            if (before) {
+                before->next_sibling = next;
+            } else {
+                elements->first = next;
+            }
+            if (next == NULL) {
+                elements->last = before;
+            }
+            result->removed_functions++;
+            result->removed_slots += firth_code_size_elt(elt);
+        }
+        elt = next;
     }
-    free(elt);
+    free(reachable);
 }
 
-void firth_delete_exprs(firth_parse_elements *elts) {
-    if (elts->first) {
-        firth_parse_element *current = elts->first;
-        while (current != NULL) {
-            firth_parse_element *to_delete = current;
-            current = to_delete->next_sibling;
-            firth_delete_expr(to_delete);
+//======================================================
+// Inlining
+//======================================================
+#define FIRTH_INLINE_MAX_SIZE 8  // bodies up to this many slots are inlined at every call
+
+// copies the elements from elt on into list, followed by the continuations (innermost
+// last) that run after them. inlined code has no RET to return with, so a return
+// instead ends the copy, and the code after a zero? that returns is copied into both
+// branches, where only the branch without the return keeps it
+void firth_inline_copy(firth_compilation_result *result, firth_parse_elements *list, firth_parse_element *elt,
+                       firth_parse_element **continuations, int count) {
+    for (;; elt = elt->next_sibling) {
+        while (elt == NULL && count > 0) {
+            elt = continuations[--count];
+        }
+        if (elt == NULL || firth_elt_is_return(elt)) {
+            return;
+        }
+        firth_parse_element *copy = firth_make_elt(result, elt->token, elt->type);
+        copy->name = elt->name;
+        firth_add_element(list, copy);
+        if (elt->type != ZERO_TEST) {
+            continue;
         }
+        copy->left_children = firth_make_elts(result);
+        copy->right_children = firth_make_elts(result);
+        if (!firth_contains_return(elt->left_children->first) && !firth_contains_return(elt->right_children->first)) {
+            firth_inline_copy(result, copy->left_children, elt->left_children->first, NULL, 0);
+            firth_inline_copy(result, copy->right_children, elt->right_children->first, NULL, 0);
+            continue;
+        }
+        firth_parse_element **inner = lmsm_arena_alloc(result->arena, sizeof(firth_parse_element *) * (count + 1));
+        if (count > 0) {  // there are none to copy outside any zero?
+            memcpy(inner, continuations, sizeof(firth_parse_element *) * count);
+        }
+        inner[count] = elt->next_sibling;
+        firth_inline_copy(result, copy->left_children, elt->left_children->first, inner, count + 1);
+        firth_inline_copy(result, copy->right_children, elt->right_children->first, inner, count + 1);
+        return;
     }
 }
 
+// unlinks a top level definition once every call to it has been inlined
+void firth_remove_definition(firth_parse_elements *elements, firth_parse_element *def) {
+    firth_parse_element *before = NULL;
+    for (firth_parse_element *elt = elements->first; elt != def; elt = elt->next_sibling) {
+        before = elt;
+    }
+    if (before) {
+        before->next_sibling = def->next_sibling;
+    } else {
+        elements->first = def->next_sibling;
+    }
+    if (def->next_sibling == NULL) {
+        elements->last = before;
+    }
+}
+
+// replaces every call to def in the elements with a copy of body, which leaves the
+// accumulator without the function's address a CALL would have loaded into it
+void firth_inline_calls(firth_compilation_result *result, firth_parse_elements *elements, firth_parse_element *def,
+                        firth_parse_elements *body) {
+    firth_parse_element *before = NULL;
+    firth_parse_element *elt = elements->first;
+    while (elt != NULL) {
+        firth_parse_element *next = elt->next_sibling;
+        if (!firth_calls_function(elt, def)) {
+            if (elt->left_children) {
+                firth_inline_calls(result, elt->left_children, def, body);
+            }
+            if (elt->right_children) {
+                firth_inline_calls(result, elt->right_children, def, body);
+            }
+            before = elt;
+            elt = next;
+            continue;
+        }
+        firth_parse_elements copy = {NULL, NULL};
+        firth_inline_copy(result, &copy, body->first, NULL, 0);
+        // a call to an empty function just goes away
+        firth_parse_element *first = copy.first ? copy.first : next;
+        firth_parse_element *last = copy.first ? copy.last : before;
+        if (before) {
+            before->next_sibling = first;
+        } else {
+            elements->first = first;
+        }
+        if (copy.first) {
+            copy.last->next_sibling = next;
+        }
+        if (next == NULL) {
+            elements->last = last;
+        }
+        before = last;
+        elt = next;
+    }
+}
+
+// inlines the functions worth inlining, one at a time, cheapest first. a function small
+// enough, or called just once, is inlined at every call as long as the program still
+// fits in memory without it. recursive functions never are
+void firth_inline_functions(firth_compilation_result *result) {
+    int functions = 0;
+    for (firth_parse_element *elt = result->root_elements->first; elt != NULL; elt = elt->next_sibling) {
+        functions += elt->type == DEF;
+    }
+    firth_parse_element **visited = malloc(sizeof(firth_parse_element *) * (functions + 1));
+    for (;;) {
+        int size = firth_program_size(result);
+        firth_parse_element *best = NULL;
+        firth_parse_elements *best_body = NULL;
+        int best_growth = 0, best_calls = 0;
+        for (firth_parse_element *def = result->root_elements->first; def != NULL; def = def->next_sibling) {
+            if (def->type != DEF || firth_function_named(result, &def->name->span) != def ||
+                firth_contains_type(def->left_children->first, DEF, NULL)) {
+                continue;
+            }
+            int calls = firth_count_calls(result->root_elements->first, def);
+            int visited_count = 0;
+            if (calls == 0 || firth_reaches_function(result, def->left_children->first, def, visited, &visited_count)) {
+                continue;
+            }
+            firth_parse_elements *body = firth_make_elts(result);
+            firth_inline_copy(result, body, def->left_children->first, NULL, 0);
+            int body_size = firth_code_size(body->first);
+            // each CALL is three slots, and the definition goes once nothing calls it
+            int growth = calls * (body_size - 3) - firth_code_size_elt(def);
+            if ((body_size <= FIRTH_INLINE_MAX_SIZE || calls == 1) && (growth <= 0 || size + growth <= 100) &&
+                (best == NULL || growth < best_growth || (growth == best_growth && calls > best_calls))) {
+                best = def;
+                best_body = body;
+                best_growth = growth;
+                best_calls = calls;
+            }
+        }
+        if (best == NULL) {
+            break;
+        }
+        firth_inline_calls(result, result->root_elements, best, best_body);
+        firth_remove_definition(result->root_elements, best);
+        result->inlined_functions++;
+    }
+    free(visited);
+}
+
+void firth_optimize(firth_compilation_result *result) {
+    if (result->error == NULL) {
+        firth_remove_dead_functions(result);
+        firth_inline_functions(result);
+        firth_remove_dead_functions(result);
+        firth_fold_elements(result->root_elements, result);
+    }
+}
+
+//======================================================
+// Entry Point
+//======================================================
+void firth_delete_compilation_result(firth_compilation_result * result){
+    lmsm_arena_delete(result->arena);  // the tokens and the whole parse tree
+    free(result->origins);
+    free(result->lmsm_assembly);
+    if (result->assembled) {
+        asm_delete_compilation_result(result->assembled);
+    }
+    free(result);
+}
+
 firth_compilation_result *firth_compile(char *firth_src) {
+    return firth_compile_with_options(firth_src, FIRTH_EMIT_ASSEMBLY, 0);
+}
+
+firth_compilation_result *firth_compile_with_options(char *firth_src, int options, int asm_options) {
 
     firth_compilation_result *result = calloc(1, sizeof(firth_compilation_result));
+    result->options = options;
+    result->assembly_column = 1;
+    result->arena = lmsm_arena_create();
 
-    void *root_elements = calloc(1, sizeof(firth_parse_elements));
+    firth_parse_elements *root_elements = firth_make_elts(result);
     result->root_elements = root_elements;
 
-    firth_tokens *tokens = firth_tokenize(firth_src);
+    firth_tokens *tokens = firth_tokenize(firth_src, result->arena);
     result->tokens = tokens;
 
     while (firth_has_more_tokens(tokens)) {
         firth_add_element(root_elements, firth_parse_elt(tokens, result));
     }
 
-    firth_code_gen(result);
+    if (options & FIRTH_OPTIMIZE) {
+        firth_optimize(result);
+    }
+
+    firth_emit(result, "");  // so there is always a string, even after a parse error
+    if (options & FIRTH_ASSEMBLE) {
+        asm_builder builder;
+        asm_builder_begin(&builder, asm_options);
+        result->builder = &builder;
+        firth_code_gen(result);
+        result->assembled = asm_builder_finish(&builder);
+        result->builder = NULL;
+    } else {
+        firth_code_gen(result);
+    }
 
     return result;
 }
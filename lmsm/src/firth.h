@@ -1,15 +1,20 @@
 #ifndef LMSM_FIRTH_H
 #define LMSM_FIRTH_H
 
+#include "arena.h"
+#include "assembler.h"
+#include "lexer.h"
+
 typedef struct firth_token {
-    char *value;
+    lmsm_span span;      // points into the source, which must outlive the compilation result
     struct firth_token *next;
 } firth_token;
 
 typedef struct firth_tokens {
     struct firth_token *start;
     struct firth_token *current;
-    char * original_src;
+    struct firth_token *last;
+    const char * original_src;
 } firth_tokens;
 
 typedef enum firth_parse_element_type {
@@ -38,17 +43,55 @@ typedef struct firth_parse_elements {
     struct firth_parse_element *last;
 } firth_parse_elements;
 
+// the element a run of generated assembly lines came from
+typedef struct firth_origin {
+    int assembly_line;             // the first line of the run, 1-based
+    firth_parse_element *element;  // NULL for code the compiler adds itself
+} firth_origin;
+
 typedef struct firth_compilation_result {
+    lmsm_arena *arena;          // the tokens, elements and element lists, freed with the result
     firth_tokens * tokens;
     firth_parse_elements * root_elements;
-    char lmsm_assembly[4000];   // the assembly for this program
+    char * lmsm_assembly;       // the assembly for this program, grown as it is generated
+    int assembly_length;
+    int assembly_capacity;
     char * error;         // any error that occurred (e.g. a missing label)
     int label_num;
+    firth_origin *origins;      // in assembly line order, for debug info
+    int origin_count;
+    int origin_capacity;
+    int options;                // the FIRTH_ options it was compiled with
+    asm_compilation_result *assembled;  // with FIRTH_ASSEMBLE, the code built without going through text
+    asm_builder *builder;       // while generating code with FIRTH_ASSEMBLE
+    int assembly_lines;         // lines of assembly generated so far, whether or not as text
+    int assembly_column;        // where the next label or instruction goes on the current line
+    int removed_functions;      // definitions FIRTH_OPTIMIZE found nothing calls
+    int removed_slots;          // and the code they would have taken
+    int inlined_functions;      // definitions it dropped after inlining them at every call
 } firth_compilation_result;
 
+#define FIRTH_ERROR_OUT_OF_MEMORY "Out of memory generating assembly"
+
+// compilation options
+#define FIRTH_EMIT_ASSEMBLY 1   // generate lmsm_assembly, e.g. for --emit-asm
+#define FIRTH_ASSEMBLE 2        // build the machine code into assembled directly, with label fixups
+#define FIRTH_OPTIMIZE 4        // inline small functions, drop dead ones, fold constants, branch to tail calls
+
+// optimizing keeps a program's output, its stack and any number it leaves in the accumulator.
+// a CALL also loads the callee's address into the accumulator, which isn't kept: a tail call
+// or an inlined body runs without loading it, leaving whatever the code before it loaded
+
 // compiles a Firth program to LMSM assembly
 firth_compilation_result * firth_compile(char *firth_src);
 
+// compiles to assembly text, code or both. asm_options are the ASM_ options for
+// FIRTH_ASSEMBLE, whose errors are reported in assembled rather than in error
+firth_compilation_result * firth_compile_with_options(char *firth_src, int options, int asm_options);
+
 void firth_delete_compilation_result(firth_compilation_result * result);
 
+// the element the code on a line of lmsm_assembly was generated for, or NULL
+firth_parse_element *firth_origin_of_line(firth_compilation_result *result, int assembly_line);
+
 #endif // LMSM_FIRTH_H
\ No newline at end of file
@@ -0,0 +1,822 @@
+//
+// Generates random, well-formed LMSM assembly and Firth programs
+//
+// Programs are built so they always terminate: branches only jump
+// forward, loops are counted down from a small constant, assembly
+// functions only call functions defined after them and recursive
+// Firth functions count down from a small literal.  Every program is
+// assembled and run before it is written out, programs that print
+// nothing are dropped, and Firth programs are also checked against a
+// reference evaluator.
+//
+
+#include "assembler.h"
+#include "firth.h"
+#include "lmsm.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GEN_SOURCE_SIZE 16384
+#define GEN_MAX_FUNCTIONS 6
+#define GEN_MAX_LOOPS 16
+#define GEN_VARIABLES 4
+#define GEN_MAX_STEPS 1000000
+#define GEN_MAX_ATTEMPTS 200
+#define GEN_MAX_FIRTH_ASSEMBLY 3500
+
+//======================================================
+//  Options
+//======================================================
+
+typedef struct gen_options {
+    int firth;               // generate Firth instead of assembly
+    unsigned long long seed;
+    int size;                // rough number of elements per block
+    int arith_weight;        // instruction mix
+    int stack_weight;
+    int io_weight;
+    int branch_density;      // percent chance of a branch or loop at each element
+    int call_depth;          // maximum depth of the static call graph
+    int stack_pressure;      // maximum number of values on the stack
+} gen_options;
+
+//======================================================
+//  Generator State
+//======================================================
+
+typedef struct gen_node {
+    enum { GEN_NUMBER, GEN_OP, GEN_ZERO, GEN_CALL } type;
+    int value;                 // number or function index
+    char *op;
+    struct gen_node *left;     // zero? branches
+    struct gen_node *right;
+    struct gen_node *next;
+} gen_node;
+
+typedef struct gen_function {
+    int in;                  // values consumed
+    int out;                 // values produced
+    int level;               // 1 + the deepest level of any callee
+    int recursive;           // Firth countdown function, called as `k fN()`
+    gen_node *body;
+} gen_function;
+
+typedef struct gen_context {
+    gen_options *options;
+    unsigned long long rng;
+
+    char src[GEN_SOURCE_SIZE];
+    int length;
+    int overflow;
+
+    gen_function functions[GEN_MAX_FUNCTIONS];
+    int function_count;
+    int current_function;    // index of the function being generated, or function_count for main
+
+    // assembly only
+    char pending_label[16];
+    int label_count;
+    int loop_count;
+    int depth_base;          // absolute stack depth at the start of the current block
+} gen_context;
+
+//======================================================
+//  Utilities
+//======================================================
+
+unsigned int gen_random(gen_context *ctx) {
+    // xorshift64*
+    ctx->rng ^= ctx->rng >> 12;
+    ctx->rng ^= ctx->rng << 25;
+    ctx->rng ^= ctx->rng >> 27;
+    return (unsigned int) ((ctx->rng * 2685821657736338717ULL) >> 32);
+}
+
+int gen_range(gen_context *ctx, int low, int high) {
+    return low + (int) (gen_random(ctx) % (unsigned int) (high - low + 1));
+}
+
+int gen_percent(gen_context *ctx, int percent) {
+    return gen_range(ctx, 1, 100) <= percent;
+}
+
+void gen_append(gen_context *ctx, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(ctx->src + ctx->length, GEN_SOURCE_SIZE - ctx->length, format, args);
+    va_end(args);
+    if (written < 0 || ctx->length + written >= GEN_SOURCE_SIZE) {
+        ctx->overflow = 1;
+    } else {
+        ctx->length += written;
+    }
+}
+
+int gen_cap(int value) {
+    if (value > 999) {
+        return 999;
+    } else if (value < -999) {
+        return -999;
+    }
+    return value;
+}
+
+// picks a function the current one may call, or -1
+int gen_pick_callee(gen_context *ctx, int available) {
+    int start = ctx->current_function + 1;
+    int candidates = ctx->function_count - start;
+    if (candidates <= 0) {
+        return -1;
+    }
+    int index = start + gen_range(ctx, 0, candidates - 1);
+    gen_function *callee = &ctx->functions[index];
+    int needed = callee->recursive ? 0 : callee->in;
+    if (needed > available || callee->level >= ctx->options->call_depth) {
+        return -1;
+    }
+    return index;
+}
+
+//======================================================
+//  Firth Generation
+//======================================================
+
+char *GEN_FIRTH_BINARY_OPS[] = {"+", "-", "*", "max", "min"};
+
+gen_node *gen_node_make(int type, int value, char *op) {
+    gen_node *node = calloc(1, sizeof(gen_node));
+    node->type = type;
+    node->value = value;
+    node->op = op;
+    return node;
+}
+
+void gen_node_delete(gen_node *node) {
+    while (node) {
+        gen_node *next = node->next;
+        gen_node_delete(node->left);
+        gen_node_delete(node->right);
+        free(node);
+        node = next;
+    }
+}
+
+typedef struct gen_block {
+    gen_node *first;
+    gen_node *last;
+} gen_block;
+
+void gen_block_add(gen_block *block, gen_node *node) {
+    if (block->last) {
+        block->last->next = node;
+    } else {
+        block->first = node;
+    }
+    block->last = node;
+}
+
+// pops or pushes until the block is at the target depth
+void gen_firth_finish(gen_context *ctx, gen_block *block, int *depth, int available, int target) {
+    while (*depth > target) {
+        if (available + *depth >= 2 && gen_percent(ctx, 50)) {
+            gen_block_add(block, gen_node_make(GEN_OP, 0, GEN_FIRTH_BINARY_OPS[gen_range(ctx, 0, 4)]));
+        } else {
+            gen_block_add(block, gen_node_make(GEN_OP, 0, "pop"));
+        }
+        (*depth)--;
+    }
+    while (*depth < target) {
+        gen_block_add(block, gen_node_make(GEN_NUMBER, gen_range(ctx, 0, 99), NULL));
+        (*depth)++;
+    }
+}
+
+// generates a block that may consume `available` values from the stack and
+// must finish `target` values above where it started.  function_offset is the
+// depth of the block relative to the start of the enclosing function, or -1
+// when outside of any function
+gen_node *gen_firth_block(gen_context *ctx, int available, int target, int length, int nesting, int function_offset) {
+    gen_options *options = ctx->options;
+    gen_block block = {NULL, NULL};
+    int depth = 0;
+    int total_weight = options->arith_weight + options->stack_weight + options->io_weight;
+
+    for (int i = 0; i < length; ++i) {
+        int absolute = ctx->depth_base + depth;
+        int usable = available + depth;
+
+        if (nesting > 0 && usable >= 1 && gen_percent(ctx, options->branch_density)) {
+            // zero? consumes the top of the stack
+            gen_node *zero = gen_node_make(GEN_ZERO, 0, NULL);
+            depth--;
+            int saved_base = ctx->depth_base;
+            ctx->depth_base = absolute - 1;
+            int inner_offset = function_offset < 0 ? -1 : function_offset + depth;
+            if (inner_offset >= 0 && gen_percent(ctx, 25)) {
+                // return early from the function out of the zero branch
+                gen_function *function = &ctx->functions[ctx->current_function];
+                gen_block left = {NULL, NULL};
+                int left_depth = inner_offset;
+                gen_firth_finish(ctx, &left, &left_depth, function->in, function->out - function->in);
+                gen_block_add(&left, gen_node_make(GEN_OP, 0, "return"));
+                zero->left = left.first;
+            } else {
+                zero->left = gen_firth_block(ctx, available + depth, 0, length / 2, nesting - 1, inner_offset);
+            }
+            zero->right = gen_firth_block(ctx, available + depth, 0, length / 2, nesting - 1, inner_offset);
+            ctx->depth_base = saved_base;
+            gen_block_add(&block, zero);
+            continue;
+        }
+
+        int callee = gen_percent(ctx, 20) ? gen_pick_callee(ctx, usable) : -1;
+        if (callee >= 0) {
+            gen_function *function = &ctx->functions[callee];
+            if (function->recursive) {
+                gen_block_add(&block, gen_node_make(GEN_NUMBER, gen_range(ctx, 0, 6), NULL));
+                depth++;
+            }
+            if (ctx->depth_base + depth - function->in + function->out <= options->stack_pressure) {
+                gen_block_add(&block, gen_node_make(GEN_CALL, callee, NULL));
+                depth += function->out - function->in;
+                continue;
+            }
+            if (function->recursive) {
+                gen_block_add(&block, gen_node_make(GEN_OP, 0, "pop"));
+                depth--;
+            }
+        }
+
+        int pick = gen_range(ctx, 1, total_weight);
+        if (pick <= options->arith_weight && usable >= 2) {
+            gen_block_add(&block, gen_node_make(GEN_OP, 0, GEN_FIRTH_BINARY_OPS[gen_range(ctx, 0, 4)]));
+            depth--;
+        } else if (pick <= options->arith_weight && usable >= 1 && absolute < options->stack_pressure) {
+            // division always by a non-zero literal
+            gen_block_add(&block, gen_node_make(GEN_NUMBER, gen_range(ctx, 1, 9), NULL));
+            gen_block_add(&block, gen_node_make(GEN_OP, 0, "/"));
+        } else if (pick > options->arith_weight + options->stack_weight && usable >= 1) {
+            gen_block_add(&block, gen_node_make(GEN_OP, 0, "."));
+        } else if (absolute < options->stack_pressure && (usable == 0 || gen_percent(ctx, 50))) {
+            gen_block_add(&block, gen_node_make(GEN_NUMBER, gen_range(ctx, 0, 99), NULL));
+            depth++;
+        } else if (usable >= 2 && gen_percent(ctx, 50)) {
+            gen_block_add(&block, gen_node_make(GEN_OP, 0, "swap"));
+        } else if (usable >= 1 && absolute < options->stack_pressure && gen_percent(ctx, 50)) {
+            gen_block_add(&block, gen_node_make(GEN_OP, 0, "dup"));
+            depth++;
+        } else if (usable >= 1 && depth > target) {
+            gen_block_add(&block, gen_node_make(GEN_OP, 0, "pop"));
+            depth--;
+        }
+    }
+    gen_firth_finish(ctx, &block, &depth, available, target);
+    return block.first;
+}
+
+void gen_firth_function(gen_context *ctx, int index) {
+    gen_function *function = &ctx->functions[index];
+    ctx->current_function = index;
+    int level = 0;
+    for (int i = index + 1; i < ctx->function_count; ++i) {
+        if (ctx->functions[i].level > level) {
+            level = ctx->functions[i].level;
+        }
+    }
+    function->level = level + 1;
+    function->recursive = gen_percent(ctx, 30);
+    if (function->recursive) {
+        // dup zero? else <body> 1 - fN() end
+        function->in = 1;
+        function->out = 1;
+        ctx->depth_base = 1;
+        gen_node *zero = gen_node_make(GEN_ZERO, 0, NULL);
+        gen_block right = {NULL, NULL};
+        right.first = gen_firth_block(ctx, 0, 0, ctx->options->size / 2, 1, -1);
+        right.last = right.first;
+        while (right.last && right.last->next) {
+            right.last = right.last->next;
+        }
+        gen_block_add(&right, gen_node_make(GEN_NUMBER, 1, NULL));
+        gen_block_add(&right, gen_node_make(GEN_OP, 0, "-"));
+        gen_block_add(&right, gen_node_make(GEN_CALL, index, NULL));
+        zero->right = right.first;
+        function->body = gen_node_make(GEN_OP, 0, "dup");
+        function->body->next = zero;
+    } else {
+        function->in = gen_range(ctx, 0, 2);
+        function->out = gen_range(ctx, 0, 1);
+        ctx->depth_base = function->in;
+        function->body = gen_firth_block(ctx, function->in, function->out - function->in, ctx->options->size, 2, 0);
+    }
+}
+
+void gen_firth_print_block(gen_context *ctx, gen_node *node, int indent) {
+    for (; node != NULL; node = node->next) {
+        gen_append(ctx, "%*s", indent, "");
+        if (node->type == GEN_NUMBER) {
+            gen_append(ctx, "%d\n", node->value);
+        } else if (node->type == GEN_OP) {
+            gen_append(ctx, "%s\n", node->op);
+        } else if (node->type == GEN_CALL) {
+            gen_append(ctx, "f%d()\n", node->value);
+        } else {
+            gen_append(ctx, "zero?\n");
+            gen_firth_print_block(ctx, node->left, indent + 2);
+            if (node->right) {
+                gen_append(ctx, "%*selse\n", indent, "");
+                gen_firth_print_block(ctx, node->right, indent + 2);
+            }
+            gen_append(ctx, "%*send\n", indent, "");
+        }
+    }
+}
+
+// an upper bound on the characters of assembly the Firth compiler emits for a block
+int gen_firth_assembly_size(gen_node *node) {
+    int size = 0;
+    for (; node != NULL; node = node->next) {
+        if (node->type == GEN_ZERO) {
+            size += 64 + gen_firth_assembly_size(node->left) + gen_firth_assembly_size(node->right);
+        } else {
+            size += 16;
+        }
+    }
+    return size;
+}
+
+//======================================================
+//  Firth Reference Evaluator
+//======================================================
+
+typedef struct gen_eval {
+    int stack[TOP_OF_MEMORY + 1];
+    int depth;
+    int calls;
+    char output[OUTPUT_BUFFER_SIZE];
+    int output_length;
+    long steps;
+    int error;
+} gen_eval;
+
+// returns 1 if a return was executed
+int gen_eval_block(gen_context *ctx, gen_eval *eval, gen_node *node) {
+    for (; node != NULL && !eval->error; node = node->next) {
+        if (++eval->steps > GEN_MAX_STEPS || eval->depth + eval->calls > 90) {
+            eval->error = 1;
+            return 0;
+        }
+        if (node->type == GEN_NUMBER) {
+            eval->stack[eval->depth++] = node->value;
+        } else if (node->type == GEN_CALL) {
+            eval->calls++;
+            gen_eval_block(ctx, eval, ctx->functions[node->value].body);
+            eval->calls--;
+        } else if (node->type == GEN_ZERO) {
+            int value = eval->stack[--eval->depth];
+            if (gen_eval_block(ctx, eval, value == 0 ? node->left : node->right)) {
+                return 1;
+            }
+        } else if (strcmp(node->op, "return") == 0) {
+            return 1;
+        } else if (strcmp(node->op, ".") == 0) {
+            if (eval->output_length + 6 > OUTPUT_BUFFER_SIZE) {
+                eval->error = 1;
+                return 0;
+            }
+            eval->output_length += sprintf(eval->output + eval->output_length, "%d ", eval->stack[eval->depth - 1]);
+        } else if (strcmp(node->op, "pop") == 0) {
+            eval->depth--;
+        } else if (strcmp(node->op, "dup") == 0) {
+            eval->stack[eval->depth] = eval->stack[eval->depth - 1];
+            eval->depth++;
+        } else {
+            int top = eval->stack[eval->depth - 1];
+            int second = eval->stack[eval->depth - 2];
+            int *result = &eval->stack[eval->depth - 2];
+            if (strcmp(node->op, "swap") == 0) {
+                eval->stack[eval->depth - 1] = second;
+                *result = top;
+                continue;
+            }
+            eval->depth--;
+            if (strcmp(node->op, "+") == 0) {
+                *result = gen_cap(second + top);
+            } else if (strcmp(node->op, "-") == 0) {
+                *result = gen_cap(second - top);
+            } else if (strcmp(node->op, "*") == 0) {
+                *result = gen_cap(second * top);
+            } else if (strcmp(node->op, "/") == 0) {
+                *result = second / top;
+            } else if (strcmp(node->op, "max") == 0) {
+                *result = top > second ? top : second;
+            } else {
+                *result = top < second ? top : second;
+            }
+        }
+    }
+    return 0;
+}
+
+//======================================================
+//  Assembly Generation
+//======================================================
+
+char *GEN_ASM_STACK_OPS[] = {"SADD", "SSUB", "SMUL", "SMAX", "SMIN"};
+
+void gen_asm_emit(gen_context *ctx, char *instruction, char *argument) {
+    gen_append(ctx, "%-8s %-7s%s%s\n", ctx->pending_label, instruction, argument ? " " : "", argument ? argument : "");
+    ctx->pending_label[0] = '\0';
+}
+
+void gen_asm_set_label(gen_context *ctx, char *label) {
+    if (ctx->pending_label[0]) {
+        // only one label per instruction, so give the older one a harmless home
+        gen_asm_emit(ctx, "SUB", "ZERO");
+    }
+    strcpy(ctx->pending_label, label);
+}
+
+char *gen_asm_variable(gen_context *ctx, char *buffer) {
+    sprintf(buffer, "V%d", gen_range(ctx, 0, GEN_VARIABLES - 1));
+    return buffer;
+}
+
+char *gen_asm_number(gen_context *ctx, int low, int high, char *buffer) {
+    sprintf(buffer, "%d", gen_range(ctx, low, high));
+    return buffer;
+}
+
+void gen_asm_finish(gen_context *ctx, int *depth, int available, int target) {
+    char buffer[16];
+    while (*depth > target) {
+        if (available + *depth >= 2 && gen_percent(ctx, 50)) {
+            gen_asm_emit(ctx, GEN_ASM_STACK_OPS[gen_range(ctx, 0, 4)], NULL);
+        } else {
+            gen_asm_emit(ctx, "SDROP", NULL);
+        }
+        (*depth)--;
+    }
+    while (*depth < target) {
+        gen_asm_emit(ctx, "SPUSHI", gen_asm_number(ctx, 0, 99, buffer));
+        (*depth)++;
+    }
+}
+
+void gen_asm_block(gen_context *ctx, int available, int target, int length, int nesting) {
+    gen_options *options = ctx->options;
+    int depth = 0;
+    int total_weight = options->arith_weight + options->stack_weight + options->io_weight;
+    char buffer[16];
+    char label[16];
+
+    for (int i = 0; i < length; ++i) {
+        int absolute = ctx->depth_base + depth;
+        int usable = available + depth;
+
+        if (nesting > 0 && gen_percent(ctx, options->branch_density)) {
+            int saved_base = ctx->depth_base;
+            ctx->depth_base = absolute;
+            if (ctx->loop_count < GEN_MAX_LOOPS && gen_percent(ctx, 50)) {
+                // counted loop
+                int loop = ctx->loop_count++;
+                char counter[16];
+                sprintf(counter, "C%d", loop);
+                sprintf(label, "LOOP%d", loop);
+                gen_asm_emit(ctx, "LDI", gen_asm_number(ctx, 0, 4, buffer));
+                gen_asm_emit(ctx, "STA", counter);
+                gen_asm_set_label(ctx, label);
+                gen_asm_block(ctx, usable, 0, length / 2, nesting - 1);
+                gen_asm_emit(ctx, "LDA", counter);
+                gen_asm_emit(ctx, "SUB", "ONE");
+                gen_asm_emit(ctx, "STA", counter);
+                gen_asm_emit(ctx, "BRP", label);
+            } else {
+                // forward branch over a stack neutral block
+                char *branches[] = {"BRA", "BRZ", "BRP"};
+                sprintf(label, "SKIP%d", ctx->label_count++);
+                gen_asm_emit(ctx, branches[gen_range(ctx, 0, 2)], label);
+                gen_asm_block(ctx, usable, 0, length / 2, nesting - 1);
+                gen_asm_set_label(ctx, label);
+            }
+            ctx->depth_base = saved_base;
+            continue;
+        }
+
+        int callee = gen_percent(ctx, 15) ? gen_pick_callee(ctx, usable) : -1;
+        if (callee >= 0) {
+            gen_function *function = &ctx->functions[callee];
+            if (absolute - function->in + function->out <= options->stack_pressure) {
+                sprintf(label, "F%d", callee);
+                gen_asm_emit(ctx, "CALL", label);
+                depth += function->out - function->in;
+                continue;
+            }
+        }
+
+        int pick = gen_range(ctx, 1, total_weight);
+        if (pick <= options->arith_weight) {
+            int choice = gen_range(ctx, 0, 5);
+            if (choice == 0 && usable >= 2) {
+                gen_asm_emit(ctx, GEN_ASM_STACK_OPS[gen_range(ctx, 0, 4)], NULL);
+                depth--;
+            } else if (choice == 1 && usable >= 1 && absolute < options->stack_pressure) {
+                // division always by a non-zero literal
+                gen_asm_emit(ctx, "SPUSHI", gen_asm_number(ctx, 1, 9, buffer));
+                gen_asm_emit(ctx, "SDIV", NULL);
+            } else if (choice == 2) {
+                gen_asm_emit(ctx, "SUB", gen_asm_variable(ctx, buffer));
+            } else if (choice == 3) {
+                gen_asm_emit(ctx, "LDI", gen_asm_number(ctx, 0, 99, buffer));
+            } else {
+                gen_asm_emit(ctx, "ADD", gen_asm_variable(ctx, buffer));
+            }
+        } else if (pick <= options->arith_weight + options->stack_weight) {
+            int choice = gen_range(ctx, 0, 5);
+            if (choice == 0 && usable >= 1) {
+                gen_asm_emit(ctx, "SPOP", NULL);
+                depth--;
+            } else if (choice == 1 && usable >= 1 && absolute < options->stack_pressure) {
+                gen_asm_emit(ctx, "SDUP", NULL);
+                depth++;
+            } else if (choice == 2 && usable >= 2) {
+                gen_asm_emit(ctx, "SSWAP", NULL);
+            } else if (choice == 3 && usable >= 1 && depth > target) {
+                gen_asm_emit(ctx, "SDROP", NULL);
+                depth--;
+            } else if (choice == 4 && absolute < options->stack_pressure) {
+                gen_asm_emit(ctx, "SPUSH", NULL);
+                depth++;
+            } else if (absolute < options->stack_pressure) {
+                gen_asm_emit(ctx, "SPUSHI", gen_asm_number(ctx, 0, 99, buffer));
+                depth++;
+            }
+        } else {
+            if (gen_percent(ctx, 30)) {
+                gen_asm_emit(ctx, gen_percent(ctx, 50) ? "LDA" : "STA", gen_asm_variable(ctx, buffer));
+            } else {
+                gen_asm_emit(ctx, "OUT", NULL);
+            }
+        }
+    }
+    gen_asm_finish(ctx, &depth, available, target);
+}
+
+void gen_asm_program(gen_context *ctx) {
+    char label[16];
+    for (int i = ctx->function_count - 1; i >= 0; --i) {
+        gen_function *function = &ctx->functions[i];
+        int level = 0;
+        for (int j = i + 1; j < ctx->function_count; ++j) {
+            if (ctx->functions[j].level > level) {
+                level = ctx->functions[j].level;
+            }
+        }
+        function->level = level + 1;
+        function->in = gen_range(ctx, 0, 2);
+        function->out = gen_range(ctx, 0, 1);
+    }
+
+    ctx->current_function = -1;
+    ctx->depth_base = 0;
+    gen_asm_block(ctx, 0, 0, ctx->options->size, 2);
+    gen_asm_emit(ctx, "HLT", NULL);
+
+    for (int i = 0; i < ctx->function_count; ++i) {
+        gen_function *function = &ctx->functions[i];
+        ctx->current_function = i;
+        ctx->depth_base = function->in;
+        sprintf(label, "F%d", i);
+        gen_asm_set_label(ctx, label);
+        gen_asm_block(ctx, function->in, function->out - function->in, ctx->options->size / 2, 1);
+        gen_asm_emit(ctx, "RET", NULL);
+    }
+
+    strcpy(ctx->pending_label, "ONE");
+    gen_asm_emit(ctx, "DAT", "1");
+    strcpy(ctx->pending_label, "ZERO");
+    gen_asm_emit(ctx, "DAT", "0");
+    for (int i = 0; i < ctx->loop_count; ++i) {
+        sprintf(ctx->pending_label, "C%d", i);
+        gen_asm_emit(ctx, "DAT", "0");
+    }
+    for (int i = 0; i < GEN_VARIABLES; ++i) {
+        char value[16];
+        sprintf(ctx->pending_label, "V%d", i);
+        gen_asm_emit(ctx, "DAT", gen_asm_number(ctx, 0, 50, value));
+    }
+}
+
+//======================================================
+//  Program Generation
+//======================================================
+
+void gen_reset(gen_context *ctx) {
+    for (int i = 0; i < ctx->function_count; ++i) {
+        gen_node_delete(ctx->functions[i].body);
+    }
+    memset(ctx->functions, 0, sizeof(ctx->functions));
+    ctx->length = 0;
+    ctx->src[0] = '\0';
+    ctx->overflow = 0;
+    ctx->pending_label[0] = '\0';
+    ctx->label_count = 0;
+    ctx->loop_count = 0;
+    ctx->depth_base = 0;
+    ctx->function_count = gen_range(ctx, 0, ctx->options->call_depth > 0 ? GEN_MAX_FUNCTIONS / 2 : 0);
+}
+
+void gen_firth_program(gen_context *ctx, gen_eval *eval) {
+    for (int i = ctx->function_count - 1; i >= 0; --i) {
+        gen_firth_function(ctx, i);
+    }
+    ctx->current_function = -1;
+    ctx->depth_base = 0;
+    gen_node *main = gen_firth_block(ctx, 0, 0, ctx->options->size, 2, -1);
+
+    // the compiler writes into a fixed size buffer, so leave plenty of headroom
+    int assembly_size = gen_firth_assembly_size(main) + 8;
+    for (int i = 0; i < ctx->function_count; ++i) {
+        assembly_size += gen_firth_assembly_size(ctx->functions[i].body) + 16;
+    }
+    if (assembly_size > GEN_MAX_FIRTH_ASSEMBLY) {
+        ctx->overflow = 1;
+    }
+
+    gen_firth_print_block(ctx, main, 0);
+    for (int i = 0; i < ctx->function_count; ++i) {
+        gen_append(ctx, "\ndef f%d()\n", i);
+        gen_firth_print_block(ctx, ctx->functions[i].body, 2);
+        gen_append(ctx, "end\n");
+    }
+
+    memset(eval, 0, sizeof(gen_eval));
+    gen_eval_block(ctx, eval, main);
+    gen_node_delete(main);
+}
+
+// assembles and runs the current program, filling in its output. returns 0 if it should be rejected
+int gen_check(gen_context *ctx, char *output) {
+    char *assembly = ctx->src;
+    firth_compilation_result *firth_result = NULL;
+    if (ctx->options->firth) {
+        firth_result = firth_compile(ctx->src);
+        if (firth_result->error) {
+            firth_delete_compilation_result(firth_result);
+            return 0;
+        }
+        assembly = firth_result->lmsm_assembly;
+    }
+
+    asm_compilation_result *result = asm_assemble(assembly);
+    int ok = result->error == NULL;  // includes programs over 100 slots
+    if (ok) {
+        lmsm *the_machine = lmsm_create();
+        lmsm_load(the_machine, result->code, 100);
+        the_machine->status = STATUS_RUNNING;
+        long steps = 0;
+        while (the_machine->status != STATUS_HALTED && steps < GEN_MAX_STEPS) {
+            lmsm_step(the_machine);
+            steps++;
+        }
+        ok = the_machine->status == STATUS_HALTED && the_machine->error_code == ERROR_NONE;
+        strcpy(output, the_machine->output_buffer);
+        lmsm_delete(the_machine);
+    }
+
+    asm_delete_compilation_result(result);
+    if (firth_result) {
+        firth_delete_compilation_result(firth_result);
+    }
+    return ok;
+}
+
+// generates one valid program into ctx->src and its output, returns 0 if none could be found
+int gen_program(gen_context *ctx, char *output) {
+    static gen_eval eval;
+    for (int attempt = 0; attempt < GEN_MAX_ATTEMPTS; ++attempt) {
+        gen_reset(ctx);
+        if (ctx->options->firth) {
+            gen_firth_program(ctx, &eval);
+            if (eval.error || ctx->overflow) {
+                continue;
+            }
+        } else {
+            gen_asm_program(ctx);
+        }
+        if (ctx->overflow || !gen_check(ctx, output)) {
+            continue;
+        }
+        if (output[0] == '\0') {
+            continue;  // a silent program's .expected file checks nothing
+        }
+        if (ctx->options->firth && strcmp(eval.output, output) != 0) {
+            fprintf(stderr, "Firth output mismatch, expected '%s' but machine printed '%s':\n%s\n",
+                    eval.output, output, ctx->src);
+            continue;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+//======================================================
+//  Main
+//======================================================
+
+void gen_usage() {
+    printf("Usage: lmsm_gen [--lang asm|firth] [--seed N] [--count N] [--out DIR] [--prefix NAME]\n"
+           "               [--size N] [--arith N] [--stack N] [--io N] [--branches PERCENT]\n"
+           "               [--call-depth N] [--stack-pressure N]\n");
+}
+
+int gen_write_file(char *filename, char *contents) {
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        return 0;
+    }
+    fputs(contents, file);
+    fclose(file);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    gen_options options = {0, 1, 8, 3, 3, 2, 15, 3, 12};
+    int count = 1;
+    char *out_dir = NULL;
+    char *prefix = NULL;
+    for (int i = 1; i < argc; ++i) {
+        char *arg = argv[i];
+        char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL) {
+            gen_usage();
+            return EXIT_FAILURE;
+        }
+        i++;
+        if (strcmp(arg, "--lang") == 0) {
+            options.firth = strcmp(value, "firth") == 0;
+        } else if (strcmp(arg, "--seed") == 0) {
+            options.seed = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--count") == 0) {
+            count = atoi(value);
+        } else if (strcmp(arg, "--out") == 0) {
+            out_dir = value;
+        } else if (strcmp(arg, "--prefix") == 0) {
+            prefix = value;
+        } else if (strcmp(arg, "--size") == 0) {
+            options.size = atoi(value);
+        } else if (strcmp(arg, "--arith") == 0) {
+            options.arith_weight = atoi(value);
+        } else if (strcmp(arg, "--stack") == 0) {
+            options.stack_weight = atoi(value);
+        } else if (strcmp(arg, "--io") == 0) {
+            options.io_weight = atoi(value);
+        } else if (strcmp(arg, "--branches") == 0) {
+            options.branch_density = atoi(value);
+        } else if (strcmp(arg, "--call-depth") == 0) {
+            options.call_depth = atoi(value);
+        } else if (strcmp(arg, "--stack-pressure") == 0) {
+            options.stack_pressure = atoi(value);
+        } else {
+            gen_usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.arith_weight + options.stack_weight + options.io_weight <= 0 || options.stack_pressure > 60) {
+        printf("The instruction mix must have a positive weight and stack pressure must be at most 60\n");
+        return EXIT_FAILURE;
+    }
+    if (prefix == NULL) {
+        prefix = options.firth ? "gen_firth" : "gen_asm";
+    }
+
+    gen_context *ctx = calloc(1, sizeof(gen_context));
+    ctx->options = &options;
+    ctx->rng = options.seed * 0x9E3779B97F4A7C15ULL + 1;
+
+    char output[OUTPUT_BUFFER_SIZE];
+    char filename[1024];
+    for (int i = 0; i < count; ++i) {
+        if (!gen_program(ctx, output)) {
+            fprintf(stderr, "Unable to generate a program that fits, try a smaller --size\n");
+            return EXIT_FAILURE;
+        }
+        if (out_dir == NULL) {
+            printf("%s\n", ctx->src);
+            continue;
+        }
+        snprintf(filename, sizeof(filename), "%s/%s_%03d.%s", out_dir, prefix, i, options.firth ? "firth" : "asm");
+        if (!gen_write_file(filename, ctx->src)) {
+            fprintf(stderr, "Unable to write '%s'\n", filename);
+            return EXIT_FAILURE;
+        }
+        strcat(filename, ".expected");
+        gen_write_file(filename, output);
+    }
+    gen_reset(ctx);
+    free(ctx);
+    return EXIT_SUCCESS;
+}
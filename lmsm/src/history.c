@@ -0,0 +1,212 @@
+//
+// Execution history for the LMSM, used for reverse stepping
+//
+
+#include "history.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//======================================================
+//  Utilities
+//======================================================
+
+// copies the architectural state only, leaving breakpoints and history alone
+void lmsm_history_copy_state(lmsm *dest, const lmsm *src) {
+    dest->program_counter = src->program_counter;
+    dest->current_instruction = src->current_instruction;
+    dest->status = src->status;
+    dest->error_code = src->error_code;
+    dest->accumulator = src->accumulator;
+    dest->stack_pointer = src->stack_pointer;
+    dest->return_address_pointer = src->return_address_pointer;
+    memcpy(dest->memory, src->memory, sizeof(dest->memory));
+    memcpy(dest->output_buffer, src->output_buffer, sizeof(dest->output_buffer));
+}
+
+void lmsm_history_push_checkpoint(lmsm_history *history, lmsm *our_little_machine) {
+    if (history->checkpoint_count == history->checkpoint_capacity) {
+        history->checkpoint_capacity = history->checkpoint_capacity ? history->checkpoint_capacity * 2 : 16;
+        history->checkpoints = realloc(history->checkpoints, sizeof(lmsm) * history->checkpoint_capacity);
+    }
+    lmsm_history_copy_state(&history->checkpoints[history->checkpoint_count], our_little_machine);
+    history->checkpoint_count++;
+}
+
+void lmsm_history_apply_undo(lmsm *our_little_machine, const lmsm_undo_record *record) {
+    for (int i = record->write_count - 1; i >= 0; --i) {
+        our_little_machine->memory[record->addresses[i]] = record->values[i];
+    }
+    if (record->output_length >= 0) {
+        our_little_machine->output_buffer[record->output_length] = '\0';
+    }
+    our_little_machine->program_counter = record->program_counter;
+    our_little_machine->current_instruction = record->current_instruction;
+    our_little_machine->accumulator = record->accumulator;
+    our_little_machine->stack_pointer = record->stack_pointer;
+    our_little_machine->return_address_pointer = record->return_address_pointer;
+    our_little_machine->status = record->status;
+    our_little_machine->error_code = record->error_code;
+}
+
+// drops everything recorded after the current step, since we are about to diverge from it
+void lmsm_history_truncate(lmsm_history *history) {
+    history->length = history->step;
+    history->checkpoint_count = history->step / history->checkpoint_interval + 1;
+    history->has_tip = 0;
+}
+
+//======================================================
+//  Recording
+//======================================================
+
+void lmsm_history_enable(lmsm *our_little_machine, int checkpoint_interval) {
+    if (our_little_machine->history == NULL) {
+        our_little_machine->history = calloc(1, sizeof(lmsm_history));
+    }
+    our_little_machine->history->checkpoint_interval = checkpoint_interval > 0 ? checkpoint_interval : HISTORY_DEFAULT_CHECKPOINT_INTERVAL;
+    lmsm_history_rebase(our_little_machine);
+}
+
+void lmsm_history_disable(lmsm *our_little_machine) {
+    lmsm_history *history = our_little_machine->history;
+    if (history == NULL) {
+        return;
+    }
+    free(history->undo);
+    free(history->checkpoints);
+    free(history);
+    our_little_machine->history = NULL;
+}
+
+void lmsm_history_rebase(lmsm *our_little_machine) {
+    lmsm_history *history = our_little_machine->history;
+    if (history == NULL) {
+        return;
+    }
+    history->step = 0;
+    history->length = 0;
+    history->checkpoint_count = 0;
+    history->has_tip = 0;
+    lmsm_history_push_checkpoint(history, our_little_machine);
+}
+
+void lmsm_history_record(lmsm *our_little_machine, int instruction) {
+    lmsm_history *history = our_little_machine->history;
+    if (history->step < history->length) {
+        lmsm_history_truncate(history);
+    }
+    if (history->length >= HISTORY_MAX_STEPS) {
+        // keep memory bounded on very long runs by starting over from here
+        lmsm_history_rebase(our_little_machine);
+    }
+    if (history->length == history->undo_capacity) {
+        history->undo_capacity = history->undo_capacity ? history->undo_capacity * 2 : 1024;
+        history->undo = realloc(history->undo, sizeof(lmsm_undo_record) * history->undo_capacity);
+    }
+
+    lmsm_undo_record *record = &history->undo[history->length];
+    record->program_counter = (short) our_little_machine->program_counter;
+    record->current_instruction = (short) our_little_machine->current_instruction;
+    record->accumulator = our_little_machine->accumulator;
+    record->stack_pointer = (short) our_little_machine->stack_pointer;
+    record->return_address_pointer = (short) our_little_machine->return_address_pointer;
+    record->status = (unsigned char) our_little_machine->status;
+    record->error_code = (unsigned char) our_little_machine->error_code;
+    record->output_length = instruction == 902 ? (short) strlen(our_little_machine->output_buffer) : -1;
+
+    int addresses[2];
+    int writes = lmsm_instruction_writes(our_little_machine, instruction, addresses);
+    record->write_count = (unsigned char) writes;
+    for (int i = 0; i < writes; ++i) {
+        record->addresses[i] = (short) addresses[i];
+        record->values[i] = our_little_machine->memory[addresses[i]];
+    }
+}
+
+void lmsm_history_commit(lmsm *our_little_machine) {
+    lmsm_history *history = our_little_machine->history;
+    history->step++;
+    history->length = history->step;
+    history->has_tip = 0;
+    if (history->step % history->checkpoint_interval == 0) {
+        lmsm_history_push_checkpoint(history, our_little_machine);
+    }
+}
+
+//======================================================
+//  Reverse Execution
+//======================================================
+
+int lmsm_history_reverse_step(lmsm *our_little_machine) {
+    lmsm_history *history = our_little_machine->history;
+    if (history == NULL || history->step == 0) {
+        return 0;
+    }
+    if (history->step == history->length && !history->has_tip) {
+        lmsm_history_copy_state(&history->tip, our_little_machine);
+        history->has_tip = 1;
+    }
+    history->step--;
+    lmsm_history_apply_undo(our_little_machine, &history->undo[history->step]);
+    return 1;
+}
+
+int lmsm_history_undo_hits_watchpoint(lmsm *our_little_machine, const lmsm_undo_record *record) {
+    for (int i = 0; i < record->write_count; ++i) {
+        if (lmsm_has_watchpoint(our_little_machine, record->addresses[i])) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int lmsm_history_reverse_continue(lmsm *our_little_machine) {
+    lmsm_history *history = our_little_machine->history;
+    if (history == NULL) {
+        return 0;
+    }
+    while (history->step > 0) {
+        int watched = lmsm_history_undo_hits_watchpoint(our_little_machine, &history->undo[history->step - 1]);
+        lmsm_history_reverse_step(our_little_machine);
+        if (watched || lmsm_has_breakpoint(our_little_machine, our_little_machine->program_counter)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int lmsm_history_seek(lmsm *our_little_machine, long step) {
+    lmsm_history *history = our_little_machine->history;
+    if (history == NULL || step < 0 || step > history->length) {
+        return 0;
+    }
+    if (step == history->step) {
+        return 1;
+    }
+    if (history->step == history->length && !history->has_tip) {
+        lmsm_history_copy_state(&history->tip, our_little_machine);
+        history->has_tip = 1;
+    }
+
+    // find the nearest saved state at or after the target, then undo back to it
+    long interval = history->checkpoint_interval;
+    long base = ((step + interval - 1) / interval) * interval;
+    if (base >= history->length) {
+        base = history->length;
+    }
+    if (history->step >= step && history->step <= base) {
+        base = history->step;  // already closer than any checkpoint
+    } else if (base == history->length) {
+        lmsm_history_copy_state(our_little_machine, &history->tip);
+    } else {
+        lmsm_history_copy_state(our_little_machine, &history->checkpoints[base / interval]);
+    }
+
+    while (base > step) {
+        base--;
+        lmsm_history_apply_undo(our_little_machine, &history->undo[base]);
+    }
+    history->step = step;
+    return 1;
+}
@@ -0,0 +1,76 @@
+//
+// Execution history for the LMSM, used for reverse stepping
+//
+
+#ifndef LMSM_HISTORY_H
+#define LMSM_HISTORY_H
+
+#include "lmsm.h"
+
+#define HISTORY_DEFAULT_CHECKPOINT_INTERVAL 64
+#define HISTORY_MAX_STEPS 1000000
+
+//===================================================================
+//  Everything needed to undo a single step of the machine
+//===================================================================
+typedef struct lmsm_undo_record {
+    int accumulator;
+    short program_counter;
+    short current_instruction;
+    short stack_pointer;
+    short return_address_pointer;
+    short output_length;         // length of the output buffer before the step, -1 if untouched
+    unsigned char status;
+    unsigned char error_code;
+    unsigned char write_count;   // number of memory cells written by the step
+    short addresses[2];          // the cells written by the step
+    int values[2];               // the values of those cells before the step
+} lmsm_undo_record;
+
+//===================================================================
+//  Full-state checkpoints every checkpoint_interval steps, plus an
+//  undo record for every step in between
+//===================================================================
+typedef struct lmsm_history {
+    int checkpoint_interval;     // steps between full checkpoints
+    long step;                   // the step the machine is currently at
+    long length;                 // the number of steps recorded
+
+    lmsm_undo_record *undo;      // undo[i] takes step i + 1 back to step i
+    long undo_capacity;
+
+    lmsm *checkpoints;           // checkpoints[i] is the state at step i * checkpoint_interval
+    long checkpoint_count;
+    long checkpoint_capacity;
+
+    lmsm tip;                    // the state at the last recorded step, saved when we first step back
+    int has_tip;
+} lmsm_history;
+
+//===================================================================
+//  API
+//===================================================================
+
+// starts recording history on the machine, checkpointing every interval steps
+void lmsm_history_enable(lmsm *our_little_machine, int checkpoint_interval);
+
+// stops recording history and frees it
+void lmsm_history_disable(lmsm *our_little_machine);
+
+// forgets all recorded history, making the current state step 0
+void lmsm_history_rebase(lmsm *our_little_machine);
+
+// called by lmsm_step around executing an instruction
+void lmsm_history_record(lmsm *our_little_machine, int instruction);
+void lmsm_history_commit(lmsm *our_little_machine);
+
+// undoes one step, returns 0 if there is nothing to undo
+int lmsm_history_reverse_step(lmsm *our_little_machine);
+
+// undoes steps until a breakpoint or watchpoint is hit (returns 1) or step 0 is reached (returns 0)
+int lmsm_history_reverse_continue(lmsm *our_little_machine);
+
+// moves the machine to any recorded step in O(checkpoint interval), returns 0 if out of range
+int lmsm_history_seek(lmsm *our_little_machine, long step);
+
+#endif //LMSM_HISTORY_H
@@ -0,0 +1,175 @@
+//
+// Linker: assembles modules into relocatable objects, through a cache
+// when one is given, and links them into a binary image
+//
+
+#include "engines.h"
+#include "firth.h"
+#include "linker.h"
+#include "source.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LD_MAX_MODULES 1024
+
+//======================================================
+//  Loading
+//======================================================
+
+// an object for a .asm, .firth or .lobj file, or NULL after printing why not
+lmsm_object *ld_load_module(char *filename, char *cache_dir, int *cached) {
+    char message[LMSM_LINK_MESSAGE_SIZE];
+    *cached = 0;
+    if (lmsm_engine_has_extension(filename, ".lobj")) {
+        lmsm_object *object = lmsm_object_read(filename, filename);
+        if (object == NULL) {
+            fprintf(stderr, "%s: not an object file\n", filename);
+        }
+        return object;
+    }
+    lmsm_source source;
+    if (!lmsm_source_open(&source, filename)) {
+        fprintf(stderr, "%s: unable to read\n", filename);
+        return NULL;
+    }
+    char *src = source.text;
+    firth_compilation_result *firth_result = NULL;
+    char *assembly = src;
+    if (lmsm_engine_has_extension(filename, ".firth")) {
+        firth_result = firth_compile(src);
+        assembly = firth_result->error ? NULL : firth_result->lmsm_assembly;
+        snprintf(message, sizeof(message), "%s: %s", filename, firth_result->error);
+    }
+    lmsm_object *object = NULL;
+    if (assembly && cache_dir) {
+        object = lmsm_object_load_cached(cache_dir, filename, assembly, cached, message, sizeof(message));
+    } else if (assembly) {
+        object = lmsm_object_assemble(filename, assembly, message, sizeof(message));
+    }
+    if (object == NULL) {
+        fprintf(stderr, "%s\n", message);
+    }
+    if (firth_result) {
+        firth_delete_compilation_result(firth_result);
+    }
+    lmsm_source_close(&source);
+    return object;
+}
+
+//======================================================
+//  Main
+//======================================================
+
+void ld_usage() {
+    printf("Usage: lmsm_ld [-o image] [--cache dir] [--map] <entry module> [library module or directory]...\n"
+           "              [--overlay <module or directory>]...\n");
+    printf("  modules are .asm, .firth or .lobj files; libraries are only linked in if they are used\n");
+    printf("  overlays are swapped into memory when called, and are written to <image>.ovl\n");
+}
+
+int main(int argc, char *argv[]) {
+    static char *files[LD_MAX_MODULES];
+    static lmsm_object *objects[LD_MAX_MODULES];
+    static char overlay[LD_MAX_MODULES];
+    int count = 0;
+    char *output = NULL;
+    char *cache_dir = NULL;
+    int map = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "--map") == 0) {
+            map = 1;
+        } else if (strcmp(argv[i], "--overlay") == 0 && i + 1 < argc) {
+            int first = count;
+            count = lmsm_engine_collect_programs(argv[++i], files, count, LD_MAX_MODULES);
+            memset(overlay + first, 1, count - first);
+        } else if (argv[i][0] == '-') {
+            ld_usage();
+            return EXIT_FAILURE;
+        } else {
+            count = lmsm_engine_collect_programs(argv[i], files, count, LD_MAX_MODULES);
+        }
+    }
+    if (count == 0) {
+        ld_usage();
+        return EXIT_FAILURE;
+    }
+
+    int ok = 1, cached = 0, modules = 0;
+    for (int i = 0; i < count; ++i) {
+        int from_cache;
+        objects[modules] = ld_load_module(files[i], cache_dir, &from_cache);
+        if (objects[modules] == NULL) {
+            ok = 0;
+            continue;
+        }
+        cached += from_cache;
+        objects[modules]->overlay = overlay[i];
+        modules++;
+    }
+
+    int code[100];
+    char message[LMSM_LINK_MESSAGE_SIZE];
+    lmsm_overlays *overlays = lmsm_overlays_create();
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (ok && !lmsm_ld_link_overlays(objects, modules, code, overlays, message, sizeof(message))) {
+        fprintf(stderr, "%s\n", message);
+        ok = 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (ok) {
+        char image[1024], overlay_file[1100];
+        snprintf(image, sizeof(image), "%s.bin", objects[0]->name);
+        snprintf(overlay_file, sizeof(overlay_file), "%s.ovl", output ? output : image);
+        if (!lmsm_engine_write_image(output ? output : image, code)) {
+            fprintf(stderr, "unable to write '%s'\n", output ? output : image);
+            ok = 0;
+        } else if (overlays->count > 0 && !lmsm_overlays_write(overlays, overlay_file)) {
+            fprintf(stderr, "unable to write '%s'\n", overlay_file);
+            ok = 0;
+        }
+    }
+    if (ok) {
+        int linked = 0, words = 0;
+        for (int i = 0; i < modules; ++i) {
+            if (objects[i]->base == -1) {
+                continue;
+            }
+            linked++;
+            words += objects[i]->size;
+            if (map && objects[i]->overlay) {
+                printf("%03d-%03d %s (overlay %d)\n", objects[i]->base, objects[i]->base + objects[i]->size - 1,
+                       objects[i]->name, objects[i]->segment);
+            } else if (map) {
+                printf("%03d-%03d %s\n", objects[i]->base, objects[i]->base + objects[i]->size - 1, objects[i]->name);
+                for (int j = 0; j < objects[i]->export_count; ++j) {
+                    printf("    %03d %s\n", objects[i]->base + objects[i]->exports[j].offset,
+                           objects[i]->exports[j].name);
+                }
+            }
+        }
+        double micros = (double) (end.tv_sec - start.tv_sec) * 1e6 + (double) (end.tv_nsec - start.tv_nsec) / 1e3;
+        printf("linked %d of %d modules (%d from cache) into %d words in %.1f us\n",
+               linked, modules, cached, words, micros);
+        if (overlays->count > 0) {
+            printf("%d overlays share a %d word window at %03d\n", overlays->count, overlays->window_size,
+                   overlays->window);
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        free(files[i]);
+    }
+    for (int i = 0; i < modules; ++i) {
+        lmsm_object_delete(objects[i]);
+    }
+    lmsm_overlays_delete(overlays);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,88 @@
+//
+// Zero-copy lexer shared by the assembler and the Firth compiler
+//
+
+#include "lexer.h"
+
+#include <string.h>
+
+int lmsm_lexer_is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+void lmsm_lexer_init(lmsm_lexer *lexer, const char *src) {
+    lexer->current = src;
+    lexer->line_start = src;
+    lexer->line = 1;
+}
+
+void lmsm_lexer_skip_line(lmsm_lexer *lexer) {
+    while (*lexer->current != '\0' && *lexer->current != '\n') {
+        lexer->current++;
+    }
+}
+
+int lmsm_lexer_next(lmsm_lexer *lexer, lmsm_span *span) {
+    for (;;) {
+        char c = *lexer->current;
+        if (c == '\0') {
+            return 0;
+        } else if (c == '\n') {
+            lexer->current++;
+            lexer->line++;
+            lexer->line_start = lexer->current;
+        } else if (lmsm_lexer_is_space(c)) {
+            lexer->current++;
+        } else if (c == ';' || (c == '-' && lexer->current[1] == '-')) {
+            lmsm_lexer_skip_line(lexer);
+        } else {
+            break;
+        }
+    }
+    span->start = lexer->current;
+    span->line = lexer->line;
+    span->column = (int) (lexer->current - lexer->line_start) + 1;
+    while (*lexer->current != '\0' && !lmsm_lexer_is_space(*lexer->current) && *lexer->current != ';') {
+        lexer->current++;
+    }
+    span->length = (int) (lexer->current - span->start);
+    return 1;
+}
+
+int lmsm_span_equals(const lmsm_span *span, const char *str) {
+    return strncmp(span->start, str, span->length) == 0 && str[span->length] == '\0';
+}
+
+int lmsm_span_ends_with(const lmsm_span *span, const char *suffix) {
+    int length = (int) strlen(suffix);
+    return span->length >= length && strncmp(span->start + span->length - length, suffix, length) == 0;
+}
+
+int lmsm_span_is_number(const lmsm_span *span) {
+    int i = 0;
+    if (span->length > 0 && span->start[0] == '-') { // allow a leading negative
+        i++;
+    }
+    if (i == span->length) {
+        return 0;
+    }
+    for (; i < span->length; ++i) {
+        if (span->start[i] < '0' || '9' < span->start[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int lmsm_span_to_int(const lmsm_span *span, int limit) {
+    int negative = span->start[0] == '-';
+    int value = 0;
+    for (int i = negative; i < span->length; ++i) {
+        value = value * 10 + (span->start[i] - '0');
+        if (value > limit) {
+            value = limit + 1;
+            break;
+        }
+    }
+    return negative ? -value : value;
+}
@@ -0,0 +1,46 @@
+//
+// Zero-copy lexer shared by the assembler and the Firth compiler
+//
+
+#ifndef LMSM_LEXER_H
+#define LMSM_LEXER_H
+
+//===================================================================
+//  A token: a slice of the source, which is never copied or modified
+//===================================================================
+typedef struct lmsm_span {
+    const char *start;
+    int length;
+    int line;            // 1-based
+    int column;          // 1-based
+} lmsm_span;
+
+//===================================================================
+//  Splits source on whitespace, skipping `;` and `--` comments that
+//  run to the end of the line
+//===================================================================
+typedef struct lmsm_lexer {
+    const char *current;
+    const char *line_start;
+    int line;
+} lmsm_lexer;
+
+//===================================================================
+//  API
+//===================================================================
+
+void lmsm_lexer_init(lmsm_lexer *lexer, const char *src);
+
+// reads the next token into span, returns 0 at the end of the source
+int lmsm_lexer_next(lmsm_lexer *lexer, lmsm_span *span);
+
+int lmsm_span_equals(const lmsm_span *span, const char *str);
+int lmsm_span_ends_with(const lmsm_span *span, const char *suffix);
+
+// an optionally negative run of digits
+int lmsm_span_is_number(const lmsm_span *span);
+
+// the value of a number span, clamped to +/-(limit + 1) so overflow can be detected
+int lmsm_span_to_int(const lmsm_span *span, int limit);
+
+#endif //LMSM_LEXER_H
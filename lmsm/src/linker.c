@@ -0,0 +1,420 @@
+//
+// Relocatable objects and the linker that lays them out in memory
+//
+
+#include "linker.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define LMSM_OBJECT_VERSION 1
+#define LMSM_OBJECT_MAX_NAME 256
+
+//======================================================
+//  Objects
+//======================================================
+
+lmsm_object *lmsm_object_create(char *name) {
+    lmsm_object *object = calloc(1, sizeof(lmsm_object));
+    object->arena = lmsm_arena_create();
+    object->name = lmsm_arena_strdup(object->arena, name);
+    object->base = -1;
+    return object;
+}
+
+void lmsm_object_delete(lmsm_object *object) {
+    lmsm_arena_delete(object->arena);
+    free(object);
+}
+
+lmsm_object *lmsm_object_from_result(char *name, asm_compilation_result *result) {
+    lmsm_object *object = lmsm_object_create(name);
+    object->size = result->size;
+    memcpy(object->code, result->code, sizeof(object->code));
+    memcpy(object->relocations, result->relocations, sizeof(object->relocations));
+    object->relocation_count = result->relocation_count;
+
+    // every label defined here is exported, every label left waiting is imported
+    asm_symbol_table *symbols = result->symbols;
+    for (int i = 0; i < symbols->capacity; ++i) {
+        if (symbols->slots[i].name == NULL) {
+            continue;
+        } else if (symbols->slots[i].offset != -1) {
+            object->export_count++;
+        } else if (symbols->slots[i].fixups != NULL) {
+            object->import_count++;
+        }
+    }
+    object->exports = lmsm_arena_alloc(object->arena, object->export_count * sizeof(lmsm_object_symbol));
+    object->imports = lmsm_arena_alloc(object->arena, object->import_count * sizeof(lmsm_object_symbol));
+    int exports = 0, imports = 0;
+    for (int i = 0; i < symbols->capacity; ++i) {
+        asm_symbol *symbol = &symbols->slots[i];
+        if (symbol->name == NULL) {
+            continue;
+        } else if (symbol->offset != -1) {
+            lmsm_object_symbol *export = &object->exports[exports++];
+            export->name = lmsm_arena_strdup(object->arena, symbol->name);
+            export->offset = symbol->offset;
+        } else if (symbol->fixups != NULL) {
+            lmsm_object_symbol *import = &object->imports[imports++];
+            import->name = lmsm_arena_strdup(object->arena, symbol->name);
+            for (asm_fixup *fixup = symbol->fixups; fixup != NULL; fixup = fixup->next) {
+                import->use_count++;
+            }
+            import->uses = lmsm_arena_alloc(object->arena, import->use_count * sizeof(int));
+            int uses = 0;
+            for (asm_fixup *fixup = symbol->fixups; fixup != NULL; fixup = fixup->next) {
+                import->uses[uses++] = fixup->offset;
+            }
+        }
+    }
+    return object;
+}
+
+lmsm_object *lmsm_object_assemble(char *name, char *src, char *message, size_t size) {
+    asm_compilation_result *result = asm_assemble_with_options(src, ASM_RELOCATABLE);
+    lmsm_object *object = NULL;
+    if (result->error) {
+        snprintf(message, size, "%s: %s at line %d, column %d", name, result->error,
+                 result->error_line, result->error_column);
+    } else {
+        object = lmsm_object_from_result(name, result);
+    }
+    asm_delete_compilation_result(result);
+    return object;
+}
+
+//======================================================
+//  Object Files
+//======================================================
+
+int lmsm_object_write(lmsm_object *object, char *filename) {
+    FILE *file = fopen(filename, "w");
+    if (file == NULL) {
+        return 0;
+    }
+    fprintf(file, "LMSM-OBJECT %d\nsize %d\ncode", LMSM_OBJECT_VERSION, object->size);
+    for (int i = 0; i < object->size; ++i) {
+        fprintf(file, " %d", object->code[i]);
+    }
+    fprintf(file, "\nrelocations %d", object->relocation_count);
+    for (int i = 0; i < object->relocation_count; ++i) {
+        fprintf(file, " %d", object->relocations[i]);
+    }
+    fprintf(file, "\nexports %d\n", object->export_count);
+    for (int i = 0; i < object->export_count; ++i) {
+        fprintf(file, "%s %d\n", object->exports[i].name, object->exports[i].offset);
+    }
+    fprintf(file, "imports %d\n", object->import_count);
+    for (int i = 0; i < object->import_count; ++i) {
+        fprintf(file, "%s %d", object->imports[i].name, object->imports[i].use_count);
+        for (int j = 0; j < object->imports[i].use_count; ++j) {
+            fprintf(file, " %d", object->imports[i].uses[j]);
+        }
+        fprintf(file, "\n");
+    }
+    return fclose(file) == 0;
+}
+
+int lmsm_object_read_symbols(FILE *file, lmsm_object *object, char *section, lmsm_object_symbol **symbols,
+                             int *count, int with_uses) {
+    char format[32];
+    snprintf(format, sizeof(format), " %s %%d", section);
+    if (fscanf(file, format, count) != 1 || *count < 0 || *count > 100) {
+        return 0;
+    }
+    *symbols = lmsm_arena_alloc(object->arena, *count * sizeof(lmsm_object_symbol) + 1);
+    char name[LMSM_OBJECT_MAX_NAME];
+    for (int i = 0; i < *count; ++i) {
+        lmsm_object_symbol *symbol = &(*symbols)[i];
+        int value;
+        if (fscanf(file, " %255s %d", name, &value) != 2 || value < 0 || value > 100) {
+            return 0;
+        }
+        symbol->name = lmsm_arena_strdup(object->arena, name);
+        if (!with_uses) {
+            symbol->offset = value;
+            continue;
+        }
+        symbol->use_count = value;
+        symbol->uses = lmsm_arena_alloc(object->arena, value * sizeof(int) + 1);
+        for (int j = 0; j < value; ++j) {
+            if (fscanf(file, " %d", &symbol->uses[j]) != 1 || symbol->uses[j] < 0 || symbol->uses[j] >= object->size) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+lmsm_object *lmsm_object_read(char *name, char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        return NULL;
+    }
+    lmsm_object *object = lmsm_object_create(name);
+    int version;
+    int ok = fscanf(file, "LMSM-OBJECT %d size %d code", &version, &object->size) == 2 &&
+             version == LMSM_OBJECT_VERSION && object->size >= 0 && object->size <= 100;
+    for (int i = 0; ok && i < object->size; ++i) {
+        ok = fscanf(file, " %d", &object->code[i]) == 1;
+    }
+    ok = ok && fscanf(file, " relocations %d", &object->relocation_count) == 1 &&
+         object->relocation_count >= 0 && object->relocation_count <= 100;
+    for (int i = 0; ok && i < object->relocation_count; ++i) {
+        ok = fscanf(file, " %d", &object->relocations[i]) == 1 &&
+             object->relocations[i] >= 0 && object->relocations[i] < object->size;
+    }
+    ok = ok && lmsm_object_read_symbols(file, object, "exports", &object->exports, &object->export_count, 0);
+    ok = ok && lmsm_object_read_symbols(file, object, "imports", &object->imports, &object->import_count, 1);
+    fclose(file);
+    if (!ok) {
+        lmsm_object_delete(object);
+        return NULL;
+    }
+    return object;
+}
+
+//======================================================
+//  Module Cache
+//======================================================
+
+unsigned long long lmsm_object_hash(const char *src) {
+    // FNV-1a, 64 bit
+    unsigned long long hash = 14695981039346656037ull;
+    for (const char *c = src; *c != '\0'; ++c) {
+        hash ^= (unsigned char) *c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+lmsm_object *lmsm_object_load_cached(char *cache_dir, char *name, char *src, int *cached,
+                                     char *message, size_t size) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%016llx.lobj", cache_dir, lmsm_object_hash(src));
+    lmsm_object *object = lmsm_object_read(name, path);
+    *cached = object != NULL;
+    if (object == NULL) {
+        object = lmsm_object_assemble(name, src, message, size);
+        if (object != NULL) {
+            mkdir(cache_dir, 0755);  // a cache that can't be written is only slower
+            lmsm_object_write(object, path);
+        }
+    }
+    return object;
+}
+
+//======================================================
+//  Linking
+//======================================================
+
+// the first object that exports name or -1, duplicate is set to a second one or -1
+int lmsm_ld_find_export(lmsm_object **objects, int count, char *name, int *offset, int *duplicate) {
+    int found = -1;
+    *duplicate = -1;
+    for (int i = 0; i < count && *duplicate == -1; ++i) {
+        for (int j = 0; j < objects[i]->export_count; ++j) {
+            if (strcmp(objects[i]->exports[j].name, name) != 0) {
+                continue;
+            } else if (found == -1) {
+                found = i;
+                *offset = objects[i]->exports[j].offset;
+            } else {
+                *duplicate = i;
+            }
+            break;
+        }
+    }
+    return found;
+}
+
+#define LMSM_LD_STUB_SIZE 3
+
+// a resident entry point into an overlay segment
+typedef struct lmsm_ld_stub {
+    int object;
+    int offset;
+} lmsm_ld_stub;
+
+int lmsm_ld_is_overlay(lmsm_object *object, lmsm_overlays *overlays) {
+    return overlays != NULL && object->overlay;
+}
+
+// the stub for an offset into an overlay object, adding one if there isn't one yet
+int lmsm_ld_find_stub(lmsm_ld_stub *stubs, int *stub_count, int object, int offset) {
+    for (int i = 0; i < *stub_count; ++i) {
+        if (stubs[i].object == object && stubs[i].offset == offset) {
+            return i;
+        }
+    }
+    lmsm_ld_stub stub = {object, offset};
+    stubs[*stub_count] = stub;
+    return (*stub_count)++;
+}
+
+// resident modules an overlay calls must not call overlays themselves
+int lmsm_ld_check_overlay_calls(lmsm_object **objects, int count, int *order, int included,
+                                lmsm_overlays *overlays, char *message, size_t size) {
+    char *called_from = calloc(count, sizeof(char));
+    int ok = 1;
+    for (int i = 0; i < included; ++i) {
+        if (lmsm_ld_is_overlay(objects[order[i]], overlays)) {
+            called_from[order[i]] = 1;
+        }
+    }
+    // propagate from each segment through the resident modules it calls, until nothing changes
+    for (int changed = 1; ok && changed;) {
+        changed = 0;
+        for (int i = 0; ok && i < included; ++i) {
+            lmsm_object *object = objects[order[i]];
+            for (int j = 0; called_from[order[i]] && ok && j < object->import_count; ++j) {
+                int offset, duplicate;
+                int exporter = lmsm_ld_find_export(objects, count, object->imports[j].name, &offset, &duplicate);
+                if (!lmsm_ld_is_overlay(objects[exporter], overlays)) {
+                    changed |= !called_from[exporter];
+                    called_from[exporter] = 1;
+                } else if (lmsm_ld_is_overlay(object, overlays)) {
+                    snprintf(message, size, "Overlay %s calls '%s' in overlay %s, overlays may only call resident code",
+                             object->name, object->imports[j].name, objects[exporter]->name);
+                    ok = 0;
+                } else {
+                    snprintf(message, size, "%s calls '%s' in overlay %s, but is itself called from an overlay",
+                             object->name, object->imports[j].name, objects[exporter]->name);
+                    ok = 0;
+                }
+            }
+        }
+    }
+    free(called_from);
+    return ok;
+}
+
+int lmsm_ld_link(lmsm_object **objects, int count, int code[100], char *message, size_t size) {
+    return lmsm_ld_link_overlays(objects, count, code, NULL, message, size);
+}
+
+int lmsm_ld_link_overlays(lmsm_object **objects, int count, int code[100], lmsm_overlays *overlays,
+                          char *message, size_t size) {
+    memset(code, 0, 100 * sizeof(int));
+    for (int i = 0; i < count; ++i) {
+        objects[i]->base = -1;
+        objects[i]->segment = -1;
+    }
+    if (overlays) {
+        overlays->count = 0;
+        overlays->window_size = 0;
+    }
+    if (count == 0) {
+        snprintf(message, size, "Nothing to link");
+        return 0;
+    } else if (lmsm_ld_is_overlay(objects[0], overlays)) {
+        snprintf(message, size, "The entry module %s can't be an overlay", objects[0]->name);
+        return 0;
+    }
+
+    // the entry module goes first, then each module the included ones import from.
+    // overlays are numbered as they are found, and laid out once the resident code is
+    int *order = malloc(count * sizeof(int));
+    lmsm_ld_stub stubs[100 / LMSM_LD_STUB_SIZE + 1];
+    int stub_count = 0;
+    int included = 1;
+    order[0] = 0;
+    objects[0]->base = 0;
+    int end = objects[0]->size;
+    int ok = 1;
+    for (int i = 0; ok && i < included; ++i) {
+        lmsm_object *object = objects[order[i]];
+        for (int j = 0; ok && j < object->import_count; ++j) {
+            char *name = object->imports[j].name;
+            int offset, duplicate;
+            int exporter = lmsm_ld_find_export(objects, count, name, &offset, &duplicate);
+            if (exporter == -1) {
+                snprintf(message, size, "%s '%s' imported by %s", ASM_ERROR_BAD_LABEL, name, object->name);
+                ok = 0;
+            } else if (duplicate != -1) {
+                snprintf(message, size, "%s '%s' exported by %s and %s", ASM_ERROR_DUPLICATE_LABEL, name,
+                         objects[exporter]->name, objects[duplicate]->name);
+                ok = 0;
+            } else if (lmsm_ld_is_overlay(objects[exporter], overlays)) {
+                if (objects[exporter]->segment == -1 && overlays->count == OVERLAY_MAX_SEGMENTS) {
+                    snprintf(message, size, "More than %d overlays", OVERLAY_MAX_SEGMENTS);
+                    ok = 0;
+                } else if (stub_count * LMSM_LD_STUB_SIZE >= 100) {
+                    snprintf(message, size, "%s: too many overlay entry points", ASM_ERROR_PROGRAM_TOO_LARGE);
+                    ok = 0;
+                } else {
+                    if (objects[exporter]->segment == -1) {
+                        objects[exporter]->segment = overlays->count++;
+                        order[included++] = exporter;
+                    }
+                    if (!lmsm_ld_is_overlay(object, overlays)) {
+                        lmsm_ld_find_stub(stubs, &stub_count, exporter, offset);
+                    }
+                }
+            } else if (objects[exporter]->base == -1) {
+                objects[exporter]->base = end;
+                end += objects[exporter]->size;
+                order[included++] = exporter;
+            }
+        }
+    }
+    if (ok && overlays) {
+        ok = lmsm_ld_check_overlay_calls(objects, count, order, included, overlays, message, size);
+    }
+
+    // stubs follow the resident code, and the window follows the stubs
+    int window = end + stub_count * LMSM_LD_STUB_SIZE;
+    int window_size = 0;
+    for (int i = 0; i < included; ++i) {
+        lmsm_object *object = objects[order[i]];
+        if (lmsm_ld_is_overlay(object, overlays)) {
+            object->base = window;
+            window_size = object->size > window_size ? object->size : window_size;
+        }
+    }
+    if (ok && window + window_size > 100) {
+        snprintf(message, size, "%s: %d words", ASM_ERROR_PROGRAM_TOO_LARGE, window + window_size);
+        ok = 0;
+    }
+
+    for (int i = 0; ok && i < included; ++i) {
+        lmsm_object *object = objects[order[i]];
+        int base = object->base;
+        int *words = code + base;
+        if (lmsm_ld_is_overlay(object, overlays)) {
+            words = overlays->segments[object->segment].code;
+            overlays->segments[object->segment].size = object->size;
+        }
+        memcpy(words, object->code, object->size * sizeof(int));
+        for (int j = 0; j < object->relocation_count; ++j) {
+            words[object->relocations[j]] += base;
+        }
+        for (int j = 0; j < object->import_count; ++j) {
+            int offset, duplicate;
+            int exporter = lmsm_ld_find_export(objects, count, object->imports[j].name, &offset, &duplicate);
+            int address = objects[exporter]->base + offset;
+            if (lmsm_ld_is_overlay(objects[exporter], overlays)) {
+                address = end + lmsm_ld_find_stub(stubs, &stub_count, exporter, offset) * LMSM_LD_STUB_SIZE;
+            }
+            for (int k = 0; k < object->imports[j].use_count; ++k) {
+                words[object->imports[j].uses[k]] += address;
+            }
+        }
+    }
+    for (int i = 0; ok && i < stub_count; ++i) {
+        int *stub = code + end + i * LMSM_LD_STUB_SIZE;
+        stub[0] = 400 + objects[stubs[i].object]->segment;  // LDI segment
+        stub[1] = OVERLAY_INSTRUCTION;
+        stub[2] = 600 + window + stubs[i].offset;           // BRA entry
+    }
+    if (ok && overlays) {
+        overlays->window = window;
+        overlays->window_size = window_size;
+    }
+    free(order);
+    return ok;
+}
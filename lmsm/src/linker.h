@@ -0,0 +1,77 @@
+//
+// Relocatable objects and the linker that lays them out in memory
+//
+
+#ifndef LMSM_LINKER_H
+#define LMSM_LINKER_H
+
+#include "arena.h"
+#include "assembler.h"
+#include "overlay.h"
+
+#include <stddef.h>
+
+//===================================================================
+//  A relocatable object: code assembled as if it were loaded at 0,
+//  the words that must move with it, the labels it defines and the
+//  labels it uses but leaves for other modules to define
+//===================================================================
+typedef struct lmsm_object_symbol {
+    char *name;
+    int offset;                  // exports: where the label is defined in the module
+    int *uses;                   // imports: the words waiting on the label's address
+    int use_count;
+} lmsm_object_symbol;
+
+typedef struct lmsm_object {
+    lmsm_arena *arena;           // names and use lists, freed with the object
+    char *name;                  // where the module came from, for messages
+    int base;                    // where the last link placed it, -1 if it wasn't needed
+    int overlay;                 // link it into an overlay segment instead of resident memory
+    int segment;                 // with overlay set, the segment the last link gave it
+    int size;
+    int code[100];
+    int relocations[100];        // words holding an offset within this module
+    int relocation_count;
+    lmsm_object_symbol *exports;
+    int export_count;
+    lmsm_object_symbol *imports;
+    int import_count;
+} lmsm_object;
+
+#define LMSM_LINK_MESSAGE_SIZE 256
+
+//===================================================================
+//  API
+//===================================================================
+
+// assembles src into an object, or returns NULL and describes the error in message
+lmsm_object *lmsm_object_assemble(char *name, char *src, char *message, size_t size);
+
+// the object for a result assembled with ASM_RELOCATABLE
+lmsm_object *lmsm_object_from_result(char *name, asm_compilation_result *result);
+
+void lmsm_object_delete(lmsm_object *object);
+
+// the text object format, returns 0 if the file can't be written or isn't an object
+int lmsm_object_write(lmsm_object *object, char *filename);
+lmsm_object *lmsm_object_read(char *name, char *filename);
+
+// assembles a module through an on-disk cache keyed by a hash of its source,
+// so a shared library is only assembled the first time it is linked.
+// cached is set if the object came from the cache
+lmsm_object *lmsm_object_load_cached(char *cache_dir, char *name, char *src, int *cached,
+                                     char *message, size_t size);
+
+// lays out the first object at 0, followed by every object that exports a label an
+// included object imports, and patches their relocations. returns 0 on error
+int lmsm_ld_link(lmsm_object **objects, int count, int code[100], char *message, size_t size);
+
+// links like lmsm_ld_link, but objects marked overlay become segments in overlays instead.
+// resident code reaches a segment through a stub that loads it into a window after the
+// resident code. segments may only call resident code, and resident code they call may not
+// call into segments, since either would return into a window that has since been replaced
+int lmsm_ld_link_overlays(lmsm_object **objects, int count, int code[100], lmsm_overlays *overlays,
+                          char *message, size_t size);
+
+#endif //LMSM_LINKER_H
@@ -1,4 +1,7 @@
 #include "lmsm.h"
+#include "history.h"
+#include "overlay.h"
+#include "trace.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -25,6 +28,28 @@ int lmsm_has_two_values_on_stack(lmsm *our_little_machine) {
     return 1;
 }
 
+int lmsm_is_address(int location) {
+    return 0 <= location && location <= TOP_OF_MEMORY;
+}
+
+int lmsm_test_bit(const unsigned int *bits, int location) {
+    return (bits[location / BREAKPOINT_WORD_BITS] >> (location % BREAKPOINT_WORD_BITS)) & 1u;
+}
+
+void lmsm_update_bit(lmsm *our_little_machine, unsigned int *bits, int location, int enabled) {
+    if (!lmsm_is_address(location) || lmsm_test_bit(bits, location) == (enabled != 0)) {
+        return;
+    }
+    unsigned int mask = 1u << (location % BREAKPOINT_WORD_BITS);
+    if (enabled) {
+        bits[location / BREAKPOINT_WORD_BITS] |= mask;
+        our_little_machine->breakpoint_count++;
+    } else {
+        bits[location / BREAKPOINT_WORD_BITS] &= ~mask;
+        our_little_machine->breakpoint_count--;
+    }
+}
+
 //======================================================
 //  Instruction Implementation
 //======================================================
@@ -164,7 +189,13 @@ void lmsm_i_sdiv(lmsm *our_little_machine) {
 }
 
 void lmsm_i_out(lmsm *our_little_machine) {
-    sprintf(our_little_machine->output_buffer + strlen(our_little_machine->output_buffer), "%d ", our_little_machine->accumulator);
+    size_t length = strlen(our_little_machine->output_buffer);
+    if (OUTPUT_BUFFER_SIZE - length < 6) { // room for "-999 " and the terminator
+        our_little_machine->status = STATUS_HALTED;
+        our_little_machine->error_code = ERROR_OUTPUT_EXHAUSTED;
+    } else {
+        sprintf(our_little_machine->output_buffer + length, "%d ", our_little_machine->accumulator);
+    }
 }
 
 void lmsm_i_inp(lmsm *our_little_machine) {
@@ -191,6 +222,10 @@ void lmsm_i_store(lmsm *our_little_machine, int location) {
     our_little_machine->memory[location] = our_little_machine->accumulator;
 }
 
+void lmsm_i_overlay(lmsm *our_little_machine) {
+    lmsm_overlays_load(our_little_machine, our_little_machine->accumulator);
+}
+
 void lmsm_i_halt(lmsm *our_little_machine) {
     our_little_machine->status = STATUS_HALTED;
 }
@@ -214,10 +249,27 @@ void lmsm_i_branch_if_positive(lmsm *our_little_machine, int location) {
 void lmsm_step(lmsm *our_little_machine) {
     if (our_little_machine->status != STATUS_HALTED) {
         int next_instruction = our_little_machine->memory[our_little_machine->program_counter];
+        if (our_little_machine->history) {
+            lmsm_history_record(our_little_machine, next_instruction);
+        }
+        if (our_little_machine->trace) {
+            lmsm_trace_before_step(our_little_machine, next_instruction);
+        }
         our_little_machine->program_counter++;
         our_little_machine->current_instruction = next_instruction;
         int instruction = our_little_machine->current_instruction;
         lmsm_exec_instruction(our_little_machine, instruction);
+        if (our_little_machine->history) {
+            lmsm_history_commit(our_little_machine);
+        }
+        if (our_little_machine->overlays && our_little_machine->overlays->swapped) {
+            // a swap writes the whole window, more than an undo record holds
+            our_little_machine->overlays->swapped = 0;
+            lmsm_history_rebase(our_little_machine);
+        }
+        if (our_little_machine->trace) {
+            lmsm_trace_after_step(our_little_machine);
+        }
     }
 }
 
@@ -272,6 +324,8 @@ void lmsm_exec_instruction(lmsm *our_little_machine, int instruction) {
         lmsm_i_smax(our_little_machine);
     } else if (935 == instruction) {
         lmsm_i_smin(our_little_machine);
+    } else if (OVERLAY_INSTRUCTION == instruction) {
+        lmsm_i_overlay(our_little_machine);
     } else {
         our_little_machine->error_code = ERROR_UNKNOWN_INSTRUCTION;
         our_little_machine->status = STATUS_HALTED;
@@ -283,6 +337,10 @@ void lmsm_load(lmsm *our_little_machine, int *program, int length) {
     for (int i = 0; i < length; ++i) {
         our_little_machine->memory[i] = program[i];
     }
+    if (our_little_machine->overlays) {
+        our_little_machine->overlays->loaded = -1;
+    }
+    lmsm_history_rebase(our_little_machine);
 }
 
 void lmsm_init(lmsm *the_machine) {
@@ -295,10 +353,14 @@ void lmsm_init(lmsm *the_machine) {
     the_machine->return_address_pointer = TOP_OF_MEMORY - 100;
     memset(the_machine->output_buffer, 0, sizeof(char) * 1000);
     memset(the_machine->memory, 0, sizeof(int) * TOP_OF_MEMORY + 1);
+    if (the_machine->overlays) {
+        the_machine->overlays->loaded = -1;  // the window was just cleared
+    }
 }
 
 void lmsm_reset(lmsm *our_little_machine) {
     lmsm_init(our_little_machine);
+    lmsm_history_rebase(our_little_machine);
 }
 
 void lmsm_run(lmsm *our_little_machine) {
@@ -308,12 +370,105 @@ void lmsm_run(lmsm *our_little_machine) {
     }
 }
 
+//======================================================
+//  Breakpoints & Watchpoints
+//======================================================
+
+int lmsm_instruction_writes(lmsm *our_little_machine, int instruction, int addresses[2]) {
+    int count = 0;
+    int sp = our_little_machine->stack_pointer;
+    if (300 <= instruction && instruction <= 399) {
+        addresses[count++] = instruction - 300;
+    } else if (910 == instruction) {
+        addresses[count++] = our_little_machine->return_address_pointer + 1;
+    } else if (920 == instruction || 922 == instruction) {
+        addresses[count++] = sp - 1;
+    } else if (924 == instruction && lmsm_has_two_values_on_stack(our_little_machine) == 0) {
+        addresses[count++] = sp;
+        addresses[count++] = sp + 1;
+    } else if (930 <= instruction && instruction <= 935 && lmsm_has_two_values_on_stack(our_little_machine) == 0) {
+        addresses[count++] = sp + 1;
+    }
+    // drop anything that would land outside of memory
+    int valid = 0;
+    for (int i = 0; i < count; ++i) {
+        if (lmsm_is_address(addresses[i])) {
+            addresses[valid++] = addresses[i];
+        }
+    }
+    return valid;
+}
+
+void lmsm_set_breakpoint(lmsm *our_little_machine, int location, int enabled) {
+    lmsm_update_bit(our_little_machine, our_little_machine->breakpoints, location, enabled);
+}
+
+void lmsm_set_watchpoint(lmsm *our_little_machine, int location, int enabled) {
+    lmsm_update_bit(our_little_machine, our_little_machine->watchpoints, location, enabled);
+}
+
+int lmsm_has_breakpoint(lmsm *our_little_machine, int location) {
+    return lmsm_is_address(location) && lmsm_test_bit(our_little_machine->breakpoints, location);
+}
+
+int lmsm_has_watchpoint(lmsm *our_little_machine, int location) {
+    return lmsm_is_address(location) && lmsm_test_bit(our_little_machine->watchpoints, location);
+}
+
+void lmsm_clear_breakpoints(lmsm *our_little_machine) {
+    memset(our_little_machine->breakpoints, 0, sizeof(our_little_machine->breakpoints));
+    memset(our_little_machine->watchpoints, 0, sizeof(our_little_machine->watchpoints));
+    our_little_machine->breakpoint_count = 0;
+}
+
+int lmsm_run_until_break(lmsm *our_little_machine) {
+    if (our_little_machine->breakpoint_count == 0) {
+        // nothing to check, so use the plain dispatch loop
+        lmsm_run(our_little_machine);
+        return 0;
+    }
+    our_little_machine->status = STATUS_RUNNING;
+    int first_step = 1;
+    while (our_little_machine->status != STATUS_HALTED) {
+        int pc = our_little_machine->program_counter;
+        // the first step always executes so we can continue off of a breakpoint
+        if (!first_step && lmsm_is_address(pc) && lmsm_test_bit(our_little_machine->breakpoints, pc)) {
+            our_little_machine->status = STATUS_READY;
+            return 1;
+        }
+        first_step = 0;
+
+        int addresses[2];
+        int writes = 0;
+        if (lmsm_is_address(pc)) {
+            writes = lmsm_instruction_writes(our_little_machine, our_little_machine->memory[pc], addresses);
+        }
+        lmsm_step(our_little_machine);
+        for (int i = 0; i < writes; ++i) {
+            if (lmsm_test_bit(our_little_machine->watchpoints, addresses[i])) {
+                if (our_little_machine->status != STATUS_HALTED) {
+                    our_little_machine->status = STATUS_READY;
+                }
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
 lmsm *lmsm_create() {
     lmsm *the_machine = malloc(sizeof(lmsm));
+    the_machine->overlays = NULL;
     lmsm_init(the_machine);
+    lmsm_clear_breakpoints(the_machine);
+    the_machine->history = NULL;
+    the_machine->trace = NULL;
     return the_machine;
 }
 
 void lmsm_delete(lmsm *the_machine) {
+    lmsm_history_disable(the_machine);
+    lmsm_trace_stop(the_machine);
+    lmsm_overlays_detach(the_machine);
     free(the_machine);
 }
\ No newline at end of file
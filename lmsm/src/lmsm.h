@@ -16,16 +16,25 @@ typedef enum error_code {
     ERROR_BAD_STACK,
     ERROR_OUTPUT_EXHAUSTED,
     ERROR_UNKNOWN_INSTRUCTION,
+    ERROR_BAD_OVERLAY,
 } error_code;
 
 #define TOP_OF_MEMORY 199
 #define OUTPUT_BUFFER_SIZE 4000
 
+// one bit per memory cell, used for breakpoints and watchpoints
+#define BREAKPOINT_WORD_BITS 32
+#define BREAKPOINT_WORDS ((TOP_OF_MEMORY + BREAKPOINT_WORD_BITS) / BREAKPOINT_WORD_BITS)
+
 //===================================================================
 //  Represents the core computational infrastructure of the
 //  LMSM architecture
 //===================================================================
 
+struct lmsm_history;
+struct lmsm_trace_writer;
+struct lmsm_overlays;
+
 typedef struct lmsm {
     int program_counter;
     int current_instruction;
@@ -36,6 +45,12 @@ typedef struct lmsm {
     int return_address_pointer;
     int memory[TOP_OF_MEMORY + 1];
     char output_buffer[OUTPUT_BUFFER_SIZE];
+    unsigned int breakpoints[BREAKPOINT_WORDS];  // pc values to stop at
+    unsigned int watchpoints[BREAKPOINT_WORDS];  // memory cells to stop on writes to
+    int breakpoint_count;                        // number of breakpoints + watchpoints set
+    struct lmsm_history *history;                // execution history for reverse stepping, if enabled
+    struct lmsm_trace_writer *trace;             // binary execution trace, if enabled
+    struct lmsm_overlays *overlays;              // code segments LDOVL swaps into memory, if any
 } lmsm;
 
 //=====================================================
@@ -62,4 +77,24 @@ void lmsm_exec_instruction(lmsm *our_little_machine, int instruction);
 
 void lmsm_reset(lmsm *our_little_machine);
 
+// returns the number of memory cells the instruction will write, filling in addresses (max 2)
+int lmsm_instruction_writes(lmsm *our_little_machine, int instruction, int addresses[2]);
+
+// sets or clears a breakpoint on the given program counter value
+void lmsm_set_breakpoint(lmsm *our_little_machine, int location, int enabled);
+
+// sets or clears a watchpoint on writes to the given memory cell
+void lmsm_set_watchpoint(lmsm *our_little_machine, int location, int enabled);
+
+// returns 1 if a breakpoint/watchpoint is set on the given location
+int lmsm_has_breakpoint(lmsm *our_little_machine, int location);
+int lmsm_has_watchpoint(lmsm *our_little_machine, int location);
+
+// removes all breakpoints and watchpoints
+void lmsm_clear_breakpoints(lmsm *our_little_machine);
+
+// runs until the machine halts, reaches a breakpoint or writes to a watched cell
+// returns 1 if stopped on a breakpoint or watchpoint, 0 if halted
+int lmsm_run_until_break(lmsm *our_little_machine);
+
 #endif //LMSM_LMSM_H
@@ -1,19 +1,40 @@
 #include "assembler.h"
 #include "lmsm.h"
 #include "repl.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 int main(int argc, char *argv[]) {
     printf("Little Man Stack Machine...\n\n");
 
+    char *program = NULL;
+    char *trace_file = NULL;
+    int compress = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (strcmp(argv[i], "--compress") == 0) {
+            compress = 1;
+        } else if (strcmp(argv[i], "-q") == 0 || strcmp(argv[i], "--quiet") == 0) {
+            repl_set_quiet(1);
+        } else {
+            program = argv[i];
+        }
+    }
+
     lmsm * our_little_machine = lmsm_create();
-    if (argc == 2) {
-        int result = repl_load_file(our_little_machine, argv[1]);
+    if (trace_file && !lmsm_trace_start(our_little_machine, trace_file, compress)) {
+        printf("Unable to open trace file: '%s'\n\n", trace_file);
+    }
+    if (program) {
+        int result = repl_load_file(our_little_machine, program);
         if (result) {
             lmsm_run(our_little_machine);
         }
+        lmsm_delete(our_little_machine);
     } else {
         repl_start(our_little_machine);
     }
-}
\ No newline at end of file
+}
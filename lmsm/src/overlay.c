@@ -0,0 +1,103 @@
+//
+// Overlays: code segments the host swaps into a window of memory on demand
+//
+
+#include "overlay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LMSM_OVERLAYS_VERSION 1
+
+lmsm_overlays *lmsm_overlays_create() {
+    lmsm_overlays *overlays = calloc(1, sizeof(lmsm_overlays));
+    overlays->loaded = -1;
+    return overlays;
+}
+
+void lmsm_overlays_delete(lmsm_overlays *overlays) {
+    free(overlays);
+}
+
+void lmsm_overlays_attach(lmsm *our_little_machine, lmsm_overlays *overlays) {
+    lmsm_overlays_detach(our_little_machine);
+    overlays->loaded = -1;
+    our_little_machine->overlays = overlays;
+}
+
+void lmsm_overlays_detach(lmsm *our_little_machine) {
+    if (our_little_machine->overlays) {
+        lmsm_overlays_delete(our_little_machine->overlays);
+        our_little_machine->overlays = NULL;
+    }
+}
+
+//======================================================
+//  Loading
+//======================================================
+
+void lmsm_overlays_load(lmsm *our_little_machine, int segment) {
+    lmsm_overlays *overlays = our_little_machine->overlays;
+    if (overlays == NULL || segment < 0 || segment >= overlays->count) {
+        our_little_machine->status = STATUS_HALTED;
+        our_little_machine->error_code = ERROR_BAD_OVERLAY;
+    } else if (overlays->loaded == segment) {
+        overlays->hits++;
+    } else {
+        lmsm_overlay_segment *loading = &overlays->segments[segment];
+        memcpy(our_little_machine->memory + overlays->window, loading->code, loading->size * sizeof(int));
+        overlays->loaded = segment;
+        overlays->swapped = 1;
+        overlays->loads++;
+    }
+}
+
+//======================================================
+//  Overlay Files
+//======================================================
+
+int lmsm_overlays_write(lmsm_overlays *overlays, char *filename) {
+    FILE *file = fopen(filename, "w");
+    if (file == NULL) {
+        return 0;
+    }
+    fprintf(file, "LMSM-OVERLAYS %d\nwindow %d %d\nsegments %d\n", LMSM_OVERLAYS_VERSION,
+            overlays->window, overlays->window_size, overlays->count);
+    for (int i = 0; i < overlays->count; ++i) {
+        fprintf(file, "%d", overlays->segments[i].size);
+        for (int j = 0; j < overlays->segments[i].size; ++j) {
+            fprintf(file, " %d", overlays->segments[i].code[j]);
+        }
+        fprintf(file, "\n");
+    }
+    return fclose(file) == 0;
+}
+
+lmsm_overlays *lmsm_overlays_read(char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        return NULL;
+    }
+    lmsm_overlays *overlays = lmsm_overlays_create();
+    int version;
+    int ok = fscanf(file, "LMSM-OVERLAYS %d window %d %d segments %d", &version, &overlays->window,
+                    &overlays->window_size, &overlays->count) == 4 &&
+             version == LMSM_OVERLAYS_VERSION && overlays->window >= 0 && overlays->window_size >= 0 &&
+             overlays->window + overlays->window_size <= 100 &&
+             overlays->count >= 0 && overlays->count <= OVERLAY_MAX_SEGMENTS;
+    for (int i = 0; ok && i < overlays->count; ++i) {
+        lmsm_overlay_segment *segment = &overlays->segments[i];
+        ok = fscanf(file, " %d", &segment->size) == 1 && segment->size >= 0 &&
+             segment->size <= overlays->window_size;
+        for (int j = 0; ok && j < segment->size; ++j) {
+            ok = fscanf(file, " %d", &segment->code[j]) == 1;
+        }
+    }
+    fclose(file);
+    if (!ok) {
+        lmsm_overlays_delete(overlays);
+        return NULL;
+    }
+    return overlays;
+}
@@ -0,0 +1,58 @@
+//
+// Overlays: code segments the host swaps into a window of memory on demand
+//
+
+#ifndef LMSM_OVERLAY_H
+#define LMSM_OVERLAY_H
+
+#include "lmsm.h"
+
+#define OVERLAY_MAX_SEGMENTS 32
+#define OVERLAY_INSTRUCTION 940   // loads the segment numbered by the accumulator into the window
+
+//===================================================================
+//  The segments of an overlaid program and the window they share.
+//  Resident code calls into a segment through a stub:
+//
+//      LDI <segment>
+//      LDOVL
+//      BRA <window + entry>
+//
+//  LDOVL only copies the segment in if it isn't already loaded
+//===================================================================
+typedef struct lmsm_overlay_segment {
+    int size;
+    int code[100];               // linked to run at the window
+} lmsm_overlay_segment;
+
+typedef struct lmsm_overlays {
+    int window;                  // the first word of the window
+    int window_size;
+    lmsm_overlay_segment segments[OVERLAY_MAX_SEGMENTS];
+    int count;
+    int loaded;                  // the segment in the window, -1 if none is
+    int swapped;                 // set when the last LDOVL replaced the window
+    long loads;                  // LDOVLs that copied a segment in
+    long hits;                   // LDOVLs that found it already loaded
+} lmsm_overlays;
+
+//===================================================================
+//  API
+//===================================================================
+
+lmsm_overlays *lmsm_overlays_create();
+void lmsm_overlays_delete(lmsm_overlays *overlays);
+
+// gives the machine its overlays, which it then owns and frees, replacing any it had
+void lmsm_overlays_attach(lmsm *our_little_machine, lmsm_overlays *overlays);
+void lmsm_overlays_detach(lmsm *our_little_machine);
+
+// executes LDOVL: loads the segment into the window unless it is already there.
+// halts with ERROR_BAD_OVERLAY if the machine has no such segment
+void lmsm_overlays_load(lmsm *our_little_machine, int segment);
+
+// the text overlay format written next to a linked image, returns 0/NULL on error
+int lmsm_overlays_write(lmsm_overlays *overlays, char *filename);
+lmsm_overlays *lmsm_overlays_read(char *filename);
+
+#endif //LMSM_OVERLAY_H
@@ -0,0 +1,116 @@
+//
+// Host hardware performance counters, used to attribute host cost
+// to guest workloads
+//
+
+#include "perf.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+char *LMSM_PERF_EVENT_NAMES[] = {"cycles", "instructions", "branch-misses", "L1d-misses"};
+
+int lmsm_perf_format_value(char *buffer, int size, char *label, long long value, double per) {
+    if (value < 0) {
+        return snprintf(buffer, size, "  %s n/a", label);
+    }
+    return snprintf(buffer, size, "  %s %.3f", label, (double) value / per);
+}
+
+void lmsm_perf_format(lmsm_perf_counters *counters, double guest_steps, char *buffer, int size) {
+    static char *labels[] = {"cycles/inst", "host-insts/inst", "mispredicts/dispatch", "L1d-misses/inst"};
+    int length = 0;
+    buffer[0] = '\0';
+    for (int i = 0; i < PERF_EVENT_COUNT && length < size; ++i) {
+        length += lmsm_perf_format_value(buffer + length, size - length, labels[i], counters->values[i], guest_steps);
+    }
+}
+
+#ifdef __linux__
+
+int lmsm_perf_open_event(unsigned int type, unsigned long long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int lmsm_perf_open(lmsm_perf_counters *counters) {
+    counters->fds[PERF_CYCLES] = lmsm_perf_open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    counters->fds[PERF_INSTRUCTIONS] = lmsm_perf_open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    counters->fds[PERF_BRANCH_MISSES] = lmsm_perf_open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    counters->fds[PERF_L1D_MISSES] = lmsm_perf_open_event(PERF_TYPE_HW_CACHE,
+                                                          PERF_COUNT_HW_CACHE_L1D |
+                                                          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    int available = 0;
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        counters->values[i] = -1;
+        available |= counters->fds[i] >= 0;
+    }
+    return available;
+}
+
+void lmsm_perf_start(lmsm_perf_counters *counters) {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void lmsm_perf_stop(lmsm_perf_counters *counters) {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        counters->values[i] = -1;
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            long long value;
+            if (read(counters->fds[i], &value, sizeof(value)) == sizeof(value)) {
+                counters->values[i] = value;
+            }
+        }
+    }
+}
+
+void lmsm_perf_close(lmsm_perf_counters *counters) {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (counters->fds[i] >= 0) {
+            close(counters->fds[i]);
+        }
+        counters->fds[i] = -1;
+    }
+}
+
+#else
+
+int lmsm_perf_open(lmsm_perf_counters *counters) {
+    for (int i = 0; i < PERF_EVENT_COUNT; ++i) {
+        counters->fds[i] = -1;
+        counters->values[i] = -1;
+    }
+    return 0;
+}
+
+void lmsm_perf_start(lmsm_perf_counters *counters) {
+}
+
+void lmsm_perf_stop(lmsm_perf_counters *counters) {
+}
+
+void lmsm_perf_close(lmsm_perf_counters *counters) {
+}
+
+#endif
@@ -0,0 +1,46 @@
+//
+// Host hardware performance counters, used to attribute host cost
+// to guest workloads
+//
+
+#ifndef LMSM_PERF_H
+#define LMSM_PERF_H
+
+typedef enum lmsm_perf_event {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_EVENT_COUNT
+} lmsm_perf_event;
+
+extern char *LMSM_PERF_EVENT_NAMES[];
+
+//===================================================================
+//  A set of counters, one per event.  Events the host can't count
+//  have a file descriptor of -1 and always read as -1
+//===================================================================
+typedef struct lmsm_perf_counters {
+    int fds[PERF_EVENT_COUNT];
+    long long values[PERF_EVENT_COUNT];
+} lmsm_perf_counters;
+
+//===================================================================
+//  API
+//===================================================================
+
+// opens counters for the calling thread, returns 0 if none are available
+int lmsm_perf_open(lmsm_perf_counters *counters);
+
+// resets and starts every available counter
+void lmsm_perf_start(lmsm_perf_counters *counters);
+
+// stops the counters and reads them into values
+void lmsm_perf_stop(lmsm_perf_counters *counters);
+
+void lmsm_perf_close(lmsm_perf_counters *counters);
+
+// formats the last reading per guest instruction (each of which is one dispatch) into buffer
+void lmsm_perf_format(lmsm_perf_counters *counters, double guest_steps, char *buffer, int size);
+
+#endif //LMSM_PERF_H
@@ -8,77 +8,183 @@
 #include "assembler.h"
 #include "firth.h"
 #include "lmsm.h"
+#include "history.h"
+#include "overlay.h"
+#include "engines.h"
+#include "trace.h"
+#include "source.h"
+#include "srcmap.h"
 #include <stdio.h>
 #include <stdlib.h>
 
-char * repl_read_file(char * filename){
-    FILE *file = fopen(filename, "rb");
-    if (file == NULL) {
-        printf("Unknown file: '%s'\n\n", filename);
-        return "";
+asm_incremental *repl_incremental = NULL;  // the assembly last loaded with [l]oad, kept for patching
+
+void repl_forget_incremental() {
+    if (repl_incremental) {
+        asm_incremental_delete(repl_incremental);
+        repl_incremental = NULL;
+    }
+}
+
+lmsm_srcmap *repl_srcmap = NULL;  // where the loaded program's code came from
+
+void repl_remember_srcmap(char *file, asm_compilation_result *result, firth_compilation_result *firth_result) {
+    if (repl_srcmap) {
+        lmsm_srcmap_delete(repl_srcmap);
+    }
+    repl_srcmap = lmsm_srcmap_create();
+    lmsm_srcmap_add_assembly(repl_srcmap, file, result, firth_result);
+}
+
+void repl_print_location(lmsm *our_little_machine) {
+    char location[SRCMAP_MAX_FILE_NAME + 64];
+    lmsm_srcmap_format(repl_srcmap, our_little_machine->program_counter, location, sizeof(location));
+    if (location[0]) {
+        printf("Stopped at %02d (%s)\n", our_little_machine->program_counter, location);
     } else {
-        fseek(file, 0, SEEK_END);
-        long file_size = ftell(file);
-        rewind(file);
-        char *contents = malloc(file_size + 1);
-        fread(contents, 1, file_size, file);
-        fclose(file);
-        contents[file_size] = 0;
-        return contents;
+        printf("Stopped at %02d\n", our_little_machine->program_counter);
+    }
+}
+
+int repl_quiet = 0;  // don't echo sources and generated assembly as they are loaded
+
+void repl_set_quiet(int quiet) {
+    repl_quiet = quiet;
+}
+
+int repl_open_source(lmsm_source *source, char *filename) {
+    if (!lmsm_source_open(source, filename)) {
+        printf("Unknown file: '%s'\n\n", filename);
+        return 0;
     }
+    return 1;
+}
+
+// loads a binary image from lmsm_ld, with the overlays linked alongside it if there are any
+int repl_load_image(lmsm *our_little_machine, char *filename) {
+    int code[100];
+    if (!lmsm_engine_build_file(filename, 0, code, NULL)) {
+        printf("Not an LMSM image: '%s'\n\n", filename);
+        return 0;
+    }
+    lmsm_reset(our_little_machine);
+    lmsm_load(our_little_machine, code, 100);
+    repl_forget_incremental();
+    if (repl_srcmap) {
+        lmsm_srcmap_delete(repl_srcmap);
+        repl_srcmap = NULL;
+    }
+    lmsm_overlays_detach(our_little_machine);
+    char overlay_file[1100];
+    snprintf(overlay_file, sizeof(overlay_file), "%s.ovl", filename);
+    lmsm_overlays *overlays = lmsm_overlays_read(overlay_file);
+    if (overlays) {
+        lmsm_overlays_attach(our_little_machine, overlays);
+        if (!repl_quiet) {
+            printf("Loaded %d overlays into a %d word window at %02d\n\n", overlays->count, overlays->window_size,
+                   overlays->window);
+        }
+    }
+    return 1;
 }
 
 int repl_load_file(lmsm *our_little_machine, char *filename) {
-    char *contents = repl_read_file(filename);
-    printf("Loading:\n%s\n\n", contents);
-    asm_compilation_result *result = asm_assemble(contents);
-    if (result->error) {
-        printf("Assembly Error:\n%s\n\n", result->error);
+    if (lmsm_engine_has_extension(filename, ".bin")) {
+        return repl_load_image(our_little_machine, filename);
+    }
+    lmsm_source source;
+    if (!repl_open_source(&source, filename)) {
         return 0;
+    }
+    if (!repl_quiet) {
+        printf("Loading:\n%s\n\n", source.text);
+    }
+    asm_compilation_result *result = asm_assemble_with_options(source.text, ASM_SOURCE_MAP);
+    int ok = result->error == NULL;
+    if (!ok) {
+        printf("Assembly Error:\n%s\n\n", result->error);
     } else {
         lmsm_reset(our_little_machine);
         lmsm_load(our_little_machine, result->code, 100);
-        return 1;
+        lmsm_overlays_detach(our_little_machine);
+        repl_remember_srcmap(filename, result, NULL);
+        repl_forget_incremental();
+        repl_incremental = asm_incremental_create();
+        if (!asm_incremental_update(repl_incremental, source.text)) {
+            repl_forget_incremental();  // e.g. an argument on the line after its instruction
+        }
     }
+    asm_delete_compilation_result(result);
+    lmsm_source_close(&source);
+    return ok;
 }
 
-int repl_comp_firth(lmsm *our_little_machine, char *filename) {
-    char *contents = repl_read_file(filename);
-    printf("Compiling:\n%s\n\n", contents);
-    firth_compilation_result *compilation_result = firth_compile(contents);
-    if (compilation_result->error) {
-        printf("Compilation Error:\n%s\n\n", compilation_result->error);
+// re-assembles an edited version of the loaded file and writes the words that changed
+// into memory, leaving the registers and stacks of a paused program alone
+int repl_patch_file(lmsm *our_little_machine, char *filename) {
+    if (repl_incremental == NULL) {
+        printf("Nothing to patch, [l]oad an assembly file first\n\n");
         return 0;
     }
-    printf("Assembly:\n%s\n\n", compilation_result->lmsm_assembly);
-    asm_compilation_result *result = asm_assemble(compilation_result->lmsm_assembly);
-    if (result->error) {
-        printf("Assembly Error:\n%s\n\n", result->error);
+    lmsm_source source;
+    if (!repl_open_source(&source, filename)) {
+        return 0;
+    }
+    int ok = asm_incremental_update(repl_incremental, source.text);
+    lmsm_source_close(&source);
+    if (!ok) {
+        asm_compilation_result *result = repl_incremental->result;
+        printf("Assembly Error:\n%s at line %d, column %d\n\n", result->error, result->error_line, result->error_column);
         return 0;
-    } else {
-        lmsm_reset(our_little_machine);
-        lmsm_load(our_little_machine, result->code, 100);
-        return 1;
     }
+    asm_incremental_patch(repl_incremental, our_little_machine->memory);
+    if (repl_srcmap) {
+        lmsm_srcmap_delete(repl_srcmap);  // the lines have moved, better no locations than wrong ones
+        repl_srcmap = NULL;
+    }
+    lmsm_history_rebase(our_little_machine);
+    printf("Patched %d words, re-read %d lines\n\n", repl_incremental->changed_count, repl_incremental->relexed_lines);
+    return 1;
 }
 
-int repl_load_firth(lmsm *our_little_machine, char *src) {
-    printf("Compiling:\n%s\n\n", src);
-    firth_compilation_result *compilation_result = firth_compile(src);
+int repl_load_firth(lmsm *our_little_machine, char *file, char *src) {
+    if (!repl_quiet) {
+        printf("Compiling:\n%s\n\n", src);
+    }
+    // the code is built directly, the assembly is only generated to be shown
+    int options = FIRTH_ASSEMBLE | (repl_quiet ? 0 : FIRTH_EMIT_ASSEMBLY);
+    firth_compilation_result *compilation_result = firth_compile_with_options(src, options, ASM_SOURCE_MAP);
     if (compilation_result->error) {
         printf("Compilation Error:\n%s\n\n", compilation_result->error);
+        firth_delete_compilation_result(compilation_result);
         return 0;
     }
-    printf("Assembly:\n%s\n\n", compilation_result->lmsm_assembly);
-    asm_compilation_result *result = asm_assemble(compilation_result->lmsm_assembly);
-    if (result->error) {
+    if (!repl_quiet) {
+        printf("Assembly:\n%s\n\n", compilation_result->lmsm_assembly);
+    }
+    asm_compilation_result *result = compilation_result->assembled;
+    int ok = result->error == NULL;
+    if (!ok) {
         printf("Assembly Error:\n%s\n\n", result->error);
-        return 0;
     } else {
         lmsm_reset(our_little_machine);
         lmsm_load(our_little_machine, result->code, 100);
-        return 1;
+        lmsm_overlays_detach(our_little_machine);
+        repl_remember_srcmap(file, result, compilation_result);
+        repl_forget_incremental();
     }
+    firth_delete_compilation_result(compilation_result);
+    return ok;
+}
+
+int repl_comp_firth(lmsm *our_little_machine, char *filename) {
+    lmsm_source source;
+    if (!repl_open_source(&source, filename)) {
+        return 0;
+    }
+    int ok = repl_load_firth(our_little_machine, filename, source.text);
+    lmsm_source_close(&source);
+    return ok;
 }
 
 
@@ -147,6 +253,22 @@ void repl_print_to_buffer(lmsm *our_little_machine, char* output) {
     sprintf(output + offset, "Output: %s\n", our_little_machine->output_buffer);
 }
 
+// reads the slot after a command, returns 0 if it is missing or not an address
+int repl_parse_slot(char *line, int *location) {
+    strtok(line, " ");  // the command
+    char *slot = strtok(NULL, " ");
+    if (slot == NULL) {
+        return 0;
+    }
+    char *end;
+    long value = strtol(slot, &end, 10);
+    if (*end != '\0' || value < 0 || value > TOP_OF_MEMORY) {
+        return 0;
+    }
+    *location = (int) value;
+    return 1;
+}
+
 void repl_process_command(lmsm *our_little_machine, char *line) {
     line[strlen(line) - 1] = '\0'; // nuke newline char
     if (strcmp("x", line) == 0 || strcmp(line, "exit") == 0) {
@@ -156,12 +278,22 @@ void repl_process_command(lmsm *our_little_machine, char *line) {
         printf("LMSM Commands:\n");
         printf("  e[x]it - exits the emulator\n");
         printf("  help or ? - prints this message\n");
-        printf("  [l]oad <file_name> - loads a new program into the LMSM from a file\n");
+        printf("  [l]oad <file_name> - loads a new program into the LMSM from a file, or an image and its overlays\n");
+        printf("  patch <file_name> - re-assembles an edited file and writes only the changed words into memory, without a reset\n");
         printf("  [c]omp <file_name> - compiles a Firth file into LMSM assembly, then loads it into memory\n");
         printf("  [s]tep - executes one step in the LMSM\n");
         printf("  [r]un  - runs the current program\n");
+        printf("  [b]reak <slot>  - toggles a breakpoint on the given slot\n");
+        printf("  watch <slot>  - toggles a watchpoint on writes to the given slot\n");
+        printf("  [u]ntil  - runs the current program until it halts or hits a breakpoint/watchpoint\n");
+        printf("  rstep or rs  - steps backwards one instruction\n");
+        printf("  rcontinue or rc  - runs backwards until a breakpoint/watchpoint or the start of the run\n");
+        printf("  seek <step>  - moves the LMSM to the given step of the current run\n");
+        printf("  trace <file_name> or trace off - writes a binary trace of every step to a file\n");
         printf("  rese[t]  - resets the LMSM\n");
         printf("  [p]rint  - prints the state of the LMSM\n");
+        printf("  where  - prints the source line the program counter is in\n");
+        printf("  quiet  - toggles echoing sources and generated assembly as they are loaded\n");
         printf("  [w]rite <num> <slot>  - saves the number in the given slot\n");
         printf("  [e]xec <num> - executes the raw asm_instruction\n");
         printf("  <any LMSM asm_instruction>  - executes a single asm_instruction (no label support)\n\n");
@@ -174,6 +306,8 @@ void repl_process_command(lmsm *our_little_machine, char *line) {
         char fileName[100] = {0};
         strncat(fileName, line + 2, 100);
         repl_load_file(our_little_machine, fileName);
+    } else if (strncmp("patch ", line, strlen("patch ")) == 0) {
+        repl_patch_file(our_little_machine, line + strlen("patch "));
     } else if (strncmp("comp ", line, strlen("fout ")) == 0) {
         char fileName[100] = {0};
         strncat(fileName, line + 5, 100);
@@ -187,19 +321,23 @@ void repl_process_command(lmsm *our_little_machine, char *line) {
         char *num = strtok(NULL, " ");
         char *slot = strtok(NULL, " ");
         our_little_machine->memory[atoi(slot)] = atoi(num);
+        lmsm_history_rebase(our_little_machine);
     } else if (strncmp("w ", line, strlen("w ")) == 0) {
         char *command = strtok(line, " ");
         char *num = strtok(NULL, " ");
         char *slot = strtok(NULL, " ");
         our_little_machine->memory[atoi(slot)] = atoi(num);
+        lmsm_history_rebase(our_little_machine);
     } else if (strncmp("exec ", line, strlen("exec ")) == 0) {
         char *command = strtok(line, " ");
         char *raw = strtok(NULL, " ");
         lmsm_exec_instruction(our_little_machine, atoi(raw));
+        lmsm_history_rebase(our_little_machine);
     } else if (strncmp("e ", line, strlen("e ")) == 0) {
         char *command = strtok(line, " ");
         char *raw = strtok(NULL, " ");
         lmsm_exec_instruction(our_little_machine, atoi(raw));
+        lmsm_history_rebase(our_little_machine);
     } else if (strcmp("p", line) == 0 || strcmp("print", line) == 0) {
         char output[5000] = {0};
         repl_print_to_buffer(our_little_machine, output);
@@ -214,12 +352,71 @@ void repl_process_command(lmsm *our_little_machine, char *line) {
         char output[5000] = {0};
         repl_print_to_buffer(our_little_machine, output);
         printf("%s", output);
+    } else if (strcmp("where", line) == 0) {
+        repl_print_location(our_little_machine);
+    } else if (strcmp("quiet", line) == 0) {
+        repl_quiet = !repl_quiet;
+        printf("Quiet mode %s\n", repl_quiet ? "on" : "off");
     } else if (strcmp("r", line) == 0 || strcmp("run", line) == 0) {
         printf("Running...\n\n");
         lmsm_run(our_little_machine);
+    } else if (strcmp("break", line) == 0 || strcmp("b", line) == 0 ||
+               strncmp("break ", line, strlen("break ")) == 0 || strncmp("b ", line, strlen("b ")) == 0) {
+        int location;
+        if (repl_parse_slot(line, &location)) {
+            int enabled = !lmsm_has_breakpoint(our_little_machine, location);
+            lmsm_set_breakpoint(our_little_machine, location, enabled);
+            printf("Breakpoint %s at %02d\n", enabled ? "set" : "cleared", location);
+        } else {
+            printf("Usage: break <slot>, where the slot is 0 to %d\n", TOP_OF_MEMORY);
+        }
+    } else if (strcmp("watch", line) == 0 || strncmp("watch ", line, strlen("watch ")) == 0) {
+        int location;
+        if (repl_parse_slot(line, &location)) {
+            int enabled = !lmsm_has_watchpoint(our_little_machine, location);
+            lmsm_set_watchpoint(our_little_machine, location, enabled);
+            printf("Watchpoint %s at %03d\n", enabled ? "set" : "cleared", location);
+        } else {
+            printf("Usage: watch <slot>, where the slot is 0 to %d\n", TOP_OF_MEMORY);
+        }
+    } else if (strcmp("u", line) == 0 || strcmp("until", line) == 0) {
+        if (lmsm_run_until_break(our_little_machine)) {
+            repl_print_location(our_little_machine);
+            char output[5000] = {0};
+            repl_print_to_buffer(our_little_machine, output);
+            printf("%s", output);
+        }
+    } else if (strcmp("rs", line) == 0 || strcmp("rstep", line) == 0) {
+        if (lmsm_history_reverse_step(our_little_machine)) {
+            char output[5000] = {0};
+            repl_print_to_buffer(our_little_machine, output);
+            printf("%s", output);
+        } else {
+            printf("At the start of the recorded history\n");
+        }
+    } else if (strcmp("rc", line) == 0 || strcmp("rcontinue", line) == 0) {
+        lmsm_history_reverse_continue(our_little_machine);
+        printf("Stopped at step %ld\n", our_little_machine->history ? our_little_machine->history->step : 0L);
+        char output[5000] = {0};
+        repl_print_to_buffer(our_little_machine, output);
+        printf("%s", output);
+    } else if (strncmp("seek ", line, strlen("seek ")) == 0) {
+        if (lmsm_history_seek(our_little_machine, atol(line + strlen("seek ")))) {
+            char output[5000] = {0};
+            repl_print_to_buffer(our_little_machine, output);
+            printf("%s", output);
+        } else {
+            printf("Step out of range\n");
+        }
+    } else if (strcmp("trace off", line) == 0) {
+        lmsm_trace_stop(our_little_machine);
+    } else if (strncmp("trace ", line, strlen("trace ")) == 0) {
+        if (!lmsm_trace_start(our_little_machine, line + strlen("trace "), 1)) {
+            printf("Unable to open trace file: '%s'\n", line + strlen("trace "));
+        }
     } else if (strncmp("f:", line, strlen("f:")) == 0) {
         printf("Loading Firth...\n\n");
-        repl_load_firth(our_little_machine, line + 2);
+        repl_load_firth(our_little_machine, "f:", line + 2);
     } else if (strcmp("\n", line) == 0) {
         printf("\n");
     } else if (strcmp("", line) == 0) {
@@ -248,6 +445,7 @@ void repl_process_command(lmsm *our_little_machine, char *line) {
 }
 
 void repl_start(lmsm *our_little_machine) {
+    lmsm_history_enable(our_little_machine, HISTORY_DEFAULT_CHECKPOINT_INTERVAL);
     while (1) {
         size_t buffer_size = 2000;
         char *line = calloc(sizeof(char), buffer_size);
@@ -9,6 +9,9 @@
 
 int repl_load_file(lmsm *our_little_machine, char *filename);
 
+// skips echoing sources and generated assembly as they are loaded
+void repl_set_quiet(int quiet);
+
 void repl_start(lmsm *our_little_machine);
 
 #endif //LMSM_REPL_H
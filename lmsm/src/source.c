@@ -0,0 +1,126 @@
+//
+// Reads source files for the toolchain without extra copies. Spans from
+// the lexer point into the text, so it is kept whole rather than handed
+// over a chunk at a time: files are read in one go, and on Linux large
+// ones are mapped so the lexer pages them in as it goes
+//
+
+#include "source.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// reads until the end of the file. when its size is known the buffer is allocated once
+// and filled by a single read, only pipes and files that grow while being read need more
+int lmsm_source_read(lmsm_source *source, FILE *file, size_t size) {
+    size_t capacity = size > 0 ? size : SOURCE_CHUNK_SIZE;
+    char *text = malloc(capacity + 1);
+    if (text == NULL) {
+        return 0;
+    }
+    size_t length = 0;
+    for (;;) {
+        length += fread(text + length, 1, capacity - length, file);
+        if (length < capacity) {
+            break;
+        }
+        int next = getc(file);  // a full buffer is usually the whole file
+        if (next == EOF) {
+            break;
+        }
+        capacity *= 2;
+        char *grown = realloc(text, capacity + 1);
+        if (grown == NULL) {
+            free(text);
+            return 0;
+        }
+        text = grown;
+        text[length++] = (char) next;
+    }
+    if (ferror(file)) {
+        free(text);
+        return 0;
+    }
+    text[length] = '\0';
+    source->text = text;
+    source->length = length;
+    source->mapping_size = 0;
+    return 1;
+}
+
+#ifdef __linux__
+
+// maps the file with at least one zeroed byte after it, which terminates the text
+int lmsm_source_map(lmsm_source *source, int fd, size_t length) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t size = (length + 1 + page - 1) / page * page;
+    char *text = mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (text == MAP_FAILED) {
+        return 0;
+    }
+    if (mmap(text, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(text, size);
+        return 0;
+    }
+    madvise(text, length, MADV_SEQUENTIAL);
+    source->text = text;
+    source->length = length;
+    source->mapping_size = size;
+    return 1;
+}
+
+// the size of a regular file, 0 for pipes and terminals
+size_t lmsm_source_size(FILE *file) {
+    struct stat info;
+    if (fstat(fileno(file), &info) == 0 && S_ISREG(info.st_mode)) {
+        return (size_t) info.st_size;
+    }
+    return 0;
+}
+
+#endif
+
+int lmsm_source_open(lmsm_source *source, const char *filename) {
+    int standard_input = strcmp(filename, "-") == 0;
+    FILE *file = standard_input ? stdin : fopen(filename, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    int ok = 0;
+#ifdef __linux__
+    size_t size = lmsm_source_size(file);
+    if (size >= SOURCE_MAP_THRESHOLD) {
+        ok = lmsm_source_map(source, fileno(file), size);
+    }
+#else
+    size_t size = 0;
+#endif
+    if (!ok) {
+        ok = lmsm_source_read(source, file, size);
+    }
+    if (!standard_input) {
+        fclose(file);
+    }
+    return ok;
+}
+
+void lmsm_source_close(lmsm_source *source) {
+#ifdef __linux__
+    if (source->mapping_size > 0) {
+        munmap(source->text, source->mapping_size);
+    } else {
+        free(source->text);
+    }
+#else
+    free(source->text);
+#endif
+    source->text = NULL;
+    source->length = 0;
+}
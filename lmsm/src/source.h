@@ -0,0 +1,35 @@
+//
+// Reads source files for the toolchain without extra copies. Spans from
+// the lexer point into the text, so it is kept whole rather than handed
+// over a chunk at a time: files are read in one go, and on Linux large
+// ones are mapped so the lexer pages them in as it goes
+//
+
+#ifndef LMSM_SOURCE_H
+#define LMSM_SOURCE_H
+
+#include <stddef.h>
+
+#define SOURCE_CHUNK_SIZE 4096             // the first read from a pipe
+#define SOURCE_MAP_THRESHOLD (64 * 1024)   // files at least this big are mapped, where mmap is available
+
+//===================================================================
+//  The text of a source file, always NUL terminated.  It must not
+//  be modified, since it may be a read-only mapping of the file
+//===================================================================
+typedef struct lmsm_source {
+    char *text;
+    size_t length;
+    size_t mapping_size;         // 0 if the text was read into the heap
+} lmsm_source;
+
+//===================================================================
+//  API
+//===================================================================
+
+// opens a file, or standard input for "-". returns 0 if it can't be read
+int lmsm_source_open(lmsm_source *source, const char *filename);
+
+void lmsm_source_close(lmsm_source *source);
+
+#endif //LMSM_SOURCE_H
@@ -0,0 +1,148 @@
+//
+// Source maps: where the code at each offset of an image came from
+//
+
+#include "srcmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LMSM_SRCMAP_VERSION 1
+
+lmsm_srcmap *lmsm_srcmap_create() {
+    return calloc(1, sizeof(lmsm_srcmap));
+}
+
+void lmsm_srcmap_delete(lmsm_srcmap *map) {
+    free(map);
+}
+
+//======================================================
+//  Building
+//======================================================
+
+void lmsm_srcmap_copy_element(firth_parse_element *element, char *buffer) {
+    lmsm_span *span = element->type == DEF && element->name ? &element->name->span : &element->token->span;
+    int length = span->length < SRCMAP_MAX_ELEMENT - 1 ? span->length : SRCMAP_MAX_ELEMENT - 1;
+    memcpy(buffer, span->start, length);
+    buffer[length] = '\0';
+}
+
+int lmsm_srcmap_add_assembly(lmsm_srcmap *map, char *file, asm_compilation_result *result,
+                             firth_compilation_result *firth_result) {
+    if (map->file_count == SRCMAP_MAX_FILES) {
+        return 0;
+    }
+    int index = map->file_count++;
+    snprintf(map->files[index], SRCMAP_MAX_FILE_NAME, "%s", file);
+    for (int i = 0; i < result->source_map_count && map->count < 100; ++i) {
+        asm_source_location *location = &result->source_map[i];
+        lmsm_srcmap_entry entry = {location->offset, location->slots, index, location->line, location->column, ""};
+        if (firth_result) {
+            // code the compiler adds itself, like the final HLT, has no Firth source
+            firth_parse_element *element = firth_origin_of_line(firth_result, location->line);
+            if (element == NULL) {
+                continue;
+            }
+            entry.line = element->token->span.line;
+            entry.column = element->token->span.column;
+            lmsm_srcmap_copy_element(element, entry.element);
+        }
+
+        // keep the entries sorted, results are almost always in order already
+        int at = map->count;
+        while (at > 0 && map->entries[at - 1].offset > entry.offset) {
+            map->entries[at] = map->entries[at - 1];
+            at--;
+        }
+        map->entries[at] = entry;
+        map->count++;
+    }
+    return 1;
+}
+
+//======================================================
+//  Lookup
+//======================================================
+
+lmsm_srcmap_entry *lmsm_srcmap_lookup(lmsm_srcmap *map, int offset) {
+    int low = 0, high = map->count - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        lmsm_srcmap_entry *entry = &map->entries[middle];
+        if (offset < entry->offset) {
+            high = middle - 1;
+        } else if (offset >= entry->offset + entry->size) {
+            low = middle + 1;
+        } else {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+void lmsm_srcmap_format(lmsm_srcmap *map, int offset, char *buffer, size_t size) {
+    lmsm_srcmap_entry *entry = map ? lmsm_srcmap_lookup(map, offset) : NULL;
+    if (entry == NULL) {
+        snprintf(buffer, size, "%s", "");
+    } else if (entry->element[0]) {
+        snprintf(buffer, size, "%s:%d:%d %s", map->files[entry->file], entry->line, entry->column, entry->element);
+    } else {
+        snprintf(buffer, size, "%s:%d:%d", map->files[entry->file], entry->line, entry->column);
+    }
+}
+
+//======================================================
+//  Sidecar Files
+//======================================================
+
+int lmsm_srcmap_write(lmsm_srcmap *map, char *filename) {
+    FILE *file = fopen(filename, "w");
+    if (file == NULL) {
+        return 0;
+    }
+    fprintf(file, "LMSM-MAP %d\nfiles %d\n", LMSM_SRCMAP_VERSION, map->file_count);
+    for (int i = 0; i < map->file_count; ++i) {
+        fprintf(file, "%s\n", map->files[i]);
+    }
+    fprintf(file, "entries %d\n", map->count);
+    for (int i = 0; i < map->count; ++i) {
+        lmsm_srcmap_entry *entry = &map->entries[i];
+        fprintf(file, "%d %d %d %d %d %s\n", entry->offset, entry->size, entry->file, entry->line, entry->column,
+                entry->element[0] ? entry->element : "-");
+    }
+    return fclose(file) == 0;
+}
+
+lmsm_srcmap *lmsm_srcmap_read(char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        return NULL;
+    }
+    lmsm_srcmap *map = lmsm_srcmap_create();
+    int version;
+    int ok = fscanf(file, "LMSM-MAP %d files %d ", &version, &map->file_count) == 2 &&
+             version == LMSM_SRCMAP_VERSION && map->file_count >= 0 && map->file_count <= SRCMAP_MAX_FILES;
+    for (int i = 0; ok && i < map->file_count; ++i) {
+        ok = fgets(map->files[i], SRCMAP_MAX_FILE_NAME, file) != NULL;
+        map->files[i][strcspn(map->files[i], "\n")] = '\0';
+    }
+    ok = ok && fscanf(file, " entries %d", &map->count) == 1 && map->count >= 0 && map->count <= 100;
+    for (int i = 0; ok && i < map->count; ++i) {
+        lmsm_srcmap_entry *entry = &map->entries[i];
+        ok = fscanf(file, " %d %d %d %d %d %15s", &entry->offset, &entry->size, &entry->file, &entry->line,
+                    &entry->column, entry->element) == 6 &&
+             entry->file >= 0 && entry->file < map->file_count &&
+             (i == 0 || entry->offset >= map->entries[i - 1].offset);
+        if (strcmp(entry->element, "-") == 0) {
+            entry->element[0] = '\0';
+        }
+    }
+    fclose(file);
+    if (!ok) {
+        lmsm_srcmap_delete(map);
+        return NULL;
+    }
+    return map;
+}
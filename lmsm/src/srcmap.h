@@ -0,0 +1,58 @@
+//
+// Source maps: where the code at each offset of an image came from
+//
+
+#ifndef LMSM_SRCMAP_H
+#define LMSM_SRCMAP_H
+
+#include "assembler.h"
+#include "firth.h"
+
+#define SRCMAP_MAX_FILES 8
+#define SRCMAP_MAX_FILE_NAME 256
+#define SRCMAP_MAX_ELEMENT 16
+
+//===================================================================
+//  A source map: one entry per instruction, sorted by offset, so
+//  the entry for any word is a binary search away
+//===================================================================
+typedef struct lmsm_srcmap_entry {
+    int offset;          // the first word of the instruction
+    int size;            // the words it covers
+    int file;            // an index into the map's files
+    int line;            // in the .asm or .firth source
+    int column;
+    char element[SRCMAP_MAX_ELEMENT];  // the Firth element it was generated for, "" for assembly
+} lmsm_srcmap_entry;
+
+typedef struct lmsm_srcmap {
+    char files[SRCMAP_MAX_FILES][SRCMAP_MAX_FILE_NAME];
+    int file_count;
+    lmsm_srcmap_entry entries[100];
+    int count;
+} lmsm_srcmap;
+
+//===================================================================
+//  API
+//===================================================================
+
+lmsm_srcmap *lmsm_srcmap_create();
+void lmsm_srcmap_delete(lmsm_srcmap *map);
+
+// adds the instructions of a result assembled with ASM_SOURCE_MAP. when the assembly was
+// compiled from Firth, pass the compilation so entries point at the Firth source instead.
+// returns 0 if the map has no room for another file
+int lmsm_srcmap_add_assembly(lmsm_srcmap *map, char *file, asm_compilation_result *result,
+                             firth_compilation_result *firth_result);
+
+// the entry covering offset, or NULL
+lmsm_srcmap_entry *lmsm_srcmap_lookup(lmsm_srcmap *map, int offset);
+
+// "file:line:column element" for offset into buffer, or "" if the offset isn't mapped
+void lmsm_srcmap_format(lmsm_srcmap *map, int offset, char *buffer, size_t size);
+
+// the sidecar format written next to an image, returns 0/NULL if it can't be written or read
+int lmsm_srcmap_write(lmsm_srcmap *map, char *filename);
+lmsm_srcmap *lmsm_srcmap_read(char *filename);
+
+#endif //LMSM_SRCMAP_H
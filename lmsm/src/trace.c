@@ -0,0 +1,404 @@
+//
+// Compact binary execution traces for the LMSM
+//
+
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_SCRATCH_SIZE (TRACE_BLOCK_SIZE + TRACE_BLOCK_SIZE / 128 + 16)
+#define TRACE_HASH_BITS 12
+#define TRACE_MIN_MATCH 4
+#define TRACE_MAX_MATCH (127 + TRACE_MIN_MATCH)
+#define TRACE_MAX_LITERALS 128
+
+//======================================================
+//  Encoding Utilities
+//======================================================
+
+unsigned int lmsm_trace_zigzag(int value) {
+    return ((unsigned int) value << 1) ^ (unsigned int) (value >> 31);
+}
+
+int lmsm_trace_unzigzag(unsigned int value) {
+    return (int) (value >> 1) ^ -(int) (value & 1);
+}
+
+int lmsm_trace_put_varint(unsigned char *dest, unsigned int value) {
+    int length = 0;
+    while (value >= 0x80) {
+        dest[length++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    dest[length++] = (unsigned char) value;
+    return length;
+}
+
+int lmsm_trace_get_varint(lmsm_trace_reader *reader, unsigned int *value) {
+    unsigned int result = 0;
+    int shift = 0;
+    while (reader->position < reader->length && shift < 35) {
+        unsigned char byte = reader->block[reader->position++];
+        result |= (unsigned int) (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return 1;
+        }
+        shift += 7;
+    }
+    return 0;
+}
+
+void lmsm_trace_put_u32(unsigned char *dest, unsigned int value) {
+    dest[0] = (unsigned char) value;
+    dest[1] = (unsigned char) (value >> 8);
+    dest[2] = (unsigned char) (value >> 16);
+    dest[3] = (unsigned char) (value >> 24);
+}
+
+unsigned int lmsm_trace_get_u32(const unsigned char *src) {
+    return (unsigned int) src[0] | ((unsigned int) src[1] << 8) | ((unsigned int) src[2] << 16) | ((unsigned int) src[3] << 24);
+}
+
+void lmsm_trace_reset_state(lmsm_trace_state *state) {
+    state->program_counter = -1;
+    state->accumulator = 0;
+    state->stack_pointer = TOP_OF_MEMORY + 1;
+    state->return_address_pointer = TOP_OF_MEMORY - 100;
+}
+
+//======================================================
+//  LZ Block Compression
+//
+//  A control byte below 0x80 starts a run of (byte + 1) literals,
+//  otherwise it is a match of ((byte & 0x7f) + 4) bytes followed by
+//  a two byte little endian offset back into the output.
+//======================================================
+
+unsigned int lmsm_trace_hash(const unsigned char *src) {
+    unsigned int word = (unsigned int) src[0] | ((unsigned int) src[1] << 8) | ((unsigned int) src[2] << 16) | ((unsigned int) src[3] << 24);
+    return (word * 2654435761u) >> (32 - TRACE_HASH_BITS);
+}
+
+int lmsm_trace_flush_literals(const unsigned char *src, int start, int end, unsigned char *dest, int out) {
+    while (start < end) {
+        int run = end - start;
+        if (run > TRACE_MAX_LITERALS) {
+            run = TRACE_MAX_LITERALS;
+        }
+        dest[out++] = (unsigned char) (run - 1);
+        memcpy(dest + out, src + start, run);
+        out += run;
+        start += run;
+    }
+    return out;
+}
+
+int lmsm_trace_compress(const unsigned char *src, int length, unsigned char *dest) {
+    int table[1 << TRACE_HASH_BITS];
+    for (int i = 0; i < (1 << TRACE_HASH_BITS); ++i) {
+        table[i] = -1;
+    }
+
+    int out = 0;
+    int literal_start = 0;
+    int position = 0;
+    while (position + TRACE_MIN_MATCH <= length) {
+        unsigned int hash = lmsm_trace_hash(src + position);
+        int candidate = table[hash];
+        table[hash] = position;
+        if (candidate >= 0 && position - candidate <= 0xffff &&
+            memcmp(src + candidate, src + position, TRACE_MIN_MATCH) == 0) {
+            int match = TRACE_MIN_MATCH;
+            while (position + match < length && match < TRACE_MAX_MATCH &&
+                   src[candidate + match] == src[position + match]) {
+                match++;
+            }
+            out = lmsm_trace_flush_literals(src, literal_start, position, dest, out);
+            int offset = position - candidate;
+            dest[out++] = (unsigned char) (0x80 | (match - TRACE_MIN_MATCH));
+            dest[out++] = (unsigned char) offset;
+            dest[out++] = (unsigned char) (offset >> 8);
+            position += match;
+            literal_start = position;
+        } else {
+            position++;
+        }
+    }
+    return lmsm_trace_flush_literals(src, literal_start, length, dest, out);
+}
+
+int lmsm_trace_decompress(const unsigned char *src, int length, unsigned char *dest, int capacity) {
+    int in = 0;
+    int out = 0;
+    while (in < length) {
+        unsigned char control = src[in++];
+        if (control < 0x80) {
+            int run = control + 1;
+            if (in + run > length || out + run > capacity) {
+                return -1;
+            }
+            memcpy(dest + out, src + in, run);
+            in += run;
+            out += run;
+        } else {
+            int match = (control & 0x7f) + TRACE_MIN_MATCH;
+            if (in + 2 > length) {
+                return -1;
+            }
+            int offset = src[in] | (src[in + 1] << 8);
+            in += 2;
+            if (offset == 0 || offset > out || out + match > capacity) {
+                return -1;
+            }
+            // byte by byte, since matches may overlap their own output
+            for (int i = 0; i < match; ++i) {
+                dest[out] = dest[out - offset];
+                out++;
+            }
+        }
+    }
+    return out;
+}
+
+//======================================================
+//  Writer
+//======================================================
+
+void lmsm_trace_flush_block(lmsm_trace_writer *writer) {
+    if (writer->length == 0) {
+        return;
+    }
+    unsigned char header[8];
+    const unsigned char *stored = writer->block;
+    int stored_length = writer->length;
+    if (writer->compress) {
+        int compressed_length = lmsm_trace_compress(writer->block, writer->length, writer->scratch);
+        if (compressed_length < writer->length) {
+            stored = writer->scratch;
+            stored_length = compressed_length;
+        }
+    }
+    lmsm_trace_put_u32(header, (unsigned int) writer->length);
+    lmsm_trace_put_u32(header + 4, (unsigned int) stored_length);
+    fwrite(header, 1, sizeof(header), writer->file);
+    fwrite(stored, 1, stored_length, writer->file);
+    writer->length = 0;
+    lmsm_trace_reset_state(&writer->state);
+}
+
+int lmsm_trace_start(lmsm *our_little_machine, char *filename, int compress) {
+    lmsm_trace_stop(our_little_machine);
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        return 0;
+    }
+    lmsm_trace_writer *writer = calloc(1, sizeof(lmsm_trace_writer));
+    writer->file = file;
+    writer->compress = compress;
+    if (compress) {
+        writer->scratch = malloc(TRACE_SCRATCH_SIZE);
+    }
+    lmsm_trace_reset_state(&writer->state);
+
+    unsigned char header[6] = {'L', 'M', 'T', 'R', TRACE_VERSION, 0};
+    fwrite(header, 1, sizeof(header), file);
+
+    our_little_machine->trace = writer;
+    return 1;
+}
+
+void lmsm_trace_stop(lmsm *our_little_machine) {
+    lmsm_trace_writer *writer = our_little_machine->trace;
+    if (writer == NULL) {
+        return;
+    }
+    lmsm_trace_flush_block(writer);
+    fclose(writer->file);
+    free(writer->scratch);
+    free(writer);
+    our_little_machine->trace = NULL;
+}
+
+void lmsm_trace_before_step(lmsm *our_little_machine, int instruction) {
+    lmsm_trace_writer *writer = our_little_machine->trace;
+    writer->program_counter = our_little_machine->program_counter;
+    writer->instruction = instruction;
+    writer->write_count = lmsm_instruction_writes(our_little_machine, instruction, writer->addresses);
+}
+
+void lmsm_trace_after_step(lmsm *our_little_machine) {
+    lmsm_trace_writer *writer = our_little_machine->trace;
+    if (writer->length + TRACE_MAX_RECORD_SIZE > TRACE_BLOCK_SIZE) {
+        lmsm_trace_flush_block(writer);
+    }
+    lmsm_trace_state *state = &writer->state;
+    unsigned char *record = writer->block + writer->length;
+    int length = 1;
+    unsigned char flags = 0;
+
+    if (writer->program_counter != state->program_counter + 1) {
+        flags |= TRACE_PC;
+        length += lmsm_trace_put_varint(record + length, (unsigned int) writer->program_counter);
+    }
+    length += lmsm_trace_put_varint(record + length, lmsm_trace_zigzag(writer->instruction));
+    if (our_little_machine->accumulator != state->accumulator) {
+        flags |= TRACE_ACC;
+        length += lmsm_trace_put_varint(record + length, lmsm_trace_zigzag(our_little_machine->accumulator - state->accumulator));
+    }
+    if (our_little_machine->stack_pointer != state->stack_pointer) {
+        flags |= TRACE_SP;
+        length += lmsm_trace_put_varint(record + length, lmsm_trace_zigzag(our_little_machine->stack_pointer - state->stack_pointer));
+    }
+    if (our_little_machine->return_address_pointer != state->return_address_pointer) {
+        flags |= TRACE_RAP;
+        length += lmsm_trace_put_varint(record + length, lmsm_trace_zigzag(our_little_machine->return_address_pointer - state->return_address_pointer));
+    }
+    for (int i = 0; i < writer->write_count; ++i) {
+        flags |= i == 0 ? TRACE_WRITE : TRACE_WRITE2;
+        length += lmsm_trace_put_varint(record + length, (unsigned int) writer->addresses[i]);
+        length += lmsm_trace_put_varint(record + length, lmsm_trace_zigzag(our_little_machine->memory[writer->addresses[i]]));
+    }
+    if (our_little_machine->status == STATUS_HALTED) {
+        flags |= TRACE_HALT;
+        length += lmsm_trace_put_varint(record + length, (unsigned int) our_little_machine->error_code);
+    }
+    record[0] = flags;
+    writer->length += length;
+    writer->steps++;
+
+    state->program_counter = writer->program_counter;
+    state->accumulator = our_little_machine->accumulator;
+    state->stack_pointer = our_little_machine->stack_pointer;
+    state->return_address_pointer = our_little_machine->return_address_pointer;
+}
+
+//======================================================
+//  Reader
+//======================================================
+
+lmsm_trace_reader *lmsm_trace_reader_open(char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    unsigned char header[6];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, TRACE_MAGIC, 4) != 0 || header[4] != TRACE_VERSION) {
+        fclose(file);
+        return NULL;
+    }
+    lmsm_trace_reader *reader = calloc(1, sizeof(lmsm_trace_reader));
+    reader->file = file;
+    reader->scratch = malloc(TRACE_SCRATCH_SIZE);
+    lmsm_trace_reset_state(&reader->state);
+    return reader;
+}
+
+// returns 1 if a block was loaded, 0 at end of file, -1 on a corrupt block
+int lmsm_trace_read_block(lmsm_trace_reader *reader) {
+    unsigned char header[8];
+    size_t read = fread(header, 1, sizeof(header), reader->file);
+    if (read == 0) {
+        return 0;
+    }
+    if (read != sizeof(header)) {
+        return -1;
+    }
+    unsigned int raw_length = lmsm_trace_get_u32(header);
+    unsigned int stored_length = lmsm_trace_get_u32(header + 4);
+    if (raw_length > TRACE_BLOCK_SIZE || stored_length > raw_length) {
+        return -1;
+    }
+    if (stored_length == raw_length) {
+        if (fread(reader->block, 1, raw_length, reader->file) != raw_length) {
+            return -1;
+        }
+    } else {
+        if (fread(reader->scratch, 1, stored_length, reader->file) != stored_length ||
+            lmsm_trace_decompress(reader->scratch, (int) stored_length, reader->block, TRACE_BLOCK_SIZE) != (int) raw_length) {
+            return -1;
+        }
+    }
+    reader->length = (int) raw_length;
+    reader->position = 0;
+    lmsm_trace_reset_state(&reader->state);
+    return 1;
+}
+
+int lmsm_trace_reader_next(lmsm_trace_reader *reader, lmsm_trace_record *record) {
+    if (reader->position >= reader->length) {
+        int status = lmsm_trace_read_block(reader);
+        if (status <= 0) {
+            return status;
+        }
+    }
+    lmsm_trace_state *state = &reader->state;
+    unsigned char flags = reader->block[reader->position++];
+    unsigned int value = 0;
+
+    memset(record, 0, sizeof(lmsm_trace_record));
+    record->step = reader->steps;
+    record->program_counter = state->program_counter + 1;
+    if (flags & TRACE_PC) {
+        if (!lmsm_trace_get_varint(reader, &value)) return -1;
+        record->program_counter = (int) value;
+    }
+    if (!lmsm_trace_get_varint(reader, &value)) return -1;
+    record->instruction = lmsm_trace_unzigzag(value);
+
+    record->accumulator = state->accumulator;
+    if (flags & TRACE_ACC) {
+        if (!lmsm_trace_get_varint(reader, &value)) return -1;
+        record->accumulator += lmsm_trace_unzigzag(value);
+    }
+    record->stack_pointer = state->stack_pointer;
+    if (flags & TRACE_SP) {
+        if (!lmsm_trace_get_varint(reader, &value)) return -1;
+        record->stack_pointer += lmsm_trace_unzigzag(value);
+    }
+    record->return_address_pointer = state->return_address_pointer;
+    if (flags & TRACE_RAP) {
+        if (!lmsm_trace_get_varint(reader, &value)) return -1;
+        record->return_address_pointer += lmsm_trace_unzigzag(value);
+    }
+    record->write_count = (flags & TRACE_WRITE2) ? 2 : (flags & TRACE_WRITE) ? 1 : 0;
+    for (int i = 0; i < record->write_count; ++i) {
+        if (!lmsm_trace_get_varint(reader, &value)) return -1;
+        record->addresses[i] = (int) value;
+        if (!lmsm_trace_get_varint(reader, &value)) return -1;
+        record->values[i] = lmsm_trace_unzigzag(value);
+    }
+    if (flags & TRACE_HALT) {
+        if (!lmsm_trace_get_varint(reader, &value)) return -1;
+        record->halted = 1;
+        record->error_code = (int) value;
+    }
+
+    state->program_counter = record->program_counter;
+    state->accumulator = record->accumulator;
+    state->stack_pointer = record->stack_pointer;
+    state->return_address_pointer = record->return_address_pointer;
+    reader->steps++;
+    return 1;
+}
+
+void lmsm_trace_reader_close(lmsm_trace_reader *reader) {
+    fclose(reader->file);
+    free(reader->scratch);
+    free(reader);
+}
+
+int lmsm_trace_format_record(lmsm_trace_record *record, char *output) {
+    int offset = sprintf(output, "%08ld  pc: %02d  ins: %03d  acc: %03d  sp: %03d  rap: %03d",
+                         record->step, record->program_counter, record->instruction,
+                         record->accumulator, record->stack_pointer, record->return_address_pointer);
+    for (int i = 0; i < record->write_count; ++i) {
+        offset += sprintf(output + offset, "  [%03d] = %03d", record->addresses[i], record->values[i]);
+    }
+    if (record->halted) {
+        offset += sprintf(output + offset, "  HALT (error %d)", record->error_code);
+    }
+    return offset;
+}
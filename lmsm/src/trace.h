@@ -0,0 +1,117 @@
+//
+// Compact binary execution traces for the LMSM
+//
+
+#ifndef LMSM_TRACE_H
+#define LMSM_TRACE_H
+
+#include <stdio.h>
+#include "lmsm.h"
+
+//===================================================================
+//  File layout
+//
+//  header: "LMTR" <version byte> <reserved byte>
+//  blocks: <raw length u32> <stored length u32> <stored bytes>
+//
+//  A block is LZ compressed when its stored length is smaller than
+//  its raw length.  Delta state resets at the start of every block so
+//  blocks can be decoded independently.
+//
+//  Each record in a block is a flags byte followed by varints:
+//    [pc, if TRACE_PC]  instruction  [acc delta]  [sp delta]  [rap delta]
+//    [address, value] per memory write  [error code, if TRACE_HALT]
+//  Deltas and values are zigzag encoded.
+//===================================================================
+
+#define TRACE_MAGIC "LMTR"
+#define TRACE_VERSION 1
+#define TRACE_BLOCK_SIZE 65536
+#define TRACE_MAX_RECORD_SIZE 64
+
+#define TRACE_PC          0x01   // pc was not the previous pc + 1
+#define TRACE_ACC         0x02   // the accumulator changed
+#define TRACE_SP          0x04   // the stack pointer changed
+#define TRACE_RAP         0x08   // the return address pointer changed
+#define TRACE_WRITE       0x10   // one memory write follows
+#define TRACE_WRITE2      0x20   // a second memory write follows
+#define TRACE_HALT        0x40   // the machine halted on this step
+
+//===================================================================
+//  A decoded trace record
+//===================================================================
+typedef struct lmsm_trace_record {
+    long step;
+    int program_counter;         // the pc the instruction was fetched from
+    int instruction;
+    int accumulator;             // register values after the step
+    int stack_pointer;
+    int return_address_pointer;
+    int write_count;
+    int addresses[2];
+    int values[2];               // values written to memory
+    int halted;
+    int error_code;
+} lmsm_trace_record;
+
+//===================================================================
+//  Delta state shared by the writer and reader
+//===================================================================
+typedef struct lmsm_trace_state {
+    int program_counter;
+    int accumulator;
+    int stack_pointer;
+    int return_address_pointer;
+} lmsm_trace_state;
+
+typedef struct lmsm_trace_writer {
+    FILE *file;
+    int compress;
+    lmsm_trace_state state;
+    unsigned char block[TRACE_BLOCK_SIZE];
+    int length;
+    unsigned char *scratch;      // compression output
+    long steps;
+
+    // captured before each step
+    int program_counter;
+    int instruction;
+    int write_count;
+    int addresses[2];
+} lmsm_trace_writer;
+
+typedef struct lmsm_trace_reader {
+    FILE *file;
+    lmsm_trace_state state;
+    unsigned char block[TRACE_BLOCK_SIZE];
+    int length;
+    int position;
+    unsigned char *scratch;      // compressed input
+    long steps;
+} lmsm_trace_reader;
+
+//===================================================================
+//  API
+//===================================================================
+
+// starts writing a trace of every step the machine takes to the given file
+int lmsm_trace_start(lmsm *our_little_machine, char *filename, int compress);
+
+// flushes and closes the trace, if any
+void lmsm_trace_stop(lmsm *our_little_machine);
+
+// called by lmsm_step around executing an instruction
+void lmsm_trace_before_step(lmsm *our_little_machine, int instruction);
+void lmsm_trace_after_step(lmsm *our_little_machine);
+
+// reading traces back
+lmsm_trace_reader *lmsm_trace_reader_open(char *filename);
+int lmsm_trace_reader_next(lmsm_trace_reader *reader, lmsm_trace_record *record); // 1 record, 0 end, -1 corrupt
+void lmsm_trace_reader_close(lmsm_trace_reader *reader);
+int lmsm_trace_format_record(lmsm_trace_record *record, char *output);
+
+// LZ block compression, exposed for testing
+int lmsm_trace_compress(const unsigned char *src, int length, unsigned char *dest);
+int lmsm_trace_decompress(const unsigned char *src, int length, unsigned char *dest, int capacity);
+
+#endif //LMSM_TRACE_H
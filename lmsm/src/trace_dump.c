@@ -0,0 +1,106 @@
+//
+// Converts a binary LMSM execution trace to text
+//
+
+#include "trace.h"
+#include "srcmap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// prints the steps spent on each source location, the hottest first
+void trace_dump_profile(lmsm_srcmap *map, long steps[100], long total) {
+    // an element compiled to several instructions is counted once, on its first entry
+    for (int i = 0; i < map->count; ++i) {
+        for (int j = 0; j < i; ++j) {
+            lmsm_srcmap_entry *a = &map->entries[i], *b = &map->entries[j];
+            if (a->file == b->file && a->line == b->line && a->column == b->column &&
+                strcmp(a->element, b->element) == 0) {
+                steps[j] += steps[i];
+                steps[i] = 0;
+                break;
+            }
+        }
+    }
+    int order[100];
+    for (int i = 0; i < map->count; ++i) {
+        int at = i;
+        while (at > 0 && steps[order[at - 1]] < steps[i]) {
+            order[at] = order[at - 1];
+            at--;
+        }
+        order[at] = i;
+    }
+    printf("%8s %6s  %s\n", "steps", "%", "source");
+    for (int i = 0; i < map->count && steps[order[i]] > 0; ++i) {
+        char location[SRCMAP_MAX_FILE_NAME + 64];
+        lmsm_srcmap_format(map, map->entries[order[i]].offset, location, sizeof(location));
+        printf("%8ld %5.1f%%  %s\n", steps[order[i]], 100.0 * steps[order[i]] / total, location);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    char *trace_file = NULL;
+    char *map_file = NULL;
+    int profile = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+            map_file = argv[++i];
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            profile = 1;
+        } else if (trace_file == NULL && argv[i][0] != '-') {
+            trace_file = argv[i];
+        } else {
+            trace_file = NULL;
+            break;
+        }
+    }
+    if (trace_file == NULL || (profile && map_file == NULL)) {
+        printf("Usage: lmsm_trace [--map <image.map> [--profile]] <trace file>\n");
+        return EXIT_FAILURE;
+    }
+    lmsm_srcmap *map = NULL;
+    if (map_file && (map = lmsm_srcmap_read(map_file)) == NULL) {
+        printf("Not an LMSM source map: '%s'\n", map_file);
+        return EXIT_FAILURE;
+    }
+    lmsm_trace_reader *reader = lmsm_trace_reader_open(trace_file);
+    if (reader == NULL) {
+        printf("Not an LMSM trace: '%s'\n", trace_file);
+        lmsm_srcmap_delete(map);
+        return EXIT_FAILURE;
+    }
+    lmsm_trace_record record;
+    char line[256];
+    char location[SRCMAP_MAX_FILE_NAME + 64];
+    long steps[100] = {0};
+    long total = 0;
+    int status;
+    while ((status = lmsm_trace_reader_next(reader, &record)) == 1) {
+        if (profile) {
+            lmsm_srcmap_entry *entry = lmsm_srcmap_lookup(map, record.program_counter);
+            if (entry) {
+                steps[entry - map->entries]++;
+            }
+            total++;
+            continue;
+        }
+        lmsm_trace_format_record(&record, line);
+        lmsm_srcmap_format(map, record.program_counter, location, sizeof(location));
+        if (location[0]) {
+            printf("%s  ; %s\n", line, location);
+        } else {
+            printf("%s\n", line);
+        }
+    }
+    if (status < 0) {
+        printf("Corrupt trace after step %ld\n", reader->steps);
+    } else if (profile) {
+        trace_dump_profile(map, steps, total);
+    }
+    lmsm_trace_reader_close(reader);
+    if (map) {
+        lmsm_srcmap_delete(map);
+    }
+    return status < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
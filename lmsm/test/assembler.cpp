@@ -1,6 +1,11 @@
 #include "gtest/gtest.h"
 extern "C" {
 #include "assembler.h"
+#include "lexer.h"
+#include "history.h"
+#include "linker.h"
+#include "source.h"
+#include "srcmap.h"
 }
 
 //==========================================================================
@@ -32,6 +37,23 @@ TEST(instruction_construction, make_instruction_call_takes_three_slots) {
     asm_delete_instruction(instruction);
 }
 
+TEST(instruction_construction, make_instruction_resolves_the_opcode) {
+    asm_instruction *instruction = asm_make_instruction("SDROP", NULL, NULL, 0, NULL);
+    ASSERT_EQ(instruction->opcode, ASM_SDROP);
+    asm_delete_instruction(instruction);
+}
+
+TEST(instruction_construction, every_mnemonic_has_a_unique_opcode) {
+    for (int opcode = 0; opcode < ASM_UNKNOWN; ++opcode) {
+        ASSERT_EQ(asm_lookup_opcode(ASM_OPCODES[opcode].mnemonic), opcode);
+    }
+    ASSERT_EQ(asm_lookup_opcode("HLD"), ASM_UNKNOWN);
+    ASSERT_EQ(asm_lookup_opcode("add"), ASM_UNKNOWN);
+    ASSERT_EQ(asm_lookup_opcode("SPUSHIX"), ASM_UNKNOWN);
+    ASSERT_EQ(asm_lookup_opcode("X"), ASM_UNKNOWN);
+    ASSERT_EQ(asm_lookup_opcode(""), ASM_UNKNOWN);
+}
+
 TEST(instruction_construction, make_instruction_properly_offsets_based_on_preceding_instruction) {
     asm_instruction *next_instruction;
     asm_instruction *instruction;
@@ -142,6 +164,50 @@ TEST(parsing_tests, negative_numbers_out_of_machine_range_are_capped_properly) {
     asm_delete_compilation_result(result);
 }
 
+TEST(parsing_tests, comments_are_skipped) {
+    asm_compilation_result *result = asm_assemble("; ADD ONE\n"
+                                                  "INP ; read\n"
+                                                  "ADD ONE -- add one\n"
+                                                  "OUT;print\n"
+                                                  "HLT\n"
+                                                  "ONE DAT 1");
+    ASSERT_EQ(result->error, nullptr);
+    ASSERT_EQ(result->code[0], 901);
+    ASSERT_EQ(result->code[1], 104);
+    ASSERT_EQ(result->code[2], 902);
+    asm_delete_compilation_result(result);
+}
+
+TEST(parsing_tests, lexer_reports_positions_without_touching_the_source) {
+    const char *src = "LOOP  OUT\n\tBRA LOOP";
+    lmsm_lexer lexer;
+    lmsm_span span;
+    lmsm_lexer_init(&lexer, src);
+    ASSERT_TRUE(lmsm_lexer_next(&lexer, &span));
+    ASSERT_TRUE(lmsm_span_equals(&span, "LOOP"));
+    ASSERT_TRUE(lmsm_lexer_next(&lexer, &span));
+    ASSERT_EQ(span.start, src + 6);
+    ASSERT_EQ(span.column, 7);
+    ASSERT_TRUE(lmsm_lexer_next(&lexer, &span));
+    ASSERT_TRUE(lmsm_span_equals(&span, "BRA"));
+    ASSERT_EQ(span.line, 2);
+    ASSERT_EQ(span.column, 2);
+    ASSERT_TRUE(lmsm_lexer_next(&lexer, &span));
+    ASSERT_EQ(span.length, 4);
+    ASSERT_FALSE(lmsm_lexer_next(&lexer, &span));
+}
+
+TEST(parsing_tests, programs_larger_than_memory_cause_error) {
+    char src[1000] = "";
+    for (int i = 0; i < 99; ++i) {
+        strcat(src, "OUT\n");
+    }
+    strcat(src, "CALL 0\n");
+    asm_compilation_result *result = asm_assemble(src);
+    ASSERT_EQ(result->error, ASM_ERROR_PROGRAM_TOO_LARGE);
+    asm_delete_compilation_result(result);
+}
+
 //==========================================================================
 // Code generation tests
 //==========================================================================
@@ -525,6 +591,414 @@ TEST(code_generation, bad_label_causes_error) {
     asm_delete_compilation_result(result);
 }
 
+TEST(code_generation, long_programs_are_torn_down_without_recursion) {
+    asm_instruction *root = asm_make_instruction("OUT", NULL, NULL, 0, NULL);
+    asm_instruction *last = root;
+    for (int i = 0; i < 1000000; ++i) {
+        last = asm_make_instruction("OUT", NULL, NULL, 0, last);
+    }
+    asm_delete_instruction(root);
+}
+
+TEST(code_generation, builder_rejects_a_second_label_like_the_parser) {
+    const char *src = "B\nA\nSMAX";
+    asm_compilation_result *parsed = asm_assemble((char *) src);
+    ASSERT_STREQ(parsed->error, ASM_ERROR_UNKNOWN_INSTRUCTION);
+
+    asm_builder builder;
+    asm_builder_begin(&builder, ASM_OPTIMIZE);
+    lmsm_span b = {src, 1, 1, 1}, a = {src + 2, 1, 2, 1}, smax = {src + 4, 4, 3, 1};
+    ASSERT_TRUE(asm_builder_label(&builder, &b));
+    ASSERT_FALSE(asm_builder_label(&builder, &a));
+    ASSERT_FALSE(asm_builder_instruction(&builder, ASM_SMAX, NULL, &smax));
+    asm_compilation_result *built = asm_builder_finish(&builder);
+    ASSERT_STREQ(built->error, parsed->error);
+    ASSERT_EQ(built->error_line, parsed->error_line);
+    ASSERT_EQ(built->error_column, parsed->error_column);
+    asm_delete_compilation_result(built);
+    asm_delete_compilation_result(parsed);
+}
+
+TEST(code_generation, arena_holds_parsed_instructions) {
+    asm_compilation_result *result = asm_assemble("LOOP OUT\n"
+                                                  "     BRA LOOP");
+    ASSERT_EQ(result->arena_owns_instructions, 1);
+    ASSERT_EQ(result->code[1], 600);
+    asm_delete_compilation_result(result);
+}
+
+TEST(code_generation, context_reports_where_errors_occurred) {
+    asm_context *context = asm_context_create();
+    ASSERT_TRUE(asm_context_assemble(context, "OUT"));
+    ASSERT_EQ(context->result->code[0], 902);
+    ASSERT_FALSE(asm_context_assemble(context, "OUT\n  LDA FOO"));
+    ASSERT_EQ(context->result->error, ASM_ERROR_BAD_LABEL);
+    ASSERT_STREQ(context->message, "Bad Label at line 2, column 7");
+    asm_context_delete(context);
+}
+
+TEST(code_generation, forward_references_are_backpatched_in_one_pass) {
+    asm_compilation_result *result = asm_assemble_with_options("      BRA END\n"
+                                                               "      CALL FN\n"
+                                                               "END   HLT\n"
+                                                               "FN    LDA END\n"
+                                                               "      RET", 0);
+    ASSERT_EQ(result->error, nullptr);
+    ASSERT_EQ(result->root, nullptr);
+    ASSERT_EQ(result->code[0], 604);
+    ASSERT_EQ(result->code[1], 405);
+    ASSERT_EQ(result->code[2], 920);
+    ASSERT_EQ(result->code[3], 910);
+    ASSERT_EQ(result->code[5], 504);
+    asm_delete_compilation_result(result);
+}
+
+TEST(code_generation, duplicate_label_causes_error) {
+    asm_compilation_result *result = asm_assemble("FOO LDA BAR\n"
+                                                  "FOO OUT\n"
+                                                  "BAR DAT 1");
+    ASSERT_EQ(result->error, ASM_ERROR_DUPLICATE_LABEL);
+    asm_delete_compilation_result(result);
+}
+
+TEST(code_generation, labels_are_interned_in_the_symbol_table) {
+    asm_compilation_result *result = asm_assemble("LOOP LDA X\n"
+                                                  "     BRA LOOP\n"
+                                                  "X    DAT 1");
+    ASSERT_EQ(result->error, nullptr);
+    asm_symbol *loop = asm_find_symbol(result->symbols, "LOOP");
+    ASSERT_EQ(loop->offset, 0);
+    ASSERT_EQ(result->root->label, loop->name);
+    ASSERT_EQ(result->root->next->label_reference, loop->name);
+    ASSERT_EQ(asm_find_symbol(result->symbols, "X")->offset, 2);
+    ASSERT_EQ(asm_find_symbol(result->symbols, "Y"), nullptr);
+    asm_delete_compilation_result(result);
+}
+
+TEST(code_generation, symbol_table_grows) {
+    lmsm_arena *arena = lmsm_arena_create();
+    asm_symbol_table *table = asm_make_symbol_table(arena);
+    char name[16];
+    for (int i = 0; i < 1000; ++i) {
+        sprintf(name, "L%d", i);
+        asm_intern_symbol(table, name)->offset = i;
+    }
+    ASSERT_EQ(table->count, 1000);
+    for (int i = 0; i < 1000; ++i) {
+        sprintf(name, "L%d", i);
+        ASSERT_EQ(asm_find_symbol(table, name)->offset, i);
+    }
+    lmsm_arena_delete(arena);
+}
+
+TEST(code_generation, incremental_update_only_relexes_changed_lines) {
+    asm_incremental *incremental = asm_incremental_create();
+    ASSERT_TRUE(asm_incremental_update(incremental, "LOOP LDA X\n"
+                                                     "     OUT\n"
+                                                     "     BRA LOOP\n"
+                                                     "X    DAT 1"));
+    ASSERT_EQ(incremental->relexed_lines, 4);
+    ASSERT_EQ(incremental->result->code[0], 503);
+
+    ASSERT_TRUE(asm_incremental_update(incremental, "LOOP LDA X\n"
+                                                     "     SUB X\n"
+                                                     "     BRA LOOP\n"
+                                                     "X    DAT 1"));
+    ASSERT_EQ(incremental->relexed_lines, 1);
+    ASSERT_EQ(incremental->changed_count, 1);
+    ASSERT_EQ(incremental->changed[0], 1);
+    ASSERT_EQ(incremental->result->code[1], 203);
+    asm_incremental_delete(incremental);
+}
+
+TEST(code_generation, incremental_update_moves_labels_and_their_users) {
+    asm_incremental *incremental = asm_incremental_create();
+    ASSERT_TRUE(asm_incremental_update(incremental, "LOOP LDA X\n"
+                                                     "     BRA LOOP\n"
+                                                     "X    DAT 7"));
+    ASSERT_TRUE(asm_incremental_update(incremental, "LOOP LDA X\n"
+                                                     "     OUT\n"
+                                                     "     BRA LOOP\n"
+                                                     "X    DAT 7"));
+    ASSERT_EQ(incremental->relexed_lines, 1);
+    asm_compilation_result *full = asm_assemble("LOOP LDA X\n"
+                                                "     OUT\n"
+                                                "     BRA LOOP\n"
+                                                "X    DAT 7");
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(incremental->result->code[i], full->code[i]);
+    }
+    ASSERT_EQ(incremental->result->root->next->next->line, 3);
+
+    int memory[100] = {502, 600, 7};
+    asm_incremental_patch(incremental, memory);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(memory[i], full->code[i]);
+    }
+    asm_delete_compilation_result(full);
+    asm_incremental_delete(incremental);
+}
+
+TEST(code_generation, incremental_update_recovers_from_errors) {
+    asm_incremental *incremental = asm_incremental_create();
+    ASSERT_TRUE(asm_incremental_update(incremental, "LDA X\nX DAT 1"));
+    ASSERT_FALSE(asm_incremental_update(incremental, "LDA X\nY DAT 1"));
+    ASSERT_EQ(incremental->result->error, ASM_ERROR_BAD_LABEL);
+    ASSERT_EQ(incremental->result->code[0], 501);  // the last good image is kept
+    ASSERT_TRUE(asm_incremental_update(incremental, "LDA Y\nY DAT 1"));
+    ASSERT_EQ(incremental->relexed_lines, 1);
+    ASSERT_EQ(incremental->changed_count, 0);
+    asm_incremental_delete(incremental);
+}
+
+TEST(code_generation, incremental_update_rejects_two_labels_for_one_instruction) {
+    const char *srcs[] = {"HLT\nLOOP\nLOOP\nBRA LOOP", "B\nA\nSMAX"};
+    for (const char *src : srcs) {
+        asm_compilation_result *full = asm_assemble((char *) src);
+        asm_incremental *incremental = asm_incremental_create();
+        ASSERT_FALSE(asm_incremental_update(incremental, src));
+        ASSERT_STREQ(incremental->result->error, full->error);
+        ASSERT_EQ(incremental->result->error_line, full->error_line);
+        ASSERT_EQ(incremental->result->error_column, full->error_column);
+        asm_incremental_delete(incremental);
+        asm_delete_compilation_result(full);
+    }
+
+    // and not only when the labels arrive in the same update
+    asm_incremental *incremental = asm_incremental_create();
+    ASSERT_TRUE(asm_incremental_update(incremental, "HLT\nLOOP\nBRA LOOP"));
+    ASSERT_FALSE(asm_incremental_update(incremental, "HLT\nLOOP\nLOOP\nBRA LOOP"));
+    ASSERT_EQ(incremental->result->error, ASM_ERROR_UNKNOWN_INSTRUCTION);
+    asm_incremental_delete(incremental);
+}
+
+TEST(code_generation, relocatable_objects_record_relocations_and_imports) {
+    asm_compilation_result *result = asm_assemble_with_options("     CALL PRINT\n"
+                                                               "LOOP BRA LOOP", ASM_RELOCATABLE);
+    ASSERT_EQ(result->error, nullptr);
+    ASSERT_EQ(result->size, 4);
+    ASSERT_EQ(result->relocation_count, 1);
+    ASSERT_EQ(result->relocations[0], 3);
+    lmsm_object *object = lmsm_object_from_result("main", result);
+    ASSERT_EQ(object->export_count, 1);
+    ASSERT_STREQ(object->exports[0].name, "LOOP");
+    ASSERT_EQ(object->import_count, 1);
+    ASSERT_STREQ(object->imports[0].name, "PRINT");
+    ASSERT_EQ(object->imports[0].use_count, 1);
+    ASSERT_EQ(object->imports[0].uses[0], 0);
+    lmsm_object_delete(object);
+    asm_delete_compilation_result(result);
+}
+
+TEST(code_generation, linker_lays_out_used_modules_and_patches_them) {
+    char message[LMSM_LINK_MESSAGE_SIZE];
+    lmsm_object *objects[3];
+    objects[0] = lmsm_object_assemble("main", "     CALL PRINT\n"
+                                              "LOOP BRA LOOP", message, sizeof(message));
+    objects[1] = lmsm_object_assemble("unused", "LOOP HLT", message, sizeof(message));
+    objects[2] = lmsm_object_assemble("print", "PRINT OUT\n"
+                                               "      BRA PRINT", message, sizeof(message));
+    int code[100];
+    ASSERT_TRUE(lmsm_ld_link(objects, 3, code, message, sizeof(message)));
+    ASSERT_EQ(objects[1]->base, -1);
+    ASSERT_EQ(objects[2]->base, 4);
+    ASSERT_EQ(code[0], 404);   // LDI PRINT
+    ASSERT_EQ(code[3], 603);   // BRA LOOP
+    ASSERT_EQ(code[4], 902);
+    ASSERT_EQ(code[5], 604);   // BRA PRINT, relocated
+    ASSERT_EQ(code[6], 0);
+
+    ASSERT_FALSE(lmsm_ld_link(objects, 2, code, message, sizeof(message)));
+    ASSERT_STREQ(message, "Bad Label 'PRINT' imported by main");
+    for (int i = 0; i < 3; ++i) {
+        lmsm_object_delete(objects[i]);
+    }
+}
+
+TEST(code_generation, overlays_are_swapped_in_through_stubs_and_cached) {
+    char message[LMSM_LINK_MESSAGE_SIZE];
+    lmsm_object *objects[4];
+    objects[0] = lmsm_object_assemble("main", "SPUSHI 5\n"
+                                              "CALL DOUBLE\n"
+                                              "SPOP\n"
+                                              "OUT\n"
+                                              "SPUSHI 5\n"
+                                              "CALL TRIPLE\n"
+                                              "SPOP\n"
+                                              "OUT\n"
+                                              "SPUSHI 7\n"
+                                              "CALL TRIPLE\n"
+                                              "SPOP\n"
+                                              "OUT\n"
+                                              "HLT", message, sizeof(message));
+    objects[1] = lmsm_object_assemble("add", "PLUS SADD\n"
+                                             "     RET", message, sizeof(message));
+    objects[2] = lmsm_object_assemble("double", "DOUBLE SDUP\n"
+                                                "       SADD\n"
+                                                "       RET", message, sizeof(message));
+    objects[3] = lmsm_object_assemble("triple", "TRIPLE SDUP\n"
+                                                "       SDUP\n"
+                                                "       CALL PLUS\n"
+                                                "       CALL PLUS\n"
+                                                "       RET", message, sizeof(message));
+    objects[2]->overlay = 1;
+    objects[3]->overlay = 1;
+    int code[100];
+    lmsm_overlays *overlays = lmsm_overlays_create();
+    ASSERT_TRUE(lmsm_ld_link_overlays(objects, 4, code, overlays, message, sizeof(message)));
+    ASSERT_EQ(overlays->count, 2);
+    ASSERT_EQ(objects[1]->base, 22);
+    ASSERT_EQ(overlays->window, 30);   // after main, add and two stubs
+    ASSERT_EQ(overlays->window_size, 9);
+    ASSERT_EQ(code[2], 424);           // CALL DOUBLE goes through its stub
+    ASSERT_EQ(code[24], 400 + objects[2]->segment);
+    ASSERT_EQ(code[25], OVERLAY_INSTRUCTION);
+    ASSERT_EQ(code[26], 630);
+    ASSERT_EQ(overlays->segments[objects[3]->segment].code[2], 422);  // CALL PLUS, resident
+
+    lmsm *the_machine = lmsm_create();
+    lmsm_history_enable(the_machine, HISTORY_DEFAULT_CHECKPOINT_INTERVAL);
+    lmsm_load(the_machine, code, 100);
+    lmsm_overlays_attach(the_machine, overlays);
+    lmsm_run(the_machine);
+    ASSERT_EQ(the_machine->error_code, ERROR_NONE);
+    ASSERT_STREQ(the_machine->output_buffer, "10 15 21 ");
+    ASSERT_EQ(overlays->loads, 2);
+    ASSERT_EQ(overlays->hits, 1);
+    lmsm_delete(the_machine);
+
+    // TRIPLE calling DOUBLE would return into a window DOUBLE had replaced
+    lmsm_object_delete(objects[3]);
+    objects[3] = lmsm_object_assemble("triple", "TRIPLE CALL DOUBLE\n"
+                                                "       RET", message, sizeof(message));
+    objects[3]->overlay = 1;
+    overlays = lmsm_overlays_create();
+    ASSERT_FALSE(lmsm_ld_link_overlays(objects, 4, code, overlays, message, sizeof(message)));
+    ASSERT_STREQ(message, "Overlay triple calls 'DOUBLE' in overlay double, overlays may only call resident code");
+    lmsm_overlays_delete(overlays);
+    for (int i = 0; i < 4; ++i) {
+        lmsm_object_delete(objects[i]);
+    }
+}
+
+TEST(code_generation, optimizer_removes_redundant_stack_traffic) {
+    asm_compilation_result *result = asm_assemble_with_options("SPUSHI 5\n"
+                                                               "SPOP\n"
+                                                               "SPUSH\n"
+                                                               "SPOP\n"
+                                                               "OUT", ASM_OPTIMIZE);
+    ASSERT_EQ(result->error, nullptr);
+    ASSERT_EQ(result->size, 2);
+    ASSERT_EQ(result->code[0], 405);
+    ASSERT_EQ(result->code[1], 902);
+    asm_delete_compilation_result(result);
+}
+
+TEST(code_generation, optimizer_threads_branches_and_tail_calls) {
+    asm_compilation_result *result = asm_assemble_with_options("     CALL FN\n"
+                                                               "     HLT\n"
+                                                               "FN   SPOP\n"
+                                                               "     BRZ HOP\n"
+                                                               "     CALL FN\n"
+                                                               "     RET\n"
+                                                               "     OUT\n"  // unreachable
+                                                               "HOP  BRA DONE\n"
+                                                               "DONE RET", ASM_OPTIMIZE);
+    ASSERT_EQ(result->error, nullptr);
+    ASSERT_EQ(result->size, 8);
+    ASSERT_EQ(result->code[5], 707);   // BRZ DONE
+    ASSERT_EQ(result->code[6], 604);   // BRA FN
+    ASSERT_EQ(result->code[7], 911);
+    asm_delete_compilation_result(result);
+}
+
+TEST(code_generation, optimizer_leaves_position_dependent_code_alone) {
+    asm_compilation_result *result = asm_assemble_with_options("SPUSH\n"
+                                                               "SPOP\n"
+                                                               "BRA 0", ASM_OPTIMIZE);
+    ASSERT_EQ(result->error, nullptr);
+    ASSERT_EQ(result->code[0], 920);
+    ASSERT_EQ(result->code[2], 600);
+    asm_delete_compilation_result(result);
+}
+
+TEST(code_generation, large_sources_are_mapped_and_terminated) {
+    // exactly a whole number of pages, so the terminator can't come from the file's last page
+    std::string src = "LDI 7\nOUT\n";
+    src += std::string(SOURCE_MAP_THRESHOLD - src.size() - 1, ';') + "\n";
+    const char *filename = "large_source_test.asm";
+    FILE *file = fopen(filename, "w");
+    fwrite(src.data(), 1, src.size(), file);
+    fclose(file);
+
+    lmsm_source source;
+    ASSERT_TRUE(lmsm_source_open(&source, filename));
+    ASSERT_GT(source.mapping_size, 0u);
+    ASSERT_EQ(source.length, src.size());
+    ASSERT_EQ(source.text[source.length], '\0');
+    asm_compilation_result *result = asm_assemble(source.text);
+    ASSERT_EQ(result->code[0], 407);
+    ASSERT_EQ(result->code[1], 902);
+    asm_delete_compilation_result(result);
+    lmsm_source_close(&source);
+    remove(filename);
+
+    ASSERT_FALSE(lmsm_source_open(&source, filename));
+}
+
+TEST(code_generation, small_sources_are_read_whole) {
+    // just over a chunk, so a pipe-sized buffer would have had to grow
+    std::string src = "LDI 7\nOUT\n" + std::string(SOURCE_CHUNK_SIZE, ';') + "\n";
+    const char *filename = "small_source_test.asm";
+    FILE *file = fopen(filename, "w");
+    fwrite(src.data(), 1, src.size(), file);
+    fclose(file);
+
+    lmsm_source source;
+    ASSERT_TRUE(lmsm_source_open(&source, filename));
+    ASSERT_EQ(source.mapping_size, 0u);
+    ASSERT_EQ(source.length, src.size());
+    ASSERT_STREQ(source.text, src.c_str());
+    lmsm_source_close(&source);
+    remove(filename);
+}
+
+TEST(code_generation, source_maps_survive_optimization_and_sidecars) {
+    char src[] = "      LDI 1\n"
+                 "      BRA skip\n"
+                 "      OUT\n"
+                 "skip  CALL f\n"
+                 "      HLT\n"
+                 "f     LDI 2\n"
+                 "      RET";
+    asm_compilation_result *result = asm_assemble_with_options(src, ASM_SOURCE_MAP | ASM_OPTIMIZE);
+    ASSERT_EQ(result->error, nullptr);
+    lmsm_srcmap *map = lmsm_srcmap_create();
+    lmsm_srcmap_add_assembly(map, (char *) "f.asm", result, NULL);
+
+    // the branch and the dead OUT are gone, so the CALL now starts at 1
+    ASSERT_EQ(lmsm_srcmap_lookup(map, 0)->line, 1);
+    lmsm_srcmap_entry *call = lmsm_srcmap_lookup(map, 3);
+    ASSERT_EQ(call->offset, 1);
+    ASSERT_EQ(call->line, 4);
+    ASSERT_EQ(call->column, 1);
+
+    const char *filename = "source_map_test.map";
+    ASSERT_TRUE(lmsm_srcmap_write(map, (char *) filename));
+    lmsm_srcmap *read = lmsm_srcmap_read((char *) filename);
+    remove(filename);
+    ASSERT_NE(read, nullptr);
+    ASSERT_EQ(read->count, map->count);
+    char location[100];
+    lmsm_srcmap_format(read, lmsm_srcmap_lookup(map, 5)->offset, location, sizeof(location));
+    ASSERT_STREQ(location, "f.asm:6:1");
+    ASSERT_EQ(lmsm_srcmap_lookup(read, 99), nullptr);
+
+    lmsm_srcmap_delete(read);
+    lmsm_srcmap_delete(map);
+    asm_delete_compilation_result(result);
+}
+
 //==========================================================================
 // Complete assembly tests
 //==========================================================================
@@ -4,6 +4,7 @@ extern "C" {
 #include "lmsm.h"
 #include "assembler.h"
 #include "firth.h"
+#include "srcmap.h"
 }
 
 //==========================================================================
@@ -33,3 +34,300 @@ TEST(instruction_construction, max_works_in_firth) {
     asm_delete_compilation_result(asm_result);
     firth_delete_compilation_result(firth_result);
 }
+
+TEST(instruction_construction, comments_are_ignored_in_firth) {
+    lmsm *the_machine = lmsm_create();
+    firth_compilation_result *firth_result = firth_compile("-- push two numbers\n"
+                                                           "3 2 ; and add them\n"
+                                                           "+ pop");
+    ASSERT_EQ(firth_result->error, nullptr);
+    asm_compilation_result *asm_result = asm_assemble(firth_result->lmsm_assembly);
+    lmsm_load(the_machine, asm_result->code, 100);
+    lmsm_run(the_machine);
+    ASSERT_EQ(the_machine->accumulator, 5);
+    lmsm_delete(the_machine);
+    asm_delete_compilation_result(asm_result);
+    firth_delete_compilation_result(firth_result);
+}
+
+TEST(instruction_construction, firth_tokens_point_into_the_source) {
+    char src[] = "1\n  dup";
+    firth_compilation_result *firth_result = firth_compile(src);
+    firth_token *dup = firth_result->tokens->start->next;
+    ASSERT_EQ(dup->span.start, src + 4);
+    ASSERT_EQ(dup->span.length, 3);
+    ASSERT_EQ(dup->span.line, 2);
+    ASSERT_EQ(dup->span.column, 3);
+    ASSERT_STREQ(src, "1\n  dup");
+    firth_delete_compilation_result(firth_result);
+}
+
+TEST(instruction_construction, firth_assembly_grows_past_any_fixed_buffer) {
+    std::string src;
+    for (int i = 0; i < 1000; ++i) {
+        src += "1 pop ";
+    }
+    firth_compilation_result *firth_result = firth_compile((char *) src.c_str());
+    ASSERT_EQ(firth_result->error, nullptr);
+    ASSERT_EQ(firth_result->assembly_length, 1000 * strlen("LDI 1\nSPUSH\nSPOP\n") + strlen("HLT\n"));
+    ASSERT_EQ(strlen(firth_result->lmsm_assembly), (size_t) firth_result->assembly_length);
+    ASSERT_STREQ(firth_result->lmsm_assembly + firth_result->assembly_length - 9, "SPOP\nHLT\n");
+    firth_delete_compilation_result(firth_result);
+}
+
+TEST(instruction_construction, firth_code_maps_back_to_its_elements) {
+    firth_compilation_result *firth_result = firth_compile("3 sq() pop\n"
+                                                           "def sq()\n"
+                                                           "  dup * end");
+    asm_compilation_result *asm_result = asm_assemble_with_options(firth_result->lmsm_assembly, ASM_SOURCE_MAP);
+    lmsm_srcmap *map = lmsm_srcmap_create();
+    lmsm_srcmap_add_assembly(map, (char *) "sq.firth", asm_result, firth_result);
+
+    // CALL sq() is three words, all of them belong to the call
+    char location[100];
+    lmsm_srcmap_format(map, 4, location, sizeof(location));
+    ASSERT_STREQ(location, "sq.firth:1:3 sq()");
+    lmsm_srcmap_entry *multiply = lmsm_srcmap_lookup(map, 8);
+    ASSERT_EQ(multiply->line, 3);
+    ASSERT_EQ(multiply->column, 7);
+    ASSERT_STREQ(multiply->element, "*");
+    // the RET belongs to the definition, the final HLT to nothing
+    ASSERT_STREQ(lmsm_srcmap_lookup(map, 9)->element, "sq()");
+    ASSERT_EQ(lmsm_srcmap_lookup(map, 6), nullptr);
+    ASSERT_EQ(lmsm_srcmap_lookup(map, 10), nullptr);
+
+    lmsm_srcmap_delete(map);
+    asm_delete_compilation_result(asm_result);
+    firth_delete_compilation_result(firth_result);
+}
+
+TEST(instruction_construction, firth_builds_code_without_reparsing_assembly) {
+    const char *src = "3 sq() .\n"
+                      "def sq()\n"
+                      "  dup zero? 1 else dup * end end";
+    firth_compilation_result *text = firth_compile((char *) src);
+    asm_compilation_result *asm_result = asm_assemble_with_options(text->lmsm_assembly, ASM_SOURCE_MAP);
+    firth_compilation_result *direct = firth_compile_with_options((char *) src, FIRTH_ASSEMBLE, ASM_SOURCE_MAP);
+    ASSERT_EQ(direct->assembled->error, nullptr);
+    ASSERT_EQ(direct->assembly_length, 0);
+    ASSERT_EQ(direct->assembled->size, asm_result->size);
+    ASSERT_EQ(memcmp(direct->assembled->code, asm_result->code, sizeof(asm_result->code)), 0);
+    ASSERT_EQ(direct->assembled->source_map_count, asm_result->source_map_count);
+    ASSERT_EQ(direct->assembled->source_map[4].line, asm_result->source_map[4].line);
+    asm_delete_compilation_result(asm_result);
+    firth_delete_compilation_result(text);
+    firth_delete_compilation_result(direct);
+
+    // errors the assembler finds are reported where the text path reports them
+    direct = firth_compile_with_options((char *) "1 pop 1000 pop", FIRTH_ASSEMBLE | FIRTH_EMIT_ASSEMBLY, 0);
+    asm_result = asm_assemble(direct->lmsm_assembly);
+    ASSERT_STREQ(direct->assembled->error, asm_result->error);
+    ASSERT_EQ(direct->assembled->error_line, 4);
+    ASSERT_EQ(direct->assembled->error_column, asm_result->error_column);
+    asm_delete_compilation_result(asm_result);
+    firth_delete_compilation_result(direct);
+}
+
+TEST(instruction_construction, firth_folds_constant_arithmetic) {
+    int options = FIRTH_EMIT_ASSEMBLY | FIRTH_OPTIMIZE;
+    firth_compilation_result *firth_result = firth_compile_with_options((char *) "2 3 + 4 * pop", options, 0);
+    ASSERT_STREQ(firth_result->lmsm_assembly, "LDI 20\nSPUSH\nSPOP\nHLT\n");
+    firth_delete_compilation_result(firth_result);
+
+    // products are capped at 999 before dividing, division truncates toward zero
+    firth_result = firth_compile_with_options((char *) "99 99 * 99 / 0 7 - 2 / 4 + swap pop", options, 0);
+    ASSERT_STREQ(firth_result->lmsm_assembly, "LDI 1\nSPUSH\nLDI 10\nSPUSH\nSPOP\nHLT\n");
+    firth_delete_compilation_result(firth_result);
+
+    // dividing by zero is left to the machine, as is a result that leaves the accumulator different
+    firth_result = firth_compile_with_options((char *) "1 0 / pop 2 3 +", options, 0);
+    ASSERT_STREQ(firth_result->lmsm_assembly,
+                 "LDI 1\nSPUSH\nLDI 0\nSPUSH\nSDIV\nSPOP\nLDI 2\nSPUSH\nLDI 3\nSPUSH\nSADD\nHLT\n");
+    firth_delete_compilation_result(firth_result);
+
+    // inside functions too, and the program still computes the same thing
+    const char *src = "f() def f() 5 dup * 3 dup max - . end";
+    for (int i = 0; i < 2; ++i) {
+        lmsm *the_machine = lmsm_create();
+        firth_result = firth_compile_with_options((char *) src, FIRTH_ASSEMBLE | (i ? FIRTH_OPTIMIZE : 0), 0);
+        lmsm_load(the_machine, firth_result->assembled->code, 100);
+        lmsm_run(the_machine);
+        ASSERT_STREQ(the_machine->output_buffer, "22 ");
+        ASSERT_EQ(firth_result->assembled->size, i ? 6 : 17);
+        firth_delete_compilation_result(firth_result);
+        lmsm_delete(the_machine);
+    }
+}
+
+TEST(instruction_construction, firth_tail_calls_become_branches) {
+    const char *src = "90 loop() def loop() 1 - dup zero? pop else loop() end end";
+    firth_compilation_result *firth_result = firth_compile_with_options((char *) src,
+                                                                        FIRTH_EMIT_ASSEMBLY | FIRTH_OPTIMIZE, 0);
+    ASSERT_STREQ(firth_result->lmsm_assembly, "LDI 90\nSPUSH\nCALL loop()\nHLT\n"
+                                              "loop() LDI 1\nSPUSH\nSSUB\nSDUP\nSPOP\nBRZ if_zero_0\n"
+                                              "BRA loop()\n"
+                                              "if_zero_0 SPOP\nend_zero_1 RET\n");
+    firth_delete_compilation_result(firth_result);
+
+    // the loop runs in constant return stack space
+    firth_result = firth_compile_with_options((char *) src, FIRTH_ASSEMBLE | FIRTH_OPTIMIZE, 0);
+    lmsm *the_machine = lmsm_create();
+    lmsm_load(the_machine, firth_result->assembled->code, 100);
+    int deepest = the_machine->return_address_pointer;
+    the_machine->status = STATUS_RUNNING;
+    while (the_machine->status != STATUS_HALTED) {
+        lmsm_step(the_machine);
+        deepest = std::max(deepest, the_machine->return_address_pointer);
+    }
+    ASSERT_EQ(the_machine->error_code, ERROR_NONE);
+    ASSERT_EQ(the_machine->accumulator, 0);
+    ASSERT_EQ(deepest, TOP_OF_MEMORY - 99);
+    lmsm_delete(the_machine);
+    firth_delete_compilation_result(firth_result);
+
+    // both branches in tail position, so neither falls through to a RET
+    firth_result = firth_compile_with_options((char *) "f() f() def f() zero? g() else h() end end",
+                                              FIRTH_EMIT_ASSEMBLY | FIRTH_OPTIMIZE, 0);
+    ASSERT_STREQ(firth_result->lmsm_assembly, "CALL f()\nCALL f()\nHLT\n"
+                                              "f() SPOP\nBRZ if_zero_0\nBRA h()\nif_zero_0 BRA g()\n");
+    firth_delete_compilation_result(firth_result);
+
+    // a tail call leaves the accumulator holding the last number, not the callee's address,
+    // but a number the program leaves there itself is the same either way
+    const char *endings[] = {"", " 4"};
+    for (int i = 0; i < 2; ++i) {
+        std::string src = std::string("5 6 g() f() f()") + endings[i] +
+                          " def f() 1 2 + pop g() end def g() swap swap swap swap swap swap swap swap swap end";
+        int accumulators[2];
+        for (int optimize = 0; optimize < 2; ++optimize) {
+            firth_result = firth_compile_with_options((char *) src.c_str(),
+                                                      FIRTH_ASSEMBLE | (optimize ? FIRTH_OPTIMIZE : 0), 0);
+            the_machine = lmsm_create();
+            lmsm_load(the_machine, firth_result->assembled->code, 100);
+            lmsm_run(the_machine);
+            ASSERT_EQ(the_machine->error_code, ERROR_NONE);
+            ASSERT_EQ(the_machine->memory[the_machine->stack_pointer], i ? 4 : 5);
+            accumulators[optimize] = the_machine->accumulator;
+            lmsm_delete(the_machine);
+            firth_delete_compilation_result(firth_result);
+        }
+        ASSERT_EQ(accumulators[1], i ? 4 : 3);
+        ASSERT_EQ(accumulators[0] == accumulators[1], i == 1);
+    }
+}
+
+TEST(instruction_construction, firth_inlines_small_functions) {
+    int options = FIRTH_EMIT_ASSEMBLY | FIRTH_OPTIMIZE;
+    firth_compilation_result *firth_result = firth_compile_with_options((char *) "3 sq() . def sq() dup * end",
+                                                                        options, 0);
+    ASSERT_STREQ(firth_result->lmsm_assembly, "LDI 9\nSPUSH\nSDUP\nSPOP\nOUT\nHLT\n");
+    firth_delete_compilation_result(firth_result);
+
+    // a return skips the rest of the inlined body, not the rest of the caller
+    const char *inputs[] = {"0", "4"};
+    const char *outputs[] = {"7 8 ", "5 8 "};
+    for (int i = 0; i < 2; ++i) {
+        std::string src = std::string(inputs[i]) + " f() . 8 . def f() dup zero? pop 7 return end 1 + end";
+        firth_result = firth_compile_with_options((char *) src.c_str(), options | FIRTH_ASSEMBLE, 0);
+        ASSERT_EQ(strstr(firth_result->lmsm_assembly, "CALL"), nullptr);
+        lmsm *the_machine = lmsm_create();
+        lmsm_load(the_machine, firth_result->assembled->code, 100);
+        lmsm_run(the_machine);
+        ASSERT_STREQ(the_machine->output_buffer, outputs[i]);
+        lmsm_delete(the_machine);
+        firth_delete_compilation_result(firth_result);
+    }
+
+    // an inlined body doesn't load the function's address into the accumulator like a CALL,
+    // it is left with the last number instead
+    int accumulators[2];
+    for (int optimize = 0; optimize < 2; ++optimize) {
+        firth_result = firth_compile_with_options((char *) "9 pop 2 3 f() def f() swap end",
+                                                  FIRTH_ASSEMBLE | (optimize ? FIRTH_OPTIMIZE : 0), 0);
+        lmsm *the_machine = lmsm_create();
+        lmsm_load(the_machine, firth_result->assembled->code, 100);
+        lmsm_run(the_machine);
+        ASSERT_EQ(the_machine->memory[the_machine->stack_pointer], 2);
+        accumulators[optimize] = the_machine->accumulator;
+        lmsm_delete(the_machine);
+        firth_delete_compilation_result(firth_result);
+    }
+    ASSERT_NE(accumulators[0], 3);
+    ASSERT_EQ(accumulators[1], 3);
+
+    // recursive functions stay calls
+    firth_result = firth_compile_with_options((char *) "9 r() def r() dup zero? else 1 - r() end end", options, 0);
+    ASSERT_NE(strstr(firth_result->lmsm_assembly, "CALL r()"), nullptr);
+    firth_delete_compilation_result(firth_result);
+
+    // and nothing is inlined past the size of memory
+    std::string src = "def f() 1 2 3 4 end";
+    for (int i = 0; i < 14; ++i) {
+        src += " f()";
+    }
+    firth_result = firth_compile_with_options((char *) src.c_str(), options | FIRTH_ASSEMBLE, 0);
+    ASSERT_NE(strstr(firth_result->lmsm_assembly, "CALL f()"), nullptr);
+    ASSERT_EQ(firth_result->assembled->error, nullptr);
+    firth_delete_compilation_result(firth_result);
+}
+
+TEST(instruction_construction, firth_zero_ending_a_branch_shares_its_end_label) {
+    // inlining leaves zero? ending a branch of another zero? too
+    const char *srcs[] = {"0 0 zero? 1 zero? 2 end end 5 .", "0 0 zero? 1 f() end 5 . def f() zero? 2 end end"};
+    for (int i = 0; i < 2; ++i) {
+        for (int optimize = 0; optimize < 2; ++optimize) {
+            int options = FIRTH_EMIT_ASSEMBLY | FIRTH_ASSEMBLE | (optimize ? FIRTH_OPTIMIZE : 0);
+            firth_compilation_result *firth_result = firth_compile_with_options((char *) srcs[i], options,
+                                                                                ASM_OPTIMIZE);
+            ASSERT_EQ(firth_result->assembled->error, nullptr);
+            asm_compilation_result *asm_result = asm_assemble(firth_result->lmsm_assembly);
+            ASSERT_EQ(asm_result->error, nullptr);
+            lmsm *the_machine = lmsm_create();
+            lmsm_load(the_machine, firth_result->assembled->code, 100);
+            lmsm_run(the_machine);
+            ASSERT_STREQ(the_machine->output_buffer, "5 ");
+            lmsm_delete(the_machine);
+            asm_delete_compilation_result(asm_result);
+            firth_delete_compilation_result(firth_result);
+        }
+    }
+}
+
+TEST(instruction_construction, firth_drops_functions_nothing_calls) {
+    const char *src = "1 a() pop\n"
+                      "def a() zero? a() else b() end end\n"
+                      "def b() 2 . end\n"
+                      "def unused() 3 4 + c() end\n"
+                      "def c() unused() end";
+    firth_compilation_result *firth_result = firth_compile_with_options((char *) src, FIRTH_EMIT_ASSEMBLY |
+                                                                                      FIRTH_OPTIMIZE, 0);
+    ASSERT_EQ(firth_result->error, nullptr);
+    ASSERT_EQ(firth_result->removed_functions, 2);  // unused() and c() call only each other
+    ASSERT_EQ(firth_result->removed_slots, 9 + 4);
+    ASSERT_EQ(firth_result->inlined_functions, 1);  // b()
+    ASSERT_EQ(strstr(firth_result->lmsm_assembly, "unused()"), nullptr);
+    ASSERT_EQ(strstr(firth_result->lmsm_assembly, "c()"), nullptr);
+    ASSERT_NE(strstr(firth_result->lmsm_assembly, "a() SPOP"), nullptr);
+    firth_delete_compilation_result(firth_result);
+}
+
+TEST(instruction_construction, firth_arena_holds_tokens_and_parse_tree) {
+    firth_compilation_result *firth_result = firth_compile_with_options((char *) "3 f() . def f() zero? 1 else 2 end end",
+                                                                        FIRTH_EMIT_ASSEMBLY | FIRTH_OPTIMIZE, 0);
+    ASSERT_EQ(firth_result->error, nullptr);
+    auto in_arena = [&](void *pointer) {
+        for (lmsm_arena_block *block = firth_result->arena->blocks; block != nullptr; block = block->next) {
+            if ((char *) pointer > (char *) block && (char *) pointer < (char *) (block + 1) + block->size) {
+                return true;
+            }
+        }
+        return false;
+    };
+    ASSERT_TRUE(in_arena(firth_result->tokens->start));
+    ASSERT_TRUE(in_arena(firth_result->root_elements));
+    firth_parse_element *zero = firth_result->root_elements->first->next_sibling;  // f() was inlined
+    ASSERT_EQ(zero->type, ZERO_TEST);
+    ASSERT_TRUE(in_arena(zero));
+    ASSERT_TRUE(in_arena(zero->right_children));
+    firth_delete_compilation_result(firth_result);
+}
@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 extern "C" {
 #include "lmsm.h"
+#include "history.h"
+#include "trace.h"
 }
 
 TEST(lmsm_machine_suite,test_add_instruction_works){
@@ -509,3 +511,166 @@ TEST(lmsm_machine_suite,step_does_not_step_to_the_next_instruction_and_execute_i
     lmsm_delete(the_machine);
 }
 
+
+TEST(lmsm_machine_suite,run_until_break_stops_at_breakpoint){
+
+    lmsm *the_machine = lmsm_create();
+
+    the_machine->memory[0] = 401; // LDI 1
+    the_machine->memory[1] = 902; // OUT
+    the_machine->memory[2] = 902; // OUT
+    the_machine->memory[3] = 000; // HLT
+
+    lmsm_set_breakpoint(the_machine, 2, 1);
+    ASSERT_EQ(lmsm_run_until_break(the_machine), 1);
+    ASSERT_EQ(the_machine->program_counter, 2); // stopped before executing slot 2
+    ASSERT_STREQ(the_machine->output_buffer, "1 ");
+
+    ASSERT_EQ(lmsm_run_until_break(the_machine), 0); // continues off of the breakpoint to the halt
+    ASSERT_EQ(the_machine->status, STATUS_HALTED);
+    ASSERT_STREQ(the_machine->output_buffer, "1 1 ");
+
+    lmsm_delete(the_machine);
+}
+
+TEST(lmsm_machine_suite,run_until_break_stops_after_write_to_watched_cell){
+
+    lmsm *the_machine = lmsm_create();
+
+    the_machine->memory[0] = 405; // LDI 5
+    the_machine->memory[1] = 920; // SPUSH
+    the_machine->memory[2] = 350; // STA 50
+    the_machine->memory[3] = 000; // HLT
+
+    lmsm_set_watchpoint(the_machine, 199, 1);
+    ASSERT_EQ(lmsm_run_until_break(the_machine), 1);
+    ASSERT_EQ(the_machine->program_counter, 2); // stopped after the SPUSH
+    ASSERT_EQ(the_machine->memory[199], 5);
+
+    lmsm_set_watchpoint(the_machine, 199, 0);
+    lmsm_set_watchpoint(the_machine, 50, 1);
+    ASSERT_EQ(lmsm_run_until_break(the_machine), 1);
+    ASSERT_EQ(the_machine->program_counter, 3); // stopped after the STA
+    ASSERT_EQ(the_machine->memory[50], 5);
+
+    lmsm_clear_breakpoints(the_machine);
+    ASSERT_EQ(the_machine->breakpoint_count, 0);
+    ASSERT_EQ(lmsm_run_until_break(the_machine), 0);
+
+    lmsm_delete(the_machine);
+}
+
+TEST(lmsm_machine_suite,reverse_step_restores_registers_memory_and_output){
+
+    lmsm *the_machine = lmsm_create();
+    lmsm_history_enable(the_machine, 2);
+
+    the_machine->memory[0] = 405; // LDI 5
+    the_machine->memory[1] = 920; // SPUSH
+    the_machine->memory[2] = 902; // OUT
+    the_machine->memory[3] = 350; // STA 50
+    the_machine->memory[4] = 000; // HLT
+    lmsm_history_rebase(the_machine);
+    int below_stack = the_machine->memory[199];  // whatever was there before SPUSH
+
+    lmsm_run(the_machine);
+    ASSERT_EQ(the_machine->history->step, 5);
+
+    ASSERT_EQ(lmsm_history_reverse_step(the_machine), 1); // undo HLT
+    ASSERT_EQ(lmsm_history_reverse_step(the_machine), 1); // undo STA 50
+    ASSERT_EQ(the_machine->memory[50], 0);
+    ASSERT_EQ(the_machine->program_counter, 3);
+    ASSERT_EQ(lmsm_history_reverse_step(the_machine), 1); // undo OUT
+    ASSERT_STREQ(the_machine->output_buffer, "");
+    ASSERT_EQ(lmsm_history_reverse_step(the_machine), 1); // undo SPUSH
+    ASSERT_EQ(the_machine->stack_pointer, 200);
+    ASSERT_EQ(the_machine->memory[199], below_stack);
+    ASSERT_EQ(lmsm_history_reverse_step(the_machine), 1); // undo LDI 5
+    ASSERT_EQ(the_machine->accumulator, 0);
+    ASSERT_EQ(lmsm_history_reverse_step(the_machine), 0); // nothing left
+
+    lmsm_delete(the_machine);
+}
+
+TEST(lmsm_machine_suite,seek_moves_to_any_recorded_step){
+
+    lmsm *the_machine = lmsm_create();
+    lmsm_history_enable(the_machine, 4);
+
+    the_machine->memory[0] = 410; // LDI 10
+    the_machine->memory[1] = 902; // OUT
+    the_machine->memory[2] = 207; // SUB 07
+    the_machine->memory[3] = 801; // BRP 01
+    the_machine->memory[4] = 000; // HLT
+    the_machine->memory[7] = 1;   // DAT 1
+    lmsm_history_rebase(the_machine);
+
+    lmsm_run(the_machine);
+    long length = the_machine->history->step;
+    char final_output[OUTPUT_BUFFER_SIZE];
+    strcpy(final_output, the_machine->output_buffer);
+
+    ASSERT_EQ(lmsm_history_seek(the_machine, 3), 1); // LDI, OUT, SUB
+    ASSERT_EQ(the_machine->accumulator, 9);
+    ASSERT_STREQ(the_machine->output_buffer, "10 ");
+
+    ASSERT_EQ(lmsm_history_seek(the_machine, length), 1);
+    ASSERT_EQ(the_machine->status, STATUS_HALTED);
+    ASSERT_STREQ(the_machine->output_buffer, final_output);
+
+    ASSERT_EQ(lmsm_history_seek(the_machine, length + 1), 0);
+
+    lmsm_delete(the_machine);
+}
+
+TEST(lmsm_machine_suite,trace_round_trips_every_step){
+
+    lmsm *the_machine = lmsm_create();
+
+    the_machine->memory[0] = 403; // LDI 3
+    the_machine->memory[1] = 920; // SPUSH
+    the_machine->memory[2] = 924; // SSWAP
+    the_machine->memory[3] = 902; // OUT
+    the_machine->memory[4] = 000; // HLT
+
+    ASSERT_EQ(lmsm_trace_start(the_machine, (char *) "lmsm_trace_test.bin", 1), 1);
+    lmsm_run(the_machine);
+    lmsm_trace_stop(the_machine);
+
+    lmsm_trace_reader *reader = lmsm_trace_reader_open((char *) "lmsm_trace_test.bin");
+    ASSERT_TRUE(reader != NULL);
+    lmsm_trace_record record;
+
+    ASSERT_EQ(lmsm_trace_reader_next(reader, &record), 1);
+    ASSERT_EQ(record.instruction, 403);
+    ASSERT_EQ(record.accumulator, 3);
+
+    ASSERT_EQ(lmsm_trace_reader_next(reader, &record), 1);
+    ASSERT_EQ(record.stack_pointer, 199);
+    ASSERT_EQ(record.write_count, 1);
+    ASSERT_EQ(record.addresses[0], 199);
+    ASSERT_EQ(record.values[0], 3);
+
+    ASSERT_EQ(lmsm_trace_reader_next(reader, &record), 1);
+    ASSERT_EQ(record.instruction, 924);
+    ASSERT_TRUE(record.halted); // swap with one value on the stack is an error
+    ASSERT_EQ(record.error_code, ERROR_BAD_STACK);
+
+    ASSERT_EQ(lmsm_trace_reader_next(reader, &record), 0);
+    lmsm_trace_reader_close(reader);
+    remove("lmsm_trace_test.bin");
+    lmsm_delete(the_machine);
+}
+
+TEST(lmsm_machine_suite,trace_compression_round_trips){
+    unsigned char raw[2000];
+    for (int i = 0; i < 2000; ++i) {
+        raw[i] = (unsigned char) ((i % 7) * 3 + (i / 500));
+    }
+    unsigned char compressed[2100];
+    unsigned char restored[2000];
+    int length = lmsm_trace_compress(raw, 2000, compressed);
+    ASSERT_LT(length, 2000);
+    ASSERT_EQ(lmsm_trace_decompress(compressed, length, restored, 2000), 2000);
+    ASSERT_EQ(memcmp(raw, restored, 2000), 0);
+}